@@ -3,7 +3,7 @@ import pathlib
 
 import pandas as pd
 
-from global_utils import results_dir
+from global_utils import results_dir, read_table
 from .vars import *
 
 
@@ -88,7 +88,7 @@ def read_equilibrations(
     """
 
     def eq_df(h, n, sampler: Sampler):
-        return pd.read_csv(
+        return read_table(
             equilibration_path(T, h, n, sampler), nrows=nrows, skiprows=skiprows
         )
 
@@ -112,7 +112,7 @@ def read_autocorrelation(T: float, h: float, /, sampler: Sampler) -> pd.DataFram
     """
 
     def autoc_df(h):
-        return pd.read_csv(autocorr_path(T, h, sampler))
+        return read_table(autocorr_path(T, h, sampler))
 
     df0 = autoc_df(0.0)
     df0["Sum_s"] = pd.NA
@@ -153,8 +153,8 @@ def read_measures(
     def file_path(h):
         return data_dir(T) / f"{sampler.value}_{h:06f}_variables.csv"
 
-    df = pd.read_csv(file_path(0.0), nrows=nrows, skiprows=skiprows).join(
-        pd.read_csv(file_path(h), nrows=nrows, skiprows=skiprows)
+    df = read_table(file_path(0.0), nrows=nrows, skiprows=skiprows).join(
+        read_table(file_path(h), nrows=nrows, skiprows=skiprows)
     )
     columns = pd.MultiIndex.from_tuples(
         map(tuple, df.columns.str.split("_", n=1)))
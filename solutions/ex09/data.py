@@ -1,5 +1,7 @@
 import pandas as pd
 
+from global_utils import read_table
+
 from .paths import results_path_from, distances_per_iter_path_from, TSP, Algo
 
 
@@ -8,10 +10,10 @@ from .paths import results_path_from, distances_per_iter_path_from, TSP, Algo
 
 
 def data_from(tsp: TSP, algo: Algo, p_line: int) -> pd.DataFrame:
-    df = pd.read_csv(results_path_from(tsp, algo, p_line))
+    df = read_table(results_path_from(tsp, algo, p_line))
     df.columns = list(range(len(df.columns)-1)) + [df.columns[-1]]
     return df
 
 
 def distances_per_iter_from(tsp: TSP, algo: Algo, p_line: int) -> pd.DataFrame:
-    return pd.read_csv(distances_per_iter_path_from(tsp, algo, p_line))
+    return read_table(distances_per_iter_path_from(tsp, algo, p_line))
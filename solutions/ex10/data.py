@@ -1,6 +1,8 @@
 from typing import Optional, Dict, Any, List
 import pandas as pd
 
+from global_utils import read_table
+
 from .paths import results_path_from, Algo
 
 
@@ -9,7 +11,7 @@ from .paths import results_path_from, Algo
 
 
 def data_from(algo: Algo, n_continents: int, fusion_p: Optional[float]) -> pd.DataFrame:
-    df = pd.read_csv(results_path_from(algo, n_continents, fusion_p))
+    df = read_table(results_path_from(algo, n_continents, fusion_p))
     df.columns = list(range(len(df.columns)-1)) + [df.columns[-1]]
     return df
 
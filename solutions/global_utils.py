@@ -39,6 +39,29 @@ def default_output(exercise: str) -> Path:
     return results_dir(section) / (exercise + ".csv")
 
 
+def read_table(
+    path: Path, nrows: Optional[int] = None, skiprows: Optional[int] = None
+) -> pd.DataFrame:
+    """Loads a table written by the executables, either as csv or as npz (--format npz)
+
+    Args:
+        path (Path): Path to the table; the .npz file is preferred when present.
+        nrows (Optional[int]): Number of rows to read, all of them if None.
+        skiprows (Optional[int]): Number of rows to skip from the beginning, header excluded.
+    """
+    path = Path(path)
+    skiprows = skiprows or 0
+    if path.with_suffix(".npz").exists():
+        with np.load(path.with_suffix(".npz")) as table:
+            stop = None if nrows is None else skiprows + nrows
+            return pd.DataFrame(
+                {name: table[name][skiprows:stop] for name in table.files}
+            )
+    return pd.read_csv(
+        path.with_suffix(".csv"), nrows=nrows, skiprows=range(1, skiprows + 1)
+    )
+
+
 def plot_trajectory(x, y, ax: plt.Axes, data: Optional[pd.DataFrame] = None, **kwargs):
     if data is not None:
         x = data[x]
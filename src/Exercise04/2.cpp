@@ -10,6 +10,8 @@
 
 #include "ariel_random/ariel_random.hpp"
 #include "config.hpp"
+#include "molecular_systems/data_types/async_writer.hpp"
+#include "molecular_systems/data_types/trajectory.hpp"
 #include "molecular_systems/steppers/md.hpp"
 #include "molecular_systems/system.hpp"
 
@@ -41,7 +43,9 @@ int main(int argc, char const *argv[]) {
       ("settings", "Path to the simulator settings", co::value<fs::path>()->default_value(MD_SETTINGS_PATH "input.solid"))
       ("x,configuration", "Path to molecular configuration. Must be three columns representing each molecule's position components", co::value<fs::path>()->default_value(LATTICES_PATH "config.fcc"))
       ("v,velocities", "Path to molecular velocities, to resume transform previous run", co::value<std::string>()->default_value(""))
-      ("N,save_every", "Save every N frames", co::value<size_t>()->default_value("0"));
+      ("N,save_every", "Save every N frames", co::value<size_t>()->default_value("0"))
+      ("compress", "Store the saved frames as 16-bit fractions of the box edge (lossy)", co::value<bool>()->default_value("false"))
+      ("cells", "Whether to look for interacting molecules using linked cells", co::value<bool>()->default_value("false"));
     // clang-format on
     auto user_params = options.parse(argc, argv);
     if (user_params.count("help")) {
@@ -60,19 +64,28 @@ int main(int argc, char const *argv[]) {
         VELOCITIES_PATH = fs::path(VELOCITIES_STRING);
     }
     const auto SAVE_EVERY_N_FRAMES = user_params["N"].as<size_t>();
+    const auto USE_CELLS = user_params["cells"].as<bool>();
     const auto OUTPUT_DIR = user_params["o"].as<fs::path>();
     if (!fs::exists(OUTPUT_DIR)) { fs::create_directories(OUTPUT_DIR); }
     const string PRIMES_SOURCE = user_params["p"].as<string>();
     const size_t PRIMES_LINE = user_params["l"].as<size_t>();
     const string SEEDS_SOURCE = user_params["s"].as<string>();
-    const auto FRAMES_DIR = OUTPUT_DIR / "frames/";
-    if (!fs::exists(FRAMES_DIR)) fs::create_directories(FRAMES_DIR);
+    const auto ENCODING = user_params["compress"].as<bool>() ? TrajectoryEncoding::Fixed16
+                                                              : TrajectoryEncoding::Exact;
 
     // Instantiating the rng and MD integrator
     ARandom rng(SEEDS_SOURCE, PRIMES_SOURCE, PRIMES_LINE);
     auto system = std::make_shared<LJMono<Value, false, Ensamble::NVE>>(
             SETTINGS_PATH, CONFIGURATION_PATH, VELOCITIES_PATH, rng);
+    if (USE_CELLS) system->init_linked_cells();
     MD integrator(system);
+    // Frames are appended to a single binary file by a background thread: see 04_to_xyz to
+    // visualize them
+    std::optional<TrajectoryWriter> trajectory;
+    if (SAVE_EVERY_N_FRAMES > 0)
+        trajectory.emplace(OUTPUT_DIR / "trajectory.bin", system->m_simulation.n_particles,
+                           ENCODING);
+    AsyncWriter<Value> writer(std::move(trajectory));
 
     // Vectors where mean estimations and their variances will be stored
     std::array<std::vector<Value>, 3 * N_VARS> stats;
@@ -82,7 +95,8 @@ int main(int argc, char const *argv[]) {
                      option::BarWidth{80});
     // Computing and storing block statistics
     for (size_t i = 0UL; i < system->m_simulation.n_blocks; i++) {
-        const auto block_results = integrator.block_estimates(SAVE_EVERY_N_FRAMES, FRAMES_DIR);
+        const auto block_results = integrator.block_estimates(
+                SAVE_EVERY_N_FRAMES, SAVE_EVERY_N_FRAMES > 0 ? &writer : nullptr);
         for (size_t var = 0UL; var < N_VARS; var++) {
             stats[3 * var].push_back(std::get<0>(block_results[var]));
             stats[3 * var + 1].push_back(std::get<1>(block_results[var]));
@@ -91,8 +105,8 @@ int main(int argc, char const *argv[]) {
         pbar.tick();
     }
     // Saving final molecular positions and velocities
-    system->save_configurations((OUTPUT_DIR / "config.positions"),
-                                (OUTPUT_DIR / "config.velocities"));
+    writer.checkpoint(system->m_positions, system->m_velocities, system->m_simulation.box_edge,
+                      OUTPUT_DIR / "config.positions", OUTPUT_DIR / "config.velocities");
 
     // Storing results in a csv file
     const auto variable_names = LJMono<Value, false, Ensamble::NVE>::variable_names();
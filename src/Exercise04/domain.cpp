@@ -0,0 +1,110 @@
+#include <array>
+#include <filesystem>
+#include <iostream>
+#include <optional>
+#include <vector>
+
+#include <cxxopts.hpp>
+#include <mpi.h>
+#include <rapidcsv.h>
+
+#include "ariel_random/ariel_random.hpp"
+#include "config.hpp"
+#include "estimators/mean.hpp"
+#include "molecular_systems/steppers/domain_md.hpp"
+#include "molecular_systems/system.hpp"
+
+
+#define SECTION "04"
+#define EXERCISE SECTION "_domain"
+
+#define N_VARS 5
+
+using std::string;
+using Value = double;
+using namespace molecular_systems::steppers;
+namespace co = cxxopts;
+namespace fs = std::filesystem;
+
+int main(int argc, char *argv[]) {
+    MPI_Init(&argc, &argv);
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    cxxopts::Options options(EXERCISE, "Runs exercise 04's integrator splitting the box among "
+                                       "MPI ranks. Launch it through mpiexec");
+    // clang-format off
+    options.add_options("Program")
+      ("o,out", "Output dir", co::value<fs::path>()->default_value(RESULTS_DIR "/" SECTION "/domain/"))
+      ("h,help", "Print this message");
+    options.add_options("Rng seeding")
+      ("p,primes_path", "Prime numbers path", co::value<string>()->default_value(PRIMES_PATH "Primes"))
+      ("l,primes_line", "Line in primes_path to use", co::value<size_t>()->default_value("1"))
+      ("s, seeds_path", "Seed path", co::value<string>()->default_value(SEEDS_PATH "seed.in"));
+    options.add_options("Simulation")
+      ("settings", "Path to the simulator settings", co::value<fs::path>()->default_value(MD_SETTINGS_PATH "input.solid"))
+      ("x,configuration", "Path to molecular configuration. Must be three columns representing each molecule's position components", co::value<fs::path>()->default_value(LATTICES_PATH "config.fcc"))
+      ("v,velocities", "Path to molecular velocities, to resume transform previous run", co::value<std::string>()->default_value(""));
+    // clang-format on
+    auto user_params = options.parse(argc, argv);
+    if (user_params.count("help")) {
+        if (rank == 0) std::cout << options.help() << std::endl;
+        MPI_Finalize();
+        exit(0);
+    }
+
+    const auto CONFIGURATION_PATH = user_params["x"].as<fs::path>();
+    const auto SETTINGS_PATH = user_params["settings"].as<fs::path>();
+    const auto VELOCITIES_STRING = user_params["v"].as<std::string>();
+    std::optional<fs::path> VELOCITIES_PATH;
+    if (!VELOCITIES_STRING.empty()) VELOCITIES_PATH = fs::path(VELOCITIES_STRING);
+    const auto OUTPUT_DIR = user_params["o"].as<fs::path>();
+    if (rank == 0 && !fs::exists(OUTPUT_DIR)) { fs::create_directories(OUTPUT_DIR); }
+    const string PRIMES_SOURCE = user_params["p"].as<string>();
+    const size_t PRIMES_LINE = user_params["l"].as<size_t>();
+    const string SEEDS_SOURCE = user_params["s"].as<string>();
+
+    // Every rank builds the same initial state, then keeps its own sub-box
+    ARandom rng(SEEDS_SOURCE, PRIMES_SOURCE, PRIMES_LINE);
+    using System = DomainMD<Value, false>::System;
+    System system(SETTINGS_PATH, CONFIGURATION_PATH, VELOCITIES_PATH, rng);
+    DomainMD<Value, false> integrator(system);
+
+    std::array<SampleProgAvg<Value>, N_VARS> estimators;
+    std::array<std::vector<Value>, N_VARS> block_data;
+    std::array<std::vector<Value>, 3 * N_VARS> stats;
+    for (size_t block = 0UL; block < system.m_simulation.n_blocks; block++) {
+        for (auto &data: block_data) data.clear();
+        for (size_t t = 0UL; t < system.m_simulation.block_size; t++) {
+            std::array<Value, N_VARS> values{};
+            integrator.measures(values[0], values[1], values[2], values[3], values[4]);
+            for (size_t var = 0UL; var < N_VARS; var++) block_data[var].push_back(values[var]);
+            integrator.step();
+        }
+        for (size_t var = 0UL; var < N_VARS; var++) {
+            const auto results = estimators[var](block_data[var].cbegin(), block_data[var].cend());
+            stats[3 * var].push_back(std::get<0>(results));
+            stats[3 * var + 1].push_back(std::get<1>(results));
+            stats[3 * var + 2].push_back(std::get<2>(results));
+        }
+    }
+    integrator.gather(system);
+
+    if (rank == 0) {
+        system.save_configurations((OUTPUT_DIR / "config.positions"),
+                                   (OUTPUT_DIR / "config.velocities"));
+        const auto variable_names = System::variable_names();
+        rapidcsv::Document table;
+        for (size_t var = 0UL; var < N_VARS; var++) {
+            table.InsertColumn(3 * var, stats[3 * var], variable_names[var] + "_blockmean");
+            table.InsertColumn(3 * var + 1, stats[3 * var + 1], variable_names[var] + "_progmean");
+            table.InsertColumn(3 * var + 2, stats[3 * var + 2], variable_names[var] + "_error");
+        }
+        table.RemoveColumn(table.GetColumnCount() - 1);
+        table.Save(OUTPUT_DIR / "thermo.csv");
+        const auto dims = integrator.dims();
+        std::cout << "Ranks grid: " << dims[0] << "x" << dims[1] << "x" << dims[2] << std::endl;
+    }
+    MPI_Finalize();
+    return 0;
+}
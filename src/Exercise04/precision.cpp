@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+
+#include <cxxopts.hpp>
+#include <rapidcsv.h>
+
+#include "ariel_random/ariel_random.hpp"
+#include "config.hpp"
+#include "molecular_systems/steppers/md.hpp"
+#include "molecular_systems/system.hpp"
+
+
+#define SECTION "04"
+#define EXERCISE SECTION "_precision"
+
+using std::string;
+using namespace molecular_systems::steppers;
+namespace co = cxxopts;
+namespace fs = std::filesystem;
+
+// Reference configuration: everything in double precision
+using DoubleSystem = LJMono<double, false, Ensamble::NVE>;
+// Mixed configuration: positions, velocities and forces in single precision, measures in double
+using MixedSystem = LJMono<float, false, Ensamble::NVE, double>;
+
+int main(int argc, char const *argv[]) {
+    cxxopts::Options options(EXERCISE,
+                             "Integrates the same initial state in double and in mixed precision "
+                             "and reports the drift of the total energy of both runs");
+    // clang-format off
+    options.add_options("Program")
+      ("o,out", "Output dir", co::value<fs::path>()->default_value(RESULTS_DIR "/" SECTION "/precision/"))
+      ("h,help", "Print this message");
+    options.add_options("Rng seeding")
+      ("p,primes_path", "Prime numbers path", co::value<string>()->default_value(PRIMES_PATH "Primes"))
+      ("l,primes_line", "Line in primes_path to use", co::value<size_t>()->default_value("1"))
+      ("s, seeds_path", "Seed path", co::value<string>()->default_value(SEEDS_PATH "seed.in"));
+    options.add_options("Simulation")
+      ("settings", "Path to the simulator settings", co::value<fs::path>()->default_value(SOLUTIONS_PATH "argon/run/input.liquid"))
+      ("x,configuration", "Path to molecular configuration. Must be three columns representing each molecule's position components", co::value<fs::path>()->default_value(SOLUTIONS_PATH "argon/config.fcc"))
+      ("cells", "Whether to look for interacting molecules using linked cells", co::value<bool>()->default_value("false"));
+    // clang-format on
+    auto user_params = options.parse(argc, argv);
+    if (user_params.count("help")) {
+        std::cout << options.help() << std::endl;
+        exit(0);
+    }
+
+    const auto CONFIGURATION_PATH = user_params["x"].as<fs::path>();
+    const auto SETTINGS_PATH = user_params["settings"].as<fs::path>();
+    const auto USE_CELLS = user_params["cells"].as<bool>();
+    const auto OUTPUT_DIR = user_params["o"].as<fs::path>();
+    if (!fs::exists(OUTPUT_DIR)) { fs::create_directories(OUTPUT_DIR); }
+    const string PRIMES_SOURCE = user_params["p"].as<string>();
+    const size_t PRIMES_LINE = user_params["l"].as<size_t>();
+    const string SEEDS_SOURCE = user_params["s"].as<string>();
+
+    // Both runs start from the same velocities, sampled once and stored as text
+    ARandom rng(SEEDS_SOURCE, PRIMES_SOURCE, PRIMES_LINE);
+    const auto VELOCITIES_PATH = OUTPUT_DIR / "initial.velocities";
+    DoubleSystem(SETTINGS_PATH, CONFIGURATION_PATH, rng).m_velocities.save_configuration(
+            VELOCITIES_PATH);
+    auto reference =
+            std::make_shared<DoubleSystem>(SETTINGS_PATH, CONFIGURATION_PATH, VELOCITIES_PATH);
+    auto mixed =
+            std::make_shared<MixedSystem>(SETTINGS_PATH, CONFIGURATION_PATH, VELOCITIES_PATH);
+    if (USE_CELLS) {
+        reference->init_linked_cells();
+        mixed->init_linked_cells();
+    }
+    MD<double, false> reference_integrator(reference);
+    MD<float, false, double> mixed_integrator(mixed);
+
+    // Index of the total energy among the measured variables
+    constexpr size_t E = 2;
+    std::vector<double> reference_drift, mixed_drift, deviation;
+    double e0_reference{0}, e0_mixed{0}, max_deviation{0};
+    for (size_t block = 0UL; block < reference->m_simulation.n_blocks; block++) {
+        const auto reference_values = reference_integrator.values_t();
+        const auto mixed_values = mixed_integrator.values_t();
+        if (block == 0) {
+            e0_reference = reference_values[E].front();
+            e0_mixed = mixed_values[E].front();
+        }
+        for (size_t t = 0; t < reference_values[E].size(); t++)
+            max_deviation = std::max(max_deviation,
+                                     std::abs(mixed_values[E][t] - reference_values[E][t]));
+        reference_drift.push_back(reference_values[E].back() - e0_reference);
+        mixed_drift.push_back(mixed_values[E].back() - e0_mixed);
+        deviation.push_back(mixed_values[E].back() - reference_values[E].back());
+    }
+
+    rapidcsv::Document table;
+    table.InsertColumn(0, reference_drift, "drift_double");
+    table.InsertColumn(1, mixed_drift, "drift_mixed");
+    table.InsertColumn(2, deviation, "mixed_minus_double");
+    table.RemoveColumn(table.GetColumnCount() - 1);
+    table.Save(OUTPUT_DIR / "energy_drift.csv");
+
+    std::cout << "E/N drift after " << reference->time() << " steps: double "
+              << reference_drift.back() << ", mixed " << mixed_drift.back()
+              << "; largest |E_mixed - E_double| per particle: " << max_deviation << std::endl;
+    return 0;
+}
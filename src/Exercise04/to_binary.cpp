@@ -0,0 +1,35 @@
+#include <filesystem>
+#include <iostream>
+
+#include <cxxopts.hpp>
+
+#include "mapped_table.hpp"
+
+#define SECTION "04"
+#define EXERCISE SECTION "_to_binary"
+
+namespace co = cxxopts;
+namespace fs = std::filesystem;
+
+int main(int argc, char const *argv[]) {
+    cxxopts::Options options(EXERCISE, "Converts a text configuration (or an Ising spin state) into "
+                                       "a binary table, which the loaders map instead of parsing");
+    // clang-format off
+    options.add_options("Program")
+      ("i,in", "Path to the text file", co::value<fs::path>())
+      ("o,out", "Path to the binary table", co::value<fs::path>())
+      ("spins", "Whether the input is a spin state saved by the Ising model, instead of a configuration", co::value<bool>()->default_value("false"))
+      ("h,help", "Print this message");
+    // clang-format on
+    auto user_params = options.parse(argc, argv);
+    if (user_params.count("help") || !user_params.count("in") || !user_params.count("out")) {
+        std::cout << options.help() << std::endl;
+        exit(0);
+    }
+    const auto in = user_params["in"].as<fs::path>(), out = user_params["out"].as<fs::path>();
+    // Configurations have three columns of coordinates, spin states a header and a column of 0/1
+    const auto n_rows = user_params["spins"].as<bool>() ? text_to_table<uint8_t>(in, out, 1, 1)
+                                                        : text_to_table<double>(in, out, 3);
+    std::cout << n_rows << " rows converted" << std::endl;
+    return 0;
+}
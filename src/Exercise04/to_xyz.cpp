@@ -0,0 +1,31 @@
+#include <filesystem>
+#include <iostream>
+
+#include <cxxopts.hpp>
+
+#include "molecular_systems/data_types/trajectory.hpp"
+
+#define SECTION "04"
+#define EXERCISE SECTION "_to_xyz"
+
+namespace co = cxxopts;
+namespace fs = std::filesystem;
+
+int main(int argc, char const *argv[]) {
+    cxxopts::Options options(EXERCISE, "Converts a binary trajectory into one xyz file per frame");
+    // clang-format off
+    options.add_options("Program")
+      ("i,in", "Path to the trajectory", co::value<fs::path>())
+      ("o,out", "Directory where the xyz files will be stored", co::value<fs::path>())
+      ("h,help", "Print this message");
+    // clang-format on
+    auto user_params = options.parse(argc, argv);
+    if (user_params.count("help") || !user_params.count("in") || !user_params.count("out")) {
+        std::cout << options.help() << std::endl;
+        exit(0);
+    }
+    const auto n_frames =
+            trajectory_to_xyz(user_params["in"].as<fs::path>(), user_params["out"].as<fs::path>());
+    std::cout << n_frames << " frames converted" << std::endl;
+    return 0;
+}
@@ -3,7 +3,8 @@
 //
 
 /**
- * An executable which computes the auto correlation of one or more series stored in a csv file.
+ * An executable which computes the auto correlation of one or more series stored in a csv or npz
+ * table.
  */
 
 #include <filesystem>
@@ -25,10 +26,11 @@ int main(int argc, char const *argv[]) {
     cxxopts::Options options("Autocorrelation", "How to run autocorrelation");
     // clang-format off
     options.add_options("Program")
-      ("i,in", "Input file", co::value<fs::path>())
+      ("i,in", "Input file: a csv or npz table", co::value<fs::path>())
       ("o,out", "Output path", co::value<fs::path>())
       ("n,n_lags", "Number of lags to process", co::value<size_t>())
       ("s,skip", "Number of rows to skip from the beginning", co::value<size_t>()->default_value("0"))
+      ("format", "Format of the output table: csv or npz", co::value<std::string>()->default_value("csv"))
       ("h,help", "Print this message")
       ("v,verbose", "Whether to be verbose", co::value<bool>());
 
@@ -45,8 +47,9 @@ int main(int argc, char const *argv[]) {
     const auto N_LAGS = user_params["n"].as<size_t>();
     // The number of samples to skip from the beginning.
     const auto SKIP = user_params["s"].as<size_t>();
+    const auto FORMAT = tables::format_from(user_params["format"].as<std::string>());
 
-    utils::autocorrelation_from<double>(INPUT_FILE, OUTPUT_FILE, N_LAGS, SKIP);
+    utils::autocorrelation_from<double>(INPUT_FILE, OUTPUT_FILE, N_LAGS, SKIP, FORMAT);
 
     return 0;
 }
\ No newline at end of file
@@ -61,7 +61,8 @@ void equilibrate(ExOptions<VarSpace> &p, VarSpace h, std::string_view sampler_na
                                                                                         ising_1);
     equilibrator1.run(p.warmup_steps, rng1);
     equilibrator1.save_results(
-            p.output_dir / (std::string(sampler_name) + "_" + std::to_string(h) + "_warmup1.csv"));
+            p.output_dir / (std::string(sampler_name) + "_" + std::to_string(h) + "_warmup1.csv"),
+            p.format);
     if (p.save_spins)
         equilibrator1.save_state(p.output_dir / (std::string(sampler_name) + "_" +
                                                  std::to_string(h) + "_spins.csv"));
@@ -71,7 +72,8 @@ void equilibrate(ExOptions<VarSpace> &p, VarSpace h, std::string_view sampler_na
                                                                                         ising_2);
     equilibrator2.run(p.warmup_steps, rng2);
     equilibrator2.save_results(
-            p.output_dir / (std::string(sampler_name) + "_" + std::to_string(h) + "_warmup2.csv"));
+            p.output_dir / (std::string(sampler_name) + "_" + std::to_string(h) + "_warmup2.csv"),
+            p.format);
 }
 
 int main(int argc, char const *argv[]) {
@@ -80,6 +82,7 @@ int main(int argc, char const *argv[]) {
     // clang-format off
     options.add_options("Program")
       ("o,out", "Output directory", co::value<fs::path>()->default_value(RESULTS_DIR "/" SECTION "/"))
+      ("format", "Format of the output tables: csv or npz", co::value<string>()->default_value("csv"))
       ("h,help", "Print this message")
       ("v,verbose", "Whether to be verbose", co::value<bool>());
     options.add_options("Rng seeding")
@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <cmath>
 #include <filesystem>
+#include <iostream>
 #include <iterator>
 #include <memory>
 #include <random>
@@ -55,7 +56,8 @@ fs::path state_path(ExOptions<VarSpace> &p, VarSpace h, std::string_view sampler
 }
 /**
  * A helper function to perform measures. The measures results will be stored in csv files named
- * "{sampler_name}_{h}_variables.csv"
+ * "{sampler_name}_{h}_variables.csv"; when bootstrap replicas are requested, the final estimates
+ * with jackknife and bootstrap errors are stored in "{sampler_name}_{h}_resampled.csv"
  * @tparam Sampler The class of the MCMC algorithm which will be used.
  * @tparam URBG The class of the random number generator.
  * @tparam compute_H Flag to enable/disable the computation of H at compile time.
@@ -66,10 +68,12 @@ fs::path state_path(ExOptions<VarSpace> &p, VarSpace h, std::string_view sampler
  * @param h Value of the external magnetic field.
  * @param sampler_name A tag used to identify the run.
  * @param rng The random number generator.
+ * @param streams Random number generators of the bootstrap threads.
  */
 template<class Sampler, class URBG, bool compute_H, bool compute_s, bool compute_s2,
          class... ThermoVars>
-void measure(ExOptions<VarSpace> &p, VarSpace h, std::string_view sampler_name, URBG &rng) {
+void measure(ExOptions<VarSpace> &p, VarSpace h, std::string_view sampler_name, URBG &rng,
+             std::vector<URBG> &streams) {
     // Initialization of the Ising model: are we resuming a previous run?
     std::shared_ptr<Ising1D> ising_model;
     if (p.resume)
@@ -80,9 +84,28 @@ void measure(ExOptions<VarSpace> &p, VarSpace h, std::string_view sampler_name,
     // which intermediate variables should be computed (compute_H,...) for performance reasons
     D1::Simulator<compute_H, compute_s, compute_s2, VarSpace, Sampler, ThermoVars...> simulator(
             p.block_size, ising_model, ThermoVars(*ising_model)...);
-    simulator.run(p.n_blocks, p.warmup_steps, rng);
+    Resampling<VarSpace> resampling(D1::N_PROXY_AVERAGES);
+    if (p.n_replicas > 0) simulator.attach(resampling);
+    if constexpr (compute_H) {
+        if (p.target_error > 0) {
+            // Blocks are added until the blocking analysis of the energy reaches the target error
+            Blocking<VarSpace> blocking;
+            simulator.attach(blocking);
+            const auto n_blocks =
+                    simulator.run_until(p.n_blocks, p.warmup_steps, p.target_error, rng);
+            std::cout << sampler_name << ": " << n_blocks << " blocks, energy error "
+                      << blocking.error() << ", tau " << blocking.tau() << std::endl;
+        } else
+            simulator.run(p.n_blocks, p.warmup_steps, rng);
+    } else
+        simulator.run(p.n_blocks, p.warmup_steps, rng);
     simulator.save_results(p.output_dir / (std::string(sampler_name) + "_" + std::to_string(h) +
-                                           "_variables.csv"));
+                                           "_variables.csv"),
+                           p.format);
+    if (p.n_replicas > 0)
+        simulator.save_resampled(p.output_dir / (std::string(sampler_name) + "_" +
+                                                 std::to_string(h) + "_resampled.csv"),
+                                 p.n_replicas, streams, p.format);
     if (p.save_spins) ising_model->save_state(state_path(p, h, sampler_name));
 }
 
@@ -92,6 +115,7 @@ int main(int argc, char const *argv[]) {
     // clang-format off
     options.add_options("Program")
       ("o,out", "Output directory", co::value<fs::path>()->default_value(RESULTS_DIR "/" SECTION "/"))
+      ("format", "Format of the output tables: csv or npz", co::value<string>()->default_value("csv"))
       ("h,help", "Print this message")
       ("v,verbose", "Whether to be verbose", co::value<bool>());
     options.add_options("Rng seeding")
@@ -110,6 +134,9 @@ int main(int argc, char const *argv[]) {
       ("w,n_warmup", "Number of MCMC warmup steps", co::value<size_t>()->default_value("0"))
       ("metropolis", "Whether to sample using the Metropolis algorithm", co::value<bool>())
       ("gibbs", "Whether to sampler using the Gibbs algorithm", co::value<bool>())
+      ("target_error", "Stop as soon as the blocking analysis of the energy reaches this error (M becomes the maximum number of steps)", co::value<VarSpace>())
+      ("bootstrap", "Number of bootstrap replicas for the final errors, also estimated by the jackknife (none if not given)", co::value<size_t>())
+      ("threads", "Number of threads running the bootstrap replicas, each with its own random stream", co::value<size_t>())
       ("save_spins", "Whether to save the state of the Ising model", co::value<bool>())
       ("resume", "Whether to resume a previous run in the chosen output directory", co::value<bool>());
     // clang-format on
@@ -126,30 +153,35 @@ int main(int argc, char const *argv[]) {
     ExOptions<VarSpace> p(user_params);
 
     ARandom rng(SEEDS_SOURCE, PRIMES_SOURCE, PRIMES_LINE);
+    // One stream per bootstrap thread, from the lines of the primes file after the sampler's one
+    std::vector<ARandom> streams;
+    if (p.n_replicas > 0)
+        for (size_t thread = 0; thread < p.n_threads; thread++)
+            streams.emplace_back(SEEDS_SOURCE, PRIMES_SOURCE, PRIMES_LINE + 1 + thread);
     if (p.metropolis) {
         // The case in which the external field is globally set to 0 must be distinguished, otherwise
         // the output files will overwrite each other.
         if (p.h == 0)
             measure<SystemMetropolis<VarSpace>, decltype(rng), true, true, true, U_var, C_var,
-                    X_var, M_var>(p, 0., "metropolis", rng);
+                    X_var, M_var>(p, 0., "metropolis", rng, streams);
         else {
             // The computation of U, C and X only requires the evaluation of H and Sum_s2, hence Sum_s is disabled
             measure<SystemMetropolis<VarSpace>, decltype(rng), true, false, true, U_var, C_var,
-                    X_var>(p, 0., "metropolis", rng);
+                    X_var>(p, 0., "metropolis", rng, streams);
             // The computation of M only requires the evaluation of Sum_s, hence H and Sum_s2 are disabled
             measure<SystemMetropolis<VarSpace>, decltype(rng), false, true, false, M_var>(
-                    p, p.h, "metropolis", rng);
+                    p, p.h, "metropolis", rng, streams);
         }
     }
     if (p.gibbs) {
         if (p.h == 0)
             measure<SystemGibbs<VarSpace>, decltype(rng), true, true, true, U_var, C_var, X_var,
-                    M_var>(p, 0., "gibbs", rng);
+                    M_var>(p, 0., "gibbs", rng, streams);
         else {
             measure<SystemGibbs<VarSpace>, decltype(rng), true, false, true, U_var, C_var, X_var>(
-                    p, 0., "gibbs", rng);
-            measure<SystemGibbs<VarSpace>, decltype(rng), false, true, false, M_var>(p, p.h,
-                                                                                     "gibbs", rng);
+                    p, 0., "gibbs", rng, streams);
+            measure<SystemGibbs<VarSpace>, decltype(rng), false, true, false, M_var>(
+                    p, p.h, "gibbs", rng, streams);
         }
     }
     return 0;
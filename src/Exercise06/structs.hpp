@@ -8,11 +8,15 @@
 #include <algorithm>
 #include <cstddef>
 #include <filesystem>
+#include <stdexcept>
+#include <string>
 #include <valarray>
 #include <vector>
 
 #include <cxxopts.hpp>
 
+#include "tables.hpp"
+
 namespace fs = std::filesystem;
 
 /**
@@ -27,13 +31,23 @@ struct ExOptions {
           n_spins(pr["n_spins"].as<size_t>()), metropolis(pr["metropolis"].as<bool>()),
           gibbs(pr["gibbs"].as<bool>()), save_spins(pr["save_spins"].as<bool>()),
           resume(pr["resume"].as<bool>()), J(pr["J"].as<var_space>()), h(pr["B"].as<var_space>()),
-          T(pr["T"].as<var_space>()) {
+          T(pr["T"].as<var_space>()), format(tables::format_from(pr["format"].as<std::string>())),
+          target_error(pr.count("target_error") ? pr["target_error"].as<var_space>() : 0),
+          n_replicas(pr.count("bootstrap") ? pr["bootstrap"].as<size_t>() : 0),
+          n_threads(pr.count("threads") ? pr["threads"].as<size_t>() : 1) {
         assert(n_steps % block_size == 0);
+        if (n_replicas > 0 && n_threads == 0)
+            throw std::runtime_error("The bootstrap needs at least a thread");
     }
     fs::path output_dir;
     size_t n_steps, block_size, n_blocks{n_steps / block_size}, warmup_steps, n_spins;
     bool metropolis, gibbs, save_spins, resume;
     var_space J, h, T;
+    tables::Format format;
+    // Target error of the energy, stopping the sampling early (0 runs all the blocks)
+    var_space target_error;
+    // Bootstrap replicas for the final errors (0 skips resampling) and threads running them
+    size_t n_replicas, n_threads;
 };
 
 #endif//ESERCIZI_LSN_06_STRUCTS_HPP
@@ -1,3 +1,4 @@
+#include <chrono>
 #include <cmath>
 #include <filesystem>
 #include <iostream>
@@ -9,7 +10,10 @@
 
 #include "ariel_random/ariel_random.hpp"
 #include "config.hpp"
+#include "molecular_systems/data_types/async_writer.hpp"
+#include "molecular_systems/steppers/checkerboard_mc.hpp"
 #include "molecular_systems/steppers/collectors.hpp"
+#include "molecular_systems/steppers/hmc.hpp"
 #include "molecular_systems/steppers/mc.hpp"
 #include "molecular_systems/system.hpp"
 #include "options.hpp"
@@ -47,7 +51,13 @@ int main(int argc, char const *argv[]) {
       ("l,primes_line", "Line in primes_path to use", co::value<size_t>()->default_value("0"))
       ("s,seeds_path", "Seed path", co::value<string>()->default_value(""));
     options.add_options("Simulation")
-      ("N,save_every", "Save every N frames", co::value<size_t>()->default_value("0"));
+      ("N,save_every", "Save a frame of the trajectory every N steps (0 saves none)", co::value<size_t>()->default_value("0"))
+      ("t,threads", "Number of threads. More than one sweeps a checkerboard of cells in parallel, "
+                    "with a random stream per thread", co::value<size_t>()->default_value("1"))
+      ("hmc", "Hybrid Monte Carlo with trajectories of the given number of velocity Verlet steps "
+              "(0 uses single particle moves)", co::value<size_t>()->default_value("0"))
+      ("hmc_dt", "Time step of the hybrid Monte Carlo trajectories",
+                 co::value<double>()->default_value("0.005"));
     // clang-format on
     auto user_params = options.parse(argc, argv);
     if (user_params.count("help")) {
@@ -57,25 +67,64 @@ int main(int argc, char const *argv[]) {
 
     const size_t PRIMES_LINE = user_params["l"].as<size_t>();
     const string PRIMES_SOURCE = user_params["p"].as<string>();
+    const size_t THREADS = user_params["t"].as<size_t>();
+    const size_t HMC_STEPS = user_params["hmc"].as<size_t>();
+    const Value HMC_DT = user_params["hmc_dt"].as<double>();
     Ex2Options p(user_params);
 
     // Initializing the molecular system
-    auto rng = std::make_shared<ARandom>(p.rng_seed_path.string(), PRIMES_SOURCE, PRIMES_LINE);
-
     MCSystem system(p.settings_path, p.positions_path);
-    // Initializing the stepper, which evolves the system given a certain logic
-    ms_step::MC<Value, tail_corrections, ARandom> stepper(system.m_simulation.n_particles,
-                                                          system.m_simulation.delta, rng);
-    // Initializing the sampler, which performes instantaneous measurements while evolving the system
-    ms_step::StepSampler<decltype(stepper), VARIABLES> sampler(std::move(stepper));
-    // Performing the measurements
-    const Outs measures = sampler.sample(system, system.m_simulation.block_size);
+    // Frames are appended to a trajectory by a background thread every save_every steps
+    std::optional<TrajectoryWriter> trajectory;
+    if (p.save_every > 0)
+        trajectory.emplace(p.output_dir / "trajectory.bin", system.m_simulation.n_particles);
+    AsyncWriter<Value> writer(std::move(trajectory));
+    Outs measures;
+    double acceptance_rate;
+    const auto start = std::chrono::steady_clock::now();
+    if (HMC_STEPS > 0) {
+        auto rng =
+                std::make_shared<ARandom>(p.rng_seed_path.string(), PRIMES_SOURCE, PRIMES_LINE);
+        ms_step::HMC<Value, tail_corrections, ARandom> stepper(HMC_STEPS, HMC_DT, rng);
+        ms_step::StepSampler<decltype(stepper), VARIABLES> sampler(std::move(stepper));
+        measures = sampler.sample(system, system.m_simulation.block_size, p.save_every, writer);
+        rng->SaveSeed((p.output_dir / "rng.seed").string());
+        acceptance_rate = sampler.m_stepper.acceptance_rate();
+    } else if (THREADS > 1) {
+        // One stream per thread, from consecutive lines of the primes file
+        std::vector<ARandom> rngs;
+        for (size_t thread = 0; thread < THREADS; thread++)
+            rngs.emplace_back(p.rng_seed_path.string(), PRIMES_SOURCE, PRIMES_LINE + thread);
+        ms_step::CheckerboardMC<Value, tail_corrections, ARandom> stepper(
+                system.m_simulation, system.m_simulation.delta, std::move(rngs));
+        ms_step::StepSampler<decltype(stepper), VARIABLES> sampler(std::move(stepper));
+        measures = sampler.sample(system, system.m_simulation.block_size, p.save_every, writer);
+        // Saving the random seeds
+        const auto &streams = sampler.m_stepper.rngs();
+        streams[0].SaveSeed((p.output_dir / "rng.seed").string());
+        for (size_t thread = 1; thread < THREADS; thread++)
+            streams[thread].SaveSeed(
+                    (p.output_dir / ("rng" + std::to_string(thread) + ".seed")).string());
+        acceptance_rate = sampler.m_stepper.acceptance_rate();
+    } else {
+        auto rng =
+                std::make_shared<ARandom>(p.rng_seed_path.string(), PRIMES_SOURCE, PRIMES_LINE);
+        // Initializing the stepper, which evolves the system given a certain logic
+        ms_step::MC<Value, tail_corrections, ARandom> stepper(system.m_simulation.n_particles,
+                                                              system.m_simulation.delta, rng);
+        // Initializing the sampler, which performes instantaneous measurements while evolving the system
+        ms_step::StepSampler<decltype(stepper), VARIABLES> sampler(std::move(stepper));
+        // Performing the measurements
+        measures = sampler.sample(system, system.m_simulation.block_size, p.save_every, writer);
+        // Saving the random seed
+        rng->SaveSeed((p.output_dir / "rng.seed").string());
+        acceptance_rate = sampler.m_stepper.acceptance_rate();
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << acceptance_rate;
 
-    // Saving the final configuration...
+    // Saving the final configuration
     system.save_positions(p.output_positions);
-    // ... random seed ...
-    rng->SaveSeed((p.output_dir / "rng.seed").string());
-    std::cout << sampler.m_stepper.acceptance_rate();
     // ... and measurements results
     csv::Document table;
     table.InsertColumn(0, measures.get_measures<PotentialEnergy>(), "U/N");
@@ -85,5 +134,15 @@ int main(int argc, char const *argv[]) {
     table.InsertColumn(4, measures.get_measures<Pressure>(), "p");
     table.RemoveColumn(table.GetColumnCount() - 1);
     table.Save(p.output_dir / "thermo.csv");
+    // ... and what is needed to compare the statistical efficiency of the samplers
+    const auto u = measures.get_measures<PotentialEnergy>();
+    csv::Document efficiency;
+    efficiency.InsertColumn(0, std::vector<double>{acceptance_rate}, "acceptance");
+    efficiency.InsertColumn(
+            1, std::vector<double>{utils::integrated_autocorrelation_time(u.cbegin(), u.cend())},
+            "tau_U");
+    efficiency.InsertColumn(2, std::vector<double>{elapsed.count()}, "seconds");
+    efficiency.RemoveColumn(efficiency.GetColumnCount() - 1);
+    efficiency.Save(p.output_dir / "efficiency.csv");
     return 0;
 }
\ No newline at end of file
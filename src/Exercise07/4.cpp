@@ -11,6 +11,7 @@
 
 #include "ariel_random/ariel_random.hpp"
 #include "config.hpp"
+#include "molecular_systems/data_types/checkpoint.hpp"
 #include "molecular_systems/steppers/mc.hpp"
 #include "molecular_systems/steppers/md.hpp"
 #include "molecular_systems/system.hpp"
@@ -46,34 +47,54 @@ void warmup(System &system, Method m, Ex4Options &p, Stepper &&stepper) {
         system.save_positions(p.output_positions[m]);
 }
 
-template<class System, class Stepper>
-void take_measures(System &system, Method m, Ex4Options &p, Stepper &&stepper) {
-    system.init_radial_func(p.n_bins);
+template<class System, class Stepper, class URBG>
+void take_measures(System &system, Method m, Ex4Options &p, Stepper &&stepper, URBG &rng) {
+    // g(r) is accumulated by the system itself and normalized once per block
+    system.init_radial_sampling(p.n_bins, p.radial_stride);
 
-    auto estimators = std::make_tuple(ProgAvg<Value>(), ProgAvg<Value>(), ProgAvg<Value>(),
-                                      ProgAvg<Value>(), ProgAvg<std::vector<Value>>(p.n_bins));
+    auto estimators =
+            std::make_tuple(ProgAvg<Value>(), ProgAvg<Value>(), ProgAvg<Value>(), ProgAvg<Value>());
     ms_steppers::BlockStats<Stepper, decltype(estimators), Variable::PotentialEnergy,
-                            Variable::TotalEnergy, Variable::Temperature, Variable::Pressure,
-                            Variable::RadialFn>
+                            Variable::TotalEnergy, Variable::Temperature, Variable::Pressure>
             block_stats(std::forward<Stepper>(stepper), std::move(estimators),
                         system.m_simulation.block_size);
 
     std::array<std::vector<Value>, scalar_columns.size()> scalar_results;
-    for (size_t block = 0; block + 1 < system.m_simulation.n_blocks; block++) {
+    std::vector<ProgAvg<Value>> g_estimators(p.n_bins);
+    std::vector<Value> g_block, g_mean(p.n_bins), g_error(p.n_bins);
+    // Everything a restarted run needs to continue bit-identically, from the following block
+    const auto run_state = [&](auto &archive, size_t &next_block) {
+        archive.section(EXERCISE);
+        archive(system, block_stats, g_estimators, scalar_results, next_block);
+        archive.rng(rng);
+    };
+    size_t first_block = 0;
+    if (p.restart[m]) {
+        CheckpointReader checkpoint(p.input_checkpoint[m]);
+        run_state(checkpoint, first_block);
+    }
+    for (size_t block = first_block; block < system.m_simulation.n_blocks; block++) {
         const auto stats = utils::tuple_flatten(block_stats.statistics(system));
         utils::tuple_push_back(stats, scalar_results);
+        system.radial_block_average(g_block);
+        for (size_t bin = 0; bin < p.n_bins; bin++) {
+            const auto g_bin = std::next(g_block.cbegin(), static_cast<long>(bin));
+            std::tie(g_mean[bin], g_error[bin]) = g_estimators[bin](g_bin, std::next(g_bin));
+        }
+        CheckpointWriter checkpoint;
+        auto next_block = block + 1;
+        run_state(checkpoint, next_block);
+        checkpoint.save(p.output_checkpoint[m]);
     }
-    const auto stats = utils::tuple_flatten(block_stats.statistics(system));
-    utils::tuple_push_back(stats, scalar_results);
 
     csv::Document scalar_table;
     utils::AppendColumns(scalar_table, scalar_columns, scalar_results);
     scalar_table.Save(p.output_dir[m] / "thermo.csv");
 
     csv::Document g_r_table;
-    g_r_table.SetColumn(0, std::get<scalar_columns.size()>(stats));
+    g_r_table.SetColumn(0, g_mean);
     g_r_table.SetColumnName(0, "g_mean");
-    g_r_table.SetColumn(1, std::get<scalar_columns.size() + 1>(stats));
+    g_r_table.SetColumn(1, g_error);
     g_r_table.SetColumnName(1, "g_error");
     g_r_table.SetColumn(2, system.m_drs);
     g_r_table.SetColumnName(2, "r");
@@ -89,11 +110,13 @@ int main(int argc, char const *argv[]) {
       ("in_mc", "Directory where data used to launch the run with the MC sampler is stored."
                 "There must be at least a 'positions'"
                 "file with the molecules positions and a 'settings' file with the simulation settings."
-                "The presence of a 'velocities' file triggers a resume", co::value<fs::path>())
+                "The presence of a 'velocities' file triggers a resume, that of a 'checkpoint.bin' "
+                "file (written at the end of every measure block) a bit-identical restart", co::value<fs::path>())
       ("in_md", "Directory where data used to launch the run with the MD integrator is stored."
                 "There must be at least a 'positions'"
                 "file with the molecules positions and a 'settings' file with the simulation settings."
-                "The presence of a 'velocities' file triggers a resume", co::value<fs::path>())
+                "The presence of a 'velocities' file triggers a resume, that of a 'checkpoint.bin' "
+                "file (written at the end of every measure block) a bit-identical restart", co::value<fs::path>())
       ("mc_settings", "Path to the MC settings file, if not present in 'in_mc'.", co::value<string>()->default_value(""))
       ("md_settings", "Path to the MD settings file, if not present in 'in_md'.", co::value<string>()->default_value(""))
       ("h,help", "Print this message");
@@ -105,7 +128,14 @@ int main(int argc, char const *argv[]) {
       ("mc", "Whether to use the MC sampler", co::value<bool>())
       ("md", "Whether to use the MD sampler", co::value<bool>())
       ("warmup", "Whether it is a warmup or measure run", co::value<bool>())
-      ("n,n_bins", "Number of bins for the radial function histogram", co::value<size_t>()->default_value("10"));
+      ("cells", "Whether to look for interacting molecules using linked cells", co::value<bool>()->default_value("false"))
+      ("skin", "Skin of the Verlet neighbor list used by the MD integrator (0 disables it)", co::value<double>()->default_value("0"))
+      ("threads", "Number of threads evaluating forces and observables", co::value<size_t>()->default_value("1"))
+      ("n,n_bins", "Number of bins for the radial function histogram", co::value<size_t>()->default_value("10"))
+      ("g_stride", "Steps between two samples of the radial function", co::value<size_t>()->default_value("1"))
+      ("tune_blocks", "Number of blocks adapting the MC displacement toward the target acceptance rate "
+                      "before sampling (0 keeps it fixed)", co::value<size_t>()->default_value("0"))
+      ("target_acceptance", "Target acceptance rate of the MC displacement tuning", co::value<double>()->default_value("0.5"));
     // clang-format on
     auto user_params = options.parse(argc, argv);
     if (user_params.count("help")) {
@@ -123,15 +153,23 @@ int main(int argc, char const *argv[]) {
     auto m = Method::MC;
     if (p.sample[m]) {
         MCSystem mc_system(p.input_settings[m], p.input_positions[m]);
+        if (p.cells) mc_system.init_linked_cells();
+        mc_system.init_threads(p.n_threads);
         auto stepper = ms_steppers::MC<Value, tail_corrections, ARandom>(
                 mc_system.m_simulation.n_particles, mc_system.m_simulation.delta, rng);
+        if (p.tune_blocks > 0 && !p.restart[m]) {
+            // The displacement is frozen after tuning, before any sample is taken
+            const auto tuning = stepper.tune(mc_system, p.tune_blocks,
+                                             mc_system.m_simulation.block_size, p.target_acceptance);
+            samplers::mcmc::save_tuning(tuning, p.output_dir[m] / "tuning.csv");
+        }
         if (p.warmup) {
             warmup<true>(mc_system, m, p, std::move(stepper));
             //            std::cout << p.input_settings[m].string() << ": " << stepper.acceptance_rate()
             //                      << std::endl;
         } else {
             mc_system.init_velocities(*rng);
-            take_measures(mc_system, m, p, std::move(stepper));
+            take_measures(mc_system, m, p, std::move(stepper), *rng);
         }
         rng->SaveSeed((p.output_dir[m] / "rng.seed").string());
         mc_system.save_positions(p.output_positions[m]);
@@ -139,6 +177,9 @@ int main(int argc, char const *argv[]) {
     m = Method::MD;
     if (p.sample[m]) {
         MDSystem md_system(p.input_settings[m], p.input_positions[m]);
+        if (p.cells) md_system.init_linked_cells();
+        if (p.skin > 0) md_system.init_neighbor_list(p.skin);
+        md_system.init_threads(p.n_threads);
         if (p.resume[m]) {
             md_system.init_velocities(p.input_velocities);
         } else {
@@ -148,9 +189,12 @@ int main(int argc, char const *argv[]) {
         if (p.warmup) {
             warmup<false>(md_system, m, p, std::move(stepper));
         } else {
-            take_measures(md_system, m, p, std::move(stepper));
+            take_measures(md_system, m, p, std::move(stepper), *rng);
         }
         md_system.save_configurations(p.output_positions[m], p.output_velocities);
+        if (p.skin > 0)
+            std::cout << "Neighbor list rebuilds: " << md_system.neighbor_list_rebuilds() << " in "
+                      << md_system.time() << " steps" << std::endl;
     }
     return 0;
 }
\ No newline at end of file
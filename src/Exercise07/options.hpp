@@ -63,8 +63,11 @@ namespace ex07 {
         explicit Ex4Options(cxxopts::ParseResult &pr)
             : input_dir({pr["in_mc"].as<fs::path>(), pr["in_md"].as<fs::path>()}),
               output_dir({pr["out"].as<fs::path>() / tag(MC), pr["out"].as<fs::path>() / tag(MD)}),
-              n_bins(pr["n"].as<size_t>()), sample({pr["mc"].as<bool>(), pr["md"].as<bool>()}),
-              warmup(pr["warmup"].as<bool>()) {
+              n_bins(pr["n"].as<size_t>()), radial_stride(pr["g_stride"].as<size_t>()), sample({pr["mc"].as<bool>(), pr["md"].as<bool>()}),
+              warmup(pr["warmup"].as<bool>()), cells(pr["cells"].as<bool>()),
+              skin(pr["skin"].as<double>()), n_threads(pr["threads"].as<size_t>()),
+              tune_blocks(pr["tune_blocks"].as<size_t>()),
+              target_acceptance(pr["target_acceptance"].as<double>()) {
             for (auto m: {MC, MD}) {
                 const auto input = pr[tag(m) + "_settings"].as<std::string>();
                 input_settings[m] = input.empty() ? input_dir[m] / "input" : fs::path(input);
@@ -80,18 +83,33 @@ namespace ex07 {
             rng_seed_path = resume[MC] ? previous_seeds : fs::path(pr["s"].as<std::string>());
 
             resume[MD] = fs::exists(input_velocities);
+            for (auto m: {MC, MD}) restart[m] = !warmup && fs::exists(input_checkpoint[m]);
         }
 
         std::array<fs::path, 2> input_dir, input_settings{}, output_dir,
                 output_settings{output_dir[MC] / "input", output_dir[MD] / "input"},
                 input_positions{input_dir[MC] / "positions", input_dir[MD] / "positions"},
-                output_positions{output_dir[MC] / "positions", output_dir[MD] / "positions"};
+                output_positions{output_dir[MC] / "positions", output_dir[MD] / "positions"},
+                input_checkpoint{input_dir[MC] / "checkpoint.bin",
+                                 input_dir[MD] / "checkpoint.bin"},
+                output_checkpoint{output_dir[MC] / "checkpoint.bin",
+                                  output_dir[MD] / "checkpoint.bin"};
 
         fs::path input_velocities{input_dir[MD] / "velocities"},
                 output_velocities{output_dir[MD] / "velocities"}, rng_seed_path;
         size_t n_bins;
-        std::array<bool, 2> sample, resume{};
-        bool warmup;
+        // g(r) is sampled every radial_stride steps
+        size_t radial_stride;
+        // Whether a measure run restarts from a binary checkpoint
+        std::array<bool, 2> sample, resume{}, restart{};
+        bool warmup, cells;
+        // Verlet neighbor list skin (0 disables the list)
+        double skin;
+        // Threads used in the evaluation of forces and observables
+        size_t n_threads;
+        // Warmup blocks adapting the MC displacement (0 keeps it fixed), and their target
+        size_t tune_blocks;
+        double target_acceptance;
     };
 }// namespace ex07
 #endif//ESERCIZI_LSN_07_OPTS_HPP
@@ -27,7 +27,10 @@ int main(int /*argc*/, char ** /*argv[]*/) {
     Integrand<field> Hpsi(/*mu=*/1.1, /*sigma=*/1);
     Metropolis sampler(0, Trial<field>(/*mu=*/1, /*sigma=*/1),
                        UniformNear<prob_space, field>(/*radius=*/1));
-    sampler.warmup(10000, rng);
+    // Warmup adapting the transition radius toward a 50% acceptance rate
+    for (const auto &block: sampler.tune(/*n_blocks=*/10, /*block_size=*/1000, rng))
+        std::cout << "Warmup radius: " << block.width
+                  << "\tacceptance: " << block.acceptance_rate << '\n';
     Integrator<field, decltype(sampler)> I(std::move(sampler));
     const auto result = I(Hpsi, 10000, 1000, rng);
     std::cout << "Estimate: " << std::get<0>(result) << "\nUncertainty: " << std::get<1>(result)
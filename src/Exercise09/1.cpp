@@ -36,6 +36,7 @@ void set_options(cxxopts::Options &options) {
       ("i,in", "Path to the csv file of coordinates", co::value<fs::path>())
       ("crossover", "Which crossover algorithm(s) to use: 'ex' for the one proposed with the exercises, 'exmod' for that but modified, "
        "'my1' or 'my2' for my algorithms.", co::value<string>())
+      ("format", "Format of the output tables: csv or npz", co::value<string>()->default_value("csv"))
       ("h,help", "Print this message");
     options.add_options("Genetic")
       ("n,n_iter", "Number of iterations", co::value<size_t>()->default_value("5000"))
@@ -111,19 +112,13 @@ int main(int argc, char *argv[]) {
 
 
     auto [population, evaluations, coordinates, distances] = generate_and_run_gp(p.algo, p);
-    csv::Document table;
-    for (size_t i = 0; i < population.size(); i++) {
-        auto row = std::vector<size_t>(population[i].begin(), population[i].end());
-        row.insert(row.cbegin(), 0UL);
-        table.SetRow(i, row);
-    }
     std::for_each(evaluations.begin(), evaluations.end(), [](auto &val) { val = 1.0 / val; });
-    utils::AppendColumns(table, {"total_distance"}, std::make_tuple(evaluations));
-    table.Save(p.out_dir / (ex09::tag_from(p.algo) + ".csv"));
+    const auto table_path = p.out_dir / (ex09::tag_from(p.algo) + ".csv");
+    save_population(population, evaluations, table_path, p.format);
 
-    csv::Document dist_out;
-    utils::AppendColumns(dist_out, {"avg_distance"}, std::make_tuple(distances));
-    dist_out.Save(p.out_dir / (ex09::tag_from(p.algo) + "_stats.csv"));
+    tables::Table dist_out(p.out_dir / (ex09::tag_from(p.algo) + "_stats.csv"), p.format);
+    dist_out.add("avg_distance", distances);
+    dist_out.save();
 
     return 0;
 }
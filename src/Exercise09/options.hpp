@@ -11,6 +11,7 @@
 
 #include <cxxopts.hpp>
 
+#include "tables.hpp"
 #include "utils.hpp"
 
 namespace fs = std::filesystem;
@@ -38,7 +39,8 @@ namespace ex09 {
               seeds_path(pr["s"].as<std::string>()), primes_path(pr["p"].as<std::string>()),
               primes_line(pr["l"].as<size_t>()), n_iter(pr["n"].as<size_t>()),
               pop_size(pr["m"].as<size_t>()), mut_rate(pr["r"].as<double>()),
-              fusion_p(pr["f"].as<double>()), algo(algo_mapper[pr["crossover"].as<std::string>()]) {
+              fusion_p(pr["f"].as<double>()), algo(algo_mapper[pr["crossover"].as<std::string>()]),
+              format(tables::format_from(pr["format"].as<std::string>())) {
             if (!fs::exists(out_dir)) fs::create_directories(out_dir);
             utils::require_existence(in_path);
         }
@@ -48,6 +50,7 @@ namespace ex09 {
         const size_t primes_line, n_iter, pop_size;
         const double mut_rate, fusion_p;
         const CrossAlgo algo;
+        const tables::Format format;
     };
 }// namespace ex09
 
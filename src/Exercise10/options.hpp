@@ -11,6 +11,7 @@
 
 #include <cxxopts.hpp>
 
+#include "tables.hpp"
 #include "utils.hpp"
 
 namespace fs = std::filesystem;
@@ -43,7 +44,8 @@ namespace ex10 {
               primes_line(pr["l"].as<size_t>()), pop_size(pr["m"].as<size_t>()),
               migration_length(pr["migration_length"].as<size_t>()),
               n_migrations(pr["n_migrations"].as<size_t>()), mut_rate(pr["r"].as<double>()),
-              fusion_p(pr["f"].as<double>()), algo(algo_mapper[pr["crossover"].as<std::string>()]) {
+              fusion_p(pr["f"].as<double>()), algo(algo_mapper[pr["crossover"].as<std::string>()]),
+              format(tables::format_from(pr["format"].as<std::string>())) {
             if (!fs::exists(out_dir)) fs::create_directories(out_dir);
             utils::require_existence(in_path);
         }
@@ -53,6 +55,7 @@ namespace ex10 {
         const size_t primes_line, pop_size, migration_length, n_migrations;
         const double mut_rate, fusion_p;
         const CrossAlgo algo;
+        const tables::Format format;
     };
 }// namespace ex10
 
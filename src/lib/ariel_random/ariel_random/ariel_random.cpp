@@ -97,6 +97,25 @@ double ARandom ::Rannyu() {
 
 
 void ARandom::seed(ARandom::result_type s) { b10tob4096(s, &m_l1, &m_l2, &m_l3, &m_l4); }
+std::ostream &operator<<(std::ostream &out, const ARandom &rng) {
+    return out << rng.m_l1 << ' ' << rng.m_l2 << ' ' << rng.m_l3 << ' ' << rng.m_l4 << ' '
+               << rng.m_p3 << ' ' << rng.m_p4;
+}
+
+std::istream &operator>>(std::istream &in, ARandom &rng) {
+    ARandom::result_type state[6];
+    for (auto &digit: state) in >> digit;
+    if (in) {
+        rng.m_l1 = state[0];
+        rng.m_l2 = state[1];
+        rng.m_l3 = state[2];
+        rng.m_l4 = state[3];
+        rng.m_p3 = state[4];
+        rng.m_p4 = state[5];
+    }
+    return in;
+}
+
 void ARandom::save_seed(std::string_view path,
                         std::ios_base::openmode mode = std::ios_base::out) const {
     size_t s = b4096tob10(m_l1, m_l2, m_l3, m_l4);
@@ -15,7 +15,9 @@ _/    _/  _/_/_/  _/_/_/_/ email: Davide.Galli@unimi.it
 
 #include <cstddef>
 #include <fstream>
+#include <istream>
 #include <limits>
+#include <ostream>
 #include <string_view>
 
 /**
@@ -117,6 +119,13 @@ public:
     [[maybe_unused]] double Rannyu(double min, double max);
     [[maybe_unused]] double Gauss(double mean, double sigma);
 
+    /**
+     * Writes the full generator state (seed and least significant prime digits), as the standard
+     * engines do: reading it back with operator>> resumes the same sequence.
+     */
+    friend std::ostream &operator<<(std::ostream &out, const ARandom &rng);
+    friend std::istream &operator>>(std::istream &in, ARandom &rng);
+
 private:
     // multiplyer in base 2^12
     const result_type m_m1{502UL}, m_m2{1521UL}, m_m3{4071UL}, m_m4{2107UL};
@@ -0,0 +1,133 @@
+#ifndef ESERCIZI_LSN_ESTIMATORS_ACCUMULATORS_HPP
+#define ESERCIZI_LSN_ESTIMATORS_ACCUMULATORS_HPP
+
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+namespace estimators {
+    /**
+     * Combines the count, mean and sum of squared rejects of a series with those of another one
+     * into the moments of their concatenation (Chan, Golub and LeVeque's parallel update). The
+     * result does not depend on how a series was split, up to rounding: partial moments from
+     * threads, MPI ranks or independent chains can be reduced in any order and tree shape.
+     * @param count, mean, m2 Moments of the first series, updated in place.
+     * @param other_count, other_mean, other_m2 Moments of the second series.
+     */
+    template<typename value>
+    constexpr void merge_moments(size_t &count, value &mean, value &m2, size_t other_count,
+                                 value other_mean, value other_m2) {
+        if (other_count == 0) return;
+        const auto total = count + other_count;
+        const auto delta = other_mean - mean;
+        const auto weight = value(other_count) / value(total);
+        mean += delta * weight;
+        m2 += other_m2 + delta * delta * value(count) * weight;
+        count = total;
+    }
+
+    /**
+     * Online mean and variance of a series (Welford's algorithm): values are consumed one at a
+     * time in O(1) memory, with no cancellation between large sums of squares.
+     * @tparam value The numeric field to use.
+     */
+    template<typename value>
+    class Welford {
+    public:
+        /**
+         * Adds a value to the series.
+         * @param x The value.
+         */
+        constexpr void push(value x) {
+            m_count++;
+            const auto delta = x - m_mean;
+            m_mean += delta / value(m_count);
+            m_m2 += delta * (x - m_mean);
+        }
+
+        /**
+         * Adds the values accumulated by another instance, as if they had been pushed here.
+         * @param other The other accumulator.
+         * @return This accumulator.
+         */
+        constexpr Welford &merge(const Welford &other) {
+            merge_moments(m_count, m_mean, m_m2, other.m_count, other.m_mean, other.m_m2);
+            return *this;
+        }
+
+        constexpr void reset() {
+            m_count = 0;
+            m_mean = 0;
+            m_m2 = 0;
+        }
+
+        [[nodiscard]] constexpr size_t count() const noexcept { return m_count; }
+
+        // Sample average
+        [[nodiscard]] constexpr value mean() const noexcept { return m_mean; }
+
+        // Unbiased sample variance
+        [[nodiscard]] constexpr value variance() const noexcept {
+            return m_count > 1 ? m_m2 / value(m_count - 1) : value(0);
+        }
+
+        // Standard error of the mean, assuming uncorrelated values
+        [[nodiscard]] value error() const {
+            return m_count > 1 ? std::sqrt(variance() / value(m_count)) : value(0);
+        }
+
+    protected:
+        size_t m_count{0};
+        value m_mean{0};
+        // Sum of the squared rejects from the current mean
+        value m_m2{0};
+    };
+
+    /**
+     * Online means of vector-valued measures, e.g. the bins of a histogram, one accumulator per
+     * entry. The number of entries is fixed by the first push.
+     */
+    template<typename value>
+    class Welford<std::vector<value>> {
+        using v = std::vector<value>;
+
+    public:
+        void push(const v &x) {
+            if (m_bins.empty()) m_bins.resize(x.size());
+            for (size_t bin = 0; bin < x.size(); bin++) m_bins[bin].push(x[bin]);
+        }
+
+        Welford &merge(const Welford &other) {
+            if (other.m_bins.empty()) return *this;
+            if (m_bins.empty()) m_bins.resize(other.m_bins.size());
+            if (other.m_bins.size() != m_bins.size())
+                throw std::runtime_error("Cannot merge accumulators with different sizes");
+            for (size_t bin = 0; bin < m_bins.size(); bin++) m_bins[bin].merge(other.m_bins[bin]);
+            return *this;
+        }
+
+        void reset() { m_bins.clear(); }
+
+        [[nodiscard]] size_t count() const noexcept {
+            return m_bins.empty() ? 0 : m_bins.front().count();
+        }
+
+        [[nodiscard]] v mean() const {
+            v out(m_bins.size());
+            for (size_t bin = 0; bin < m_bins.size(); bin++) out[bin] = m_bins[bin].mean();
+            return out;
+        }
+
+        [[nodiscard]] v error() const {
+            v out(m_bins.size());
+            for (size_t bin = 0; bin < m_bins.size(); bin++) out[bin] = m_bins[bin].error();
+            return out;
+        }
+
+    private:
+        std::vector<Welford<value>> m_bins{};
+    };
+}// namespace estimators
+
+#endif//ESERCIZI_LSN_ESTIMATORS_ACCUMULATORS_HPP
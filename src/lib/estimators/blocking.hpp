@@ -0,0 +1,187 @@
+#ifndef ESERCIZI_LSN_ESTIMATORS_BLOCKING_HPP
+#define ESERCIZI_LSN_ESTIMATORS_BLOCKING_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+namespace estimators {
+    /**
+     * Blocking analysis of a correlated series (Flyvbjerg and Petersen), computed online. Values are
+     * averaged in pairs, the pairs in pairs again and so on: level k holds the averages of blocks of
+     * 2^k values, whose spread gives the error of the mean as if the series were made of blocks of
+     * that length. The error grows with the block length until the blocks become uncorrelated and
+     * then stays on a plateau, which is the actual error. The plateau is found with Jonsson's test
+     * (Phys. Rev. E 98, 043304): the first level from which the lag-1 autocorrelations of the blocks
+     * are compatible with zero. Memory is O(log T) for T values, and the block length need not be
+     * guessed in advance.
+     * @tparam value The numeric field to use.
+     */
+    template<typename value>
+    class Blocking {
+    public:
+        // Error estimate from blocks of a given length
+        struct Level {
+            size_t block_size, n_blocks;
+            // Error of the mean, and its own uncertainty
+            value error, error_error;
+        };
+
+        /**
+         * Constructor.
+         * @param min_blocks Levels with fewer blocks are too noisy to be used.
+         */
+        explicit Blocking(size_t min_blocks = 16) : m_min_blocks(min_blocks) {}
+
+        /**
+         * Adds a value to the series. Amortized O(1).
+         * @param x The value.
+         */
+        void push(value x) {
+            for (size_t level = 0;; level++) {
+                if (level == m_levels.size()) m_levels.emplace_back();
+                auto &current = m_levels[level];
+                current.push(x);
+                if (!current.pending) {
+                    current.partial = x;
+                    current.pending = true;
+                    return;
+                }
+                // A block of the next level is complete
+                x = (current.partial + x) / value(2);
+                current.pending = false;
+            }
+        }
+
+        void reset() { m_levels.clear(); }
+
+        [[nodiscard]] size_t count() const noexcept {
+            return m_levels.empty() ? 0 : m_levels.front().n;
+        }
+
+        [[nodiscard]] value mean() const {
+            return m_levels.empty() ? value(0) : m_levels.front().mean();
+        }
+
+        /**
+         * Error of the mean versus block length, from single values up to the longest blocks.
+         */
+        [[nodiscard]] std::vector<Level> levels() const {
+            std::vector<Level> out;
+            for (size_t level = 0; level < m_levels.size() && m_levels[level].n > 1; level++) {
+                const auto n = m_levels[level].n;
+                const auto error = std::sqrt(m_levels[level].variance() / value(n - 1));
+                out.push_back({size_t(1) << level, n, error,
+                               error / std::sqrt(value(2 * (n - 1)))});
+            }
+            return out;
+        }
+
+        /**
+         * First level of the plateau, empty if the series is too short to find it. Among the levels
+         * with at least min_blocks blocks, it is the first one from which the statistic
+         * M = sum_k n_k (gamma_k / sigma_k^2)^2 of the lag-1 autocovariances gamma_k is below the
+         * 99% quantile of its chi^2 distribution.
+         */
+        [[nodiscard]] std::optional<size_t> plateau() const {
+            size_t usable = 0;
+            while (usable < m_levels.size() && m_levels[usable].n >= m_min_blocks) usable++;
+            std::vector<value> m(usable + 1, value(0));
+            for (size_t level = usable; level-- > 0;) {
+                const auto &current = m_levels[level];
+                const auto variance = current.variance();
+                const auto rho = variance > value(0) ? current.autocovariance() / variance
+                                                     : value(0);
+                m[level] = m[level + 1] + value(current.n) * rho * rho;
+            }
+            for (size_t level = 0; level < usable; level++)
+                if (m[level] < chi2_quantile(usable - level)) return level;
+            return std::nullopt;
+        }
+
+        /**
+         * Error of the mean: the plateau value if one was found, otherwise that of the longest
+         * usable blocks, which underestimates it.
+         */
+        [[nodiscard]] value error() const {
+            const auto all = levels();
+            if (all.empty()) return value(0);
+            if (const auto level = plateau()) return all[*level].error;
+            size_t longest = 0;
+            while (longest + 1 < all.size() && all[longest + 1].n_blocks >= m_min_blocks)
+                longest++;
+            return all[longest].error;
+        }
+
+        /**
+         * Integrated autocorrelation time tau, in steps, from the ratio between the error and the
+         * one of uncorrelated values: sigma^2 = 2 tau sigma_0^2 (tau = 1/2 without correlations).
+         */
+        [[nodiscard]] value tau() const {
+            const auto all = levels();
+            if (all.empty() || all.front().error == value(0)) return value(0.5);
+            const auto ratio = error() / all.front().error;
+            return ratio * ratio / value(2);
+        }
+
+        /**
+         * Whether the plateau was reached with an error within the target: a run can stop here.
+         * @param target_error Target error of the mean.
+         */
+        [[nodiscard]] bool reached(value target_error) const {
+            return plateau().has_value() && error() <= target_error;
+        }
+
+    private:
+        // Block averages of a level, shifted by the first one against cancellations
+        struct Accumulator {
+            size_t n{0};
+            value shift{0}, sum{0}, sum2{0}, lag_sum{0}, first{0}, last{0};
+            // First half of the next block of the following level
+            value partial{0};
+            bool pending{false};
+
+            void push(value x) {
+                if (n == 0) shift = x;
+                const auto y = x - shift;
+                if (n == 0) first = y;
+                else
+                    lag_sum += last * y;
+                last = y;
+                sum += y;
+                sum2 += y * y;
+                n++;
+            }
+
+            [[nodiscard]] value mean() const { return shift + sum / value(n); }
+
+            // Biased variance, (1 / n) sum_i (y_i - <y>)^2
+            [[nodiscard]] value variance() const {
+                const auto avg = sum / value(n);
+                return std::max(sum2 / value(n) - avg * avg, value(0));
+            }
+
+            // Lag-1 autocovariance, (1 / n) sum_i (y_i - <y>)(y_i+1 - <y>)
+            [[nodiscard]] value autocovariance() const {
+                const auto avg = sum / value(n);
+                return (lag_sum - avg * (2 * sum - first - last) + value(n - 1) * avg * avg) /
+                       value(n);
+            }
+        };
+
+        // 99% quantile of the chi^2 distribution (Wilson-Hilferty approximation)
+        static value chi2_quantile(size_t dof) {
+            const auto k = value(dof);
+            const auto c = value(2) / (value(9) * k);
+            const auto z = value(2.3263478740408408);
+            return k * std::pow(value(1) - c + z * std::sqrt(c), 3);
+        }
+
+        size_t m_min_blocks;
+        std::vector<Accumulator> m_levels{};
+    };
+}// namespace estimators
+
+#endif//ESERCIZI_LSN_ESTIMATORS_BLOCKING_HPP
@@ -9,9 +9,11 @@
 #include <functional>
 #include <iterator>
 #include <numeric>
+#include <stdexcept>
 #include <utility>
 #include <vector>
 
+#include "accumulators.hpp"
 #include "utils.hpp"
 
 namespace estimators {
@@ -64,36 +66,65 @@ namespace estimators {
          */
         template<typename It>
         constexpr Output operator()(It first, It last) {
-            m_current_block++;
             // TODO: if (block_size == 0)...
-            const auto block_avg = utils::average<value>(first, last);
-            m_running_sum += block_avg;
-            m_running_sum2 += block_avg * block_avg;
-            // <A>
-            const auto mean_estimate = m_running_sum / static_cast<value>(m_current_block);
+            return push_block(utils::average<value>(first, last));
+        }
 
-            if (m_current_block == 1) { return {mean_estimate, value(0)}; }
+        /**
+         * As operator(), from the block average alone, e.g. one accumulated online.
+         * @param block_avg Average of the block.
+         * @return Pair (estimate, uncertainty)
+         */
+        constexpr Output push_block(value block_avg) {
+            merge_moments(m_current_block, m_mean, m_m2, size_t(1), block_avg, value(0));
+            return estimate();
+        }
+
+        /**
+         * Estimate from the blocks seen so far, e.g. after merging, without adding any.
+         * @return Pair (estimate, uncertainty)
+         */
+        [[nodiscard]] constexpr Output estimate() const {
+            if (m_current_block < 2) { return {m_mean, value(0)}; }
+            // Variance of the block averages over the number of blocks
+            const value estimator_variance = m_m2 / value(m_current_block) /
+                                             value(m_current_block - 1);
+            return {m_mean, std::sqrt(estimator_variance)};
+        }
 
-            // <A^2>
-            const auto square_mean_estimate = m_running_sum2 / static_cast<value>(m_current_block);
-            const value estimator_variance =
-                    (square_mean_estimate - mean_estimate * mean_estimate) /
-                    static_cast<value>(m_current_block - 1);
-            return {mean_estimate, std::sqrt(estimator_variance)};
+        /**
+         * Adds the blocks of another estimator, e.g. one fed by another thread, MPI rank or
+         * independent chain, as if they had been pushed to this one (see merge_moments).
+         * @param other The other estimator.
+         * @return This estimator.
+         */
+        constexpr ProgAvg &merge(const ProgAvg &other) {
+            merge_moments(m_current_block, m_mean, m_m2, other.m_current_block, other.m_mean,
+                          other.m_m2);
+            return *this;
         }
 
         void reset() {
             m_current_block = 0;
-            m_running_sum = 0;
-            m_running_sum2 = 0;
+            m_mean = 0;
+            m_m2 = 0;
+        }
+
+        /**
+         * Stores or restores the accumulated blocks (see CheckpointArchive).
+         * @param archive A checkpoint writer or reader.
+         */
+        template<class Archive>
+        void checkpoint(Archive &archive) {
+            archive(m_current_block, m_mean, m_m2);
         }
 
     protected:
         // Index of the currently processed block
         size_t m_current_block{0};
-        // Accumulators for the sample average sum and sum^2
-        value m_running_sum{0};
-        value m_running_sum2{0};
+        // Average of the block averages and sum of their squared rejects from it
+        value m_mean{0};
+        value m_m2{0};
     };
 
     template<typename value>
@@ -131,6 +162,45 @@ namespace estimators {
             return out;
         }
 
+        /**
+         * As operator(), from the block averages of the bins.
+         * @param block_avg Averages of the block, one per bin.
+         */
+        Output push_block(const v &block_avg) {
+            Output out{};
+            utils::tuple_apply([=](auto &vec) { vec.reserve(m_estimators.size()); }, out);
+            for (size_t bin_idx = 0; bin_idx < block_avg.size(); bin_idx++) {
+                utils::tuple_push_back(m_estimators[bin_idx].push_block(block_avg[bin_idx]), out);
+            }
+            return out;
+        }
+
+        Output estimate() const {
+            Output out{};
+            utils::tuple_apply([=](auto &vec) { vec.reserve(m_estimators.size()); }, out);
+            for (const auto &estimator: m_estimators)
+                utils::tuple_push_back(estimator.estimate(), out);
+            return out;
+        }
+
+        /**
+         * Merges the estimators of the bins one by one.
+         * @param other Estimator with the same number of bins.
+         */
+        ProgAvg &merge(const ProgAvg &other) {
+            if (other.m_estimators.size() != m_estimators.size())
+                throw std::runtime_error("Cannot merge estimators with different numbers of bins");
+            for (size_t bin_idx = 0; bin_idx < m_estimators.size(); bin_idx++)
+                m_estimators[bin_idx].merge(other.m_estimators[bin_idx]);
+            return *this;
+        }
+
+        template<class Archive>
+        void checkpoint(Archive &archive) {
+            archive.expect(m_estimators.size(), "number of bins");
+            for (auto &estimator: m_estimators) estimator.checkpoint(archive);
+        }
+
     private:
         std::vector<ProgAvg<value>> m_estimators;
     };
@@ -151,36 +221,69 @@ namespace estimators {
          */
         template<typename It>
         constexpr Output operator()(It first, It last) {
-            m_current_block++;
             // TODO: if (block_size == 0)...
-            const auto block_avg = utils::average<value>(first, last);
-            m_running_sum += block_avg;
-            m_running_sum2 += block_avg * block_avg;
-            // <A>
-            const auto mean_estimate = m_running_sum / value(m_current_block);
+            return push_block(utils::average<value>(first, last));
+        }
 
-            if (m_current_block == 1) { return {block_avg, mean_estimate, value(0)}; }
+        /**
+         * As operator(), from the block average alone, e.g. one accumulated online.
+         * @param block_avg Average of the block.
+         * @return Tuple (sample average, progressive estimate, uncertainty)
+         */
+        constexpr Output push_block(value block_avg) {
+            m_last_block = block_avg;
+            merge_moments(m_current_block, m_mean, m_m2, size_t(1), block_avg, value(0));
+            return estimate();
+        }
 
-            // <A^2>
-            const auto square_mean_estimate = m_running_sum2 / value(m_current_block);
-            const value estimator_variance =
-                    (square_mean_estimate - mean_estimate * mean_estimate) /
-                    value(m_current_block - 1);
-            return {block_avg, mean_estimate, std::sqrt(estimator_variance)};
+        /**
+         * Estimate from the blocks seen so far, e.g. after merging, without adding any.
+         * @return Tuple (last sample average, progressive estimate, uncertainty)
+         */
+        [[nodiscard]] constexpr Output estimate() const {
+            if (m_current_block < 2) { return {m_last_block, m_mean, value(0)}; }
+            const value estimator_variance = m_m2 / value(m_current_block) /
+                                             value(m_current_block - 1);
+            return {m_last_block, m_mean, std::sqrt(estimator_variance)};
+        }
+
+        /**
+         * Adds the blocks of another estimator as if they had been pushed to this one after its
+         * own: its last sample average, if any, becomes the current one (see merge_moments).
+         * @param other The other estimator.
+         * @return This estimator.
+         */
+        constexpr SampleProgAvg &merge(const SampleProgAvg &other) {
+            if (other.m_current_block > 0) m_last_block = other.m_last_block;
+            merge_moments(m_current_block, m_mean, m_m2, other.m_current_block, other.m_mean,
+                          other.m_m2);
+            return *this;
         }
 
         void reset() {
             m_current_block = 0;
-            m_running_sum = 0;
-            m_running_sum2 = 0;
+            m_mean = 0;
+            m_m2 = 0;
+            m_last_block = 0;
+        }
+
+        /**
+         * Stores or restores the accumulated blocks (see CheckpointArchive).
+         * @param archive A checkpoint writer or reader.
+         */
+        template<class Archive>
+        void checkpoint(Archive &archive) {
+            archive(m_current_block, m_mean, m_m2, m_last_block);
         }
 
     protected:
         // Index of the currently processed block
         size_t m_current_block{0};
-        // Accumulators for the sample average sum and sum^2
-        value m_running_sum{0};
-        value m_running_sum2{0};
+        // Average of the block averages and sum of their squared rejects from it
+        value m_mean{0};
+        value m_m2{0};
+        // Average of the last block
+        value m_last_block{0};
     };
 
 
@@ -207,6 +310,45 @@ namespace estimators {
             return out;
         }
 
+        /**
+         * As operator(), from the block averages of the bins.
+         * @param block_avg Averages of the block, one per bin.
+         */
+        Output push_block(const v &block_avg) {
+            Output out{};
+            utils::tuple_apply([=](auto &vec) { vec.reserve(m_estimators.size()); }, out);
+            for (size_t bin_idx = 0; bin_idx < block_avg.size(); bin_idx++) {
+                utils::tuple_push_back(m_estimators[bin_idx].push_block(block_avg[bin_idx]), out);
+            }
+            return out;
+        }
+
+        Output estimate() const {
+            Output out{};
+            utils::tuple_apply([=](auto &vec) { vec.reserve(m_estimators.size()); }, out);
+            for (const auto &estimator: m_estimators)
+                utils::tuple_push_back(estimator.estimate(), out);
+            return out;
+        }
+
+        /**
+         * Merges the estimators of the bins one by one.
+         * @param other Estimator with the same number of bins.
+         */
+        SampleProgAvg &merge(const SampleProgAvg &other) {
+            if (other.m_estimators.size() != m_estimators.size())
+                throw std::runtime_error("Cannot merge estimators with different numbers of bins");
+            for (size_t bin_idx = 0; bin_idx < m_estimators.size(); bin_idx++)
+                m_estimators[bin_idx].merge(other.m_estimators[bin_idx]);
+            return *this;
+        }
+
+        template<class Archive>
+        void checkpoint(Archive &archive) {
+            archive.expect(m_estimators.size(), "number of bins");
+            for (auto &estimator: m_estimators) estimator.checkpoint(archive);
+        }
+
     private:
         std::vector<SampleProgAvg<value>> m_estimators;
     };
@@ -0,0 +1,145 @@
+#ifndef ESERCIZI_LSN_ESTIMATORS_RESAMPLING_HPP
+#define ESERCIZI_LSN_ESTIMATORS_RESAMPLING_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "accumulators.hpp"
+#include "distributions/uniform_int.hpp"
+#include "utils.hpp"
+
+namespace estimators {
+    /**
+     * Jackknife and bootstrap errors of nonlinear functions of the means of several observables,
+     * e.g. the heat capacity beta^2 (<H^2> - <H>^2) / N from the block averages of H and H^2.
+     * Propagating the errors of the single means would neglect their correlations and the bias of
+     * the function; resampling the blocks accounts for both, as long as the blocks are longer than
+     * the autocorrelation time. Block averages of all observables are stored, one row per block.
+     * @tparam value The numeric field to use.
+     */
+    template<typename value>
+    class Resampling {
+    public:
+        // Estimate f(means), its error and its bias
+        typedef std::tuple<value, value, value> Output;
+
+        /**
+         * Constructor.
+         * @param n_observables Number of block averages per block.
+         */
+        explicit Resampling(size_t n_observables) : m_n_observables(n_observables) {}
+
+        /**
+         * Adds a block.
+         * @param block_avgs Block averages of the observables.
+         */
+        void push_block(const std::vector<value> &block_avgs) {
+            if (block_avgs.size() != m_n_observables)
+                throw std::runtime_error("Expected " + std::to_string(m_n_observables) +
+                                         " block averages, got " +
+                                         std::to_string(block_avgs.size()));
+            m_blocks.insert(m_blocks.end(), block_avgs.cbegin(), block_avgs.cend());
+        }
+
+        void reset() { m_blocks.clear(); }
+
+        [[nodiscard]] size_t n_blocks() const noexcept {
+            return m_n_observables == 0 ? 0 : m_blocks.size() / m_n_observables;
+        }
+
+        [[nodiscard]] size_t n_observables() const noexcept { return m_n_observables; }
+
+        // Means of the observables over all the blocks
+        [[nodiscard]] std::vector<value> means() const {
+            auto out = sums();
+            for (auto &mean: out) mean /= value(n_blocks());
+            return out;
+        }
+
+        /**
+         * Jackknife estimate: f is evaluated on the means without one block at a time, and the
+         * spread of these values gives the error, their shift from f(means) the bias. Costs
+         * n_blocks evaluations of f.
+         * @param f Function of the vector of means.
+         * @return Tuple (f(means), error, bias); f(means) - bias is the bias-corrected estimate.
+         */
+        template<class F>
+        Output jackknife(F f) const {
+            const auto n = n_blocks();
+            if (n < 2) throw std::runtime_error("The jackknife needs at least 2 blocks");
+            const auto total = sums();
+            std::vector<value> means(m_n_observables);
+            Welford<value> leave_one_out;
+            for (size_t block = 0; block < n; block++) {
+                for (size_t k = 0; k < m_n_observables; k++)
+                    means[k] = (total[k] - m_blocks[block * m_n_observables + k]) / value(n - 1);
+                leave_one_out.push(f(means));
+            }
+            const auto estimate = f(this->means());
+            // sum_i (f_i - <f_i>)^2
+            const auto spread = leave_one_out.variance() * value(n - 1);
+            return {estimate, std::sqrt(spread * value(n - 1) / value(n)),
+                    value(n - 1) * (leave_one_out.mean() - estimate)};
+        }
+
+        /**
+         * Bootstrap estimate: f is evaluated on the means of n_blocks blocks drawn with
+         * replacement, n_replicas times; the spread of these values gives the error, their shift
+         * from f(means) the bias. Replicas are split among rngs.size() threads, thread t computing
+         * replicas t, t + rngs.size(), ... with rngs[t]: results only depend on the generators'
+         * streams, not on scheduling. f is called concurrently; if it throws, the exception is
+         * rethrown here once every thread has stopped.
+         * @param f Function of the vector of means.
+         * @param n_replicas Number of bootstrap replicas.
+         * @param rngs One random number generator per thread, with independent streams.
+         * @return Tuple (f(means), error, bias).
+         */
+        template<class F, class URBG>
+        Output bootstrap(F f, size_t n_replicas, std::vector<URBG> &rngs) const {
+            const auto n = n_blocks();
+            if (n == 0) throw std::runtime_error("The bootstrap needs at least a block");
+            if (rngs.empty()) throw std::runtime_error("At least a random generator is needed");
+            const auto n_threads = rngs.size();
+            std::vector<Welford<value>> replicas(n_threads);
+            utils::parallel_for(n_threads, [&](size_t thread) {
+                auto &rng = rngs[thread];
+                distributions::uniform_int<size_t> pick(0, n - 1);
+                std::vector<value> means(m_n_observables);
+                for (size_t replica = thread; replica < n_replicas; replica += n_threads) {
+                    std::fill(means.begin(), means.end(), value(0));
+                    for (size_t draw = 0; draw < n; draw++) {
+                        const auto *block = m_blocks.data() + pick(rng) * m_n_observables;
+                        for (size_t k = 0; k < m_n_observables; k++) means[k] += block[k];
+                    }
+                    for (auto &mean: means) mean /= value(n);
+                    replicas[thread].push(f(means));
+                }
+            });
+            // Partial results are merged in a fixed order
+            for (size_t thread = 1; thread < n_threads; thread++)
+                replicas.front().merge(replicas[thread]);
+            const auto estimate = f(means());
+            return {estimate, std::sqrt(replicas.front().variance()),
+                    replicas.front().mean() - estimate};
+        }
+
+    private:
+        // Sums of the block averages of each observable
+        [[nodiscard]] std::vector<value> sums() const {
+            std::vector<value> out(m_n_observables, value(0));
+            for (size_t i = 0; i < m_blocks.size(); i++) out[i % m_n_observables] += m_blocks[i];
+            return out;
+        }
+
+        size_t m_n_observables;
+        // Block averages, one row per block
+        std::vector<value> m_blocks{};
+    };
+}// namespace estimators
+
+#endif//ESERCIZI_LSN_ESTIMATORS_RESAMPLING_HPP
@@ -47,6 +47,27 @@ namespace estimators {
             return m_mean_estimator(m_rejects2.cbegin(), m_rejects2.cend());
         }
 
+        /**
+         * Estimate from the blocks seen so far, e.g. after merging, without adding any.
+         * @return Pair (estimate, uncertainty)
+         */
+        [[nodiscard]] constexpr Output estimate() const { return m_mean_estimator.estimate(); }
+
+        /**
+         * Adds the blocks of another estimator, e.g. one fed by another thread, MPI rank or
+         * independent chain. The rejects of each block were taken from the mean estimated by
+         * the estimator it was pushed to, so the result matches a sequential run only up to
+         * fluctuations of that mean, which vanish as the blocks grow.
+         * @param other The other estimator.
+         * @return This estimator.
+         */
+        constexpr ProgVariance &merge(const ProgVariance &other) {
+            m_current_block += other.m_current_block;
+            m_running_mean_sum += other.m_running_mean_sum;
+            m_mean_estimator.merge(other.m_mean_estimator);
+            return *this;
+        }
+
     private:
         size_t m_current_block{0};
         ProgAvg<value> m_mean_estimator{};
@@ -0,0 +1,125 @@
+#ifndef ESERCIZI_LSN_FFT_HPP
+#define ESERCIZI_LSN_FFT_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace fft {
+    // Smallest power of 2 not below n
+    inline size_t next_pow2(size_t n) {
+        size_t size = 1;
+        while (size < n) size <<= 1;
+        return size;
+    }
+
+    /**
+     * In-place radix-2 fast Fourier transform, X_k = sum_n x_n exp(-+2 pi i k n / N).
+     * @param data Sequence of complex values, whose size must be a power of 2.
+     * @param inverse Whether to compute the inverse transform (without the 1/N factor).
+     */
+    template<typename real>
+    void transform(std::vector<std::complex<real>> &data, bool inverse = false) {
+        const auto n = data.size();
+        // Bit-reversal permutation
+        for (size_t i = 1, j = 0; i < n; i++) {
+            size_t bit = n >> 1;
+            for (; j & bit; bit >>= 1) j ^= bit;
+            j ^= bit;
+            if (i < j) std::swap(data[i], data[j]);
+        }
+        // Twiddle factors, computed once rather than by recurrence, which would lose accuracy
+        const auto pi = std::acos(real(-1));
+        std::vector<std::complex<real>> twiddles(n / 2);
+        for (size_t k = 0; k < n / 2; k++) {
+            const auto angle = (inverse ? 2 : -2) * pi * real(k) / real(n);
+            twiddles[k] = {std::cos(angle), std::sin(angle)};
+        }
+        for (size_t length = 2; length <= n; length <<= 1) {
+            const auto stride = n / length;
+            for (size_t start = 0; start < n; start += length) {
+                for (size_t k = 0; k < length / 2; k++) {
+                    const auto even = data[start + k];
+                    const auto odd = data[start + k + length / 2] * twiddles[k * stride];
+                    data[start + k] = even + odd;
+                    data[start + k + length / 2] = even - odd;
+                }
+            }
+        }
+    }
+
+    /**
+     * Transform of a real sequence, packed into a complex one of half the size.
+     * @param x Real sequence, whose size must be a power of 2 (at least 2).
+     * @return X_k for k = 0, ..., N / 2; the others follow from X_(N-k) = conj(X_k).
+     */
+    template<typename real>
+    std::vector<std::complex<real>> forward_real(const std::vector<real> &x) {
+        const auto half = x.size() / 2;
+        std::vector<std::complex<real>> z(half);
+        for (size_t n = 0; n < half; n++) z[n] = {x[2 * n], x[2 * n + 1]};
+        transform(z);
+        const auto pi = std::acos(real(-1));
+        std::vector<std::complex<real>> out(half + 1);
+        for (size_t k = 0; k <= half; k++) {
+            const auto zk = z[k % half], zc = std::conj(z[(half - k) % half]);
+            const auto even = (zk + zc) / real(2);
+            const auto odd = (zk - zc) * std::complex<real>(0, real(-0.5));
+            const auto angle = -pi * real(k) / real(half);
+            out[k] = even + std::complex<real>(std::cos(angle), std::sin(angle)) * odd;
+        }
+        return out;
+    }
+
+    /**
+     * Inverse of forward_real, 1/N factor included.
+     * @param spectrum X_k for k = 0, ..., N / 2.
+     * @return The real sequence of size N.
+     */
+    template<typename real>
+    std::vector<real> inverse_real(const std::vector<std::complex<real>> &spectrum) {
+        const auto half = spectrum.size() - 1;
+        const auto pi = std::acos(real(-1));
+        std::vector<std::complex<real>> z(half);
+        for (size_t k = 0; k < half; k++) {
+            const auto xk = spectrum[k], xc = std::conj(spectrum[half - k]);
+            const auto even = (xk + xc) / real(2);
+            const auto angle = pi * real(k) / real(half);
+            const auto odd =
+                    (xk - xc) / real(2) * std::complex<real>(std::cos(angle), std::sin(angle));
+            z[k] = even + std::complex<real>(0, 1) * odd;
+        }
+        transform(z, true);
+        std::vector<real> x(2 * half);
+        for (size_t n = 0; n < half; n++) {
+            x[2 * n] = z[n].real() / real(half);
+            x[2 * n + 1] = z[n].imag() / real(half);
+        }
+        return x;
+    }
+
+    /**
+     * Autocovariance sums c_t = sum_i y_i y_(i+t) of a sequence through the Wiener-Khinchin theorem,
+     * in O(T log T): the sequence is zero-padded so that the circular correlation does not wrap
+     * around within the requested lags.
+     * @param y The sequence, usually the rejects from its mean.
+     * @param n_lags Number of lags, at most y.size().
+     * @return c_t for t = 0, ..., n_lags - 1.
+     */
+    template<typename real>
+    std::vector<real> autocovariance(const std::vector<real> &y, size_t n_lags) {
+        const auto size = next_pow2(std::max<size_t>(y.size() + n_lags, 2));
+        std::vector<real> padded(size, real(0));
+        std::copy(y.cbegin(), y.cend(), padded.begin());
+        auto spectrum = forward_real(padded);
+        for (auto &xk: spectrum) xk = std::norm(xk);
+        auto c = inverse_real(spectrum);
+        c.resize(n_lags);
+        return c;
+    }
+}// namespace fft
+
+#endif//ESERCIZI_LSN_FFT_HPP
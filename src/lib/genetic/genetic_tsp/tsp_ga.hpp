@@ -10,6 +10,8 @@
 #include <array>
 #include <numeric>
 #include <random>
+#include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 
@@ -201,4 +203,38 @@ private:
     }
 };
 
+/**
+ * Stores a population of paths, one row per individual with the fixed first city included, followed
+ * by a column of total distances. As npz, column c holds the c-th city of every path.
+ * @param population Individuals, all of the same size.
+ * @param distances Total distance of each individual.
+ * @param path Output path.
+ * @param format Table format.
+ */
+template<class Population>
+void save_population(const Population &population, const std::vector<double> &distances,
+                     const fs::path &path, tables::Format format) {
+    if (format == tables::Format::Csv) {
+        csv::Document table;
+        for (size_t i = 0; i < population.size(); i++) {
+            auto row = std::vector<size_t>(population[i].begin(), population[i].end());
+            row.insert(row.cbegin(), 0UL);
+            table.SetRow(i, row);
+        }
+        utils::AppendColumns(table, {"total_distance"}, std::make_tuple(distances));
+        table.Save(path);
+        return;
+    }
+    tables::Table table(path, format);
+    std::vector<size_t> column(population.size(), 0);
+    table.add("0", column);
+    const size_t n_cities = population.empty() ? 0 : population.front().size();
+    for (size_t c = 0; c < n_cities; c++) {
+        for (size_t i = 0; i < population.size(); i++) column[i] = size_t(population[i][c]);
+        table.add(std::to_string(c + 1), column);
+    }
+    table.add("total_distance", distances);
+    table.save();
+}
+
 #endif// GENETIC_TSP_TSP_GA_HPP
@@ -0,0 +1,212 @@
+#ifndef ESERCIZI_LSN_MAPPED_TABLE_HPP
+#define ESERCIZI_LSN_MAPPED_TABLE_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+/**
+ * Type of the entries of a binary table.
+ * Float64: coordinates, e.g. lattices and configurations.
+ * UInt8: small integers, e.g. spin states.
+ */
+enum class ColumnType : uint32_t { Float64 = 0, UInt8 = 1 };
+
+namespace detail {
+    // File layout, in native byte order: a header, then the columns one after the other, each made
+    // of n_rows entries of the same type
+    inline constexpr std::array<char, 8> table_magic{'L', 'S', 'N', 'T', 'A', 'B', 'L', '\0'};
+    inline constexpr uint32_t table_version = 1;
+
+    struct TableHeader {
+        std::array<char, 8> magic{table_magic};
+        uint32_t version{table_version};
+        ColumnType type{ColumnType::Float64};
+        uint64_t n_rows{0};
+        uint64_t n_columns{0};
+    };
+    static_assert(sizeof(TableHeader) == 32);
+
+    template<typename T>
+    constexpr ColumnType column_type() {
+        static_assert(std::is_same_v<T, double> || std::is_same_v<T, uint8_t>,
+                      "Binary tables store doubles or 8-bit unsigned integers");
+        return std::is_same_v<T, double> ? ColumnType::Float64 : ColumnType::UInt8;
+    }
+
+    inline size_t column_type_size(ColumnType type) { return type == ColumnType::Float64 ? 8 : 1; }
+}// namespace detail
+
+/**
+ * Read-only memory mapping of a whole file: pages are loaded by the OS on first access, with no
+ * parsing and no copy through stream buffers.
+ */
+class MappedFile {
+public:
+    MappedFile(const MappedFile &) = delete;
+    MappedFile(MappedFile &&other) noexcept
+        : m_data(std::exchange(other.m_data, nullptr)), m_size(std::exchange(other.m_size, 0)) {}
+
+    explicit MappedFile(const fs::path &path) {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("Could not open " + path.string());
+        struct stat info {};
+        if (::fstat(fd, &info) != 0 || info.st_size == 0) {
+            ::close(fd);
+            throw std::runtime_error("Could not map " + path.string());
+        }
+        m_size = static_cast<size_t>(info.st_size);
+        void *data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        // The mapping outlives the descriptor
+        ::close(fd);
+        if (data == MAP_FAILED) throw std::runtime_error("Could not map " + path.string());
+        m_data = static_cast<const char *>(data);
+    }
+
+    ~MappedFile() {
+        if (m_data != nullptr) ::munmap(const_cast<char *>(m_data), m_size);
+    }
+
+    [[nodiscard]] const char *data() const noexcept { return m_data; }
+    [[nodiscard]] size_t size() const noexcept { return m_size; }
+
+private:
+    const char *m_data{nullptr};
+    size_t m_size{0};
+};
+
+/**
+ * Whether a file is a binary table, judging from its first bytes. Loaders accepting both formats
+ * use it to pick the right one.
+ * @param path Path to the file.
+ */
+inline bool is_binary_table(const fs::path &path) {
+    std::ifstream file(path, std::ios::binary);
+    std::array<char, 8> magic{};
+    return file.read(magic.data(), magic.size()) && magic == detail::table_magic;
+}
+
+/**
+ * Memory-mapped binary table, written by save_table: columns are accessed in place.
+ */
+class MappedTable {
+public:
+    explicit MappedTable(const fs::path &path) : m_file(path) {
+        if (m_file.size() < sizeof(m_header))
+            throw std::runtime_error(path.string() + " is not a binary table");
+        std::memcpy(&m_header, m_file.data(), sizeof(m_header));
+        if (m_header.magic != detail::table_magic)
+            throw std::runtime_error(path.string() + " is not a binary table");
+        if (m_header.version != detail::table_version)
+            throw std::runtime_error(path.string() + ": unsupported table version " +
+                                     std::to_string(m_header.version));
+        if (m_file.size() != sizeof(m_header) + m_header.n_rows * m_header.n_columns *
+                                                        detail::column_type_size(m_header.type))
+            throw std::runtime_error(path.string() + ": corrupted binary table");
+    }
+
+    [[nodiscard]] size_t n_rows() const noexcept { return size_t(m_header.n_rows); }
+    [[nodiscard]] size_t n_columns() const noexcept { return size_t(m_header.n_columns); }
+    [[nodiscard]] ColumnType type() const noexcept { return m_header.type; }
+
+    /**
+     * Entries of a column, valid as long as the table.
+     * @tparam T Entry type, which must match the stored one.
+     * @param column Column index.
+     * @return Pointer to the first entry.
+     */
+    template<typename T>
+    const T *column(size_t column) const {
+        if (detail::column_type<T>() != type())
+            throw std::runtime_error("The binary table holds entries of a different type");
+        if (column >= n_columns()) throw std::out_of_range("No such table column");
+        // The header keeps the columns aligned to their type
+        return reinterpret_cast<const T *>(m_file.data() + sizeof(m_header)) + column * n_rows();
+    }
+
+    /**
+     * Copies the first entries of a column.
+     * @param column Column index.
+     * @param first Output iterator, receiving n entries converted to its value type.
+     * @param n Number of entries, at most n_rows().
+     */
+    template<typename T, typename OutputIt>
+    void copy_column(size_t column, OutputIt first, size_t n) const {
+        if (n > n_rows()) throw std::runtime_error("The binary table holds too few rows");
+        using Out = typename std::iterator_traits<OutputIt>::value_type;
+        const T *entries = this->template column<T>(column);
+        for (size_t row = 0; row < n; row++, first++) *first = static_cast<Out>(entries[row]);
+    }
+
+private:
+    MappedFile m_file;
+    detail::TableHeader m_header{};
+};
+
+/**
+ * Stores columns of the same length as a binary table.
+ * @param path Output path.
+ * @param n_rows Length of the columns.
+ * @param columns Pointers to the first entry of each column.
+ */
+template<typename T>
+void save_table(const fs::path &path, size_t n_rows, const std::vector<const T *> &columns) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) throw std::runtime_error("Could not open " + path.string());
+    detail::TableHeader header;
+    header.type = detail::column_type<T>();
+    header.n_rows = n_rows;
+    header.n_columns = columns.size();
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    for (const auto *column: columns)
+        file.write(reinterpret_cast<const char *>(column),
+                   static_cast<std::streamsize>(n_rows * sizeof(T)));
+    if (!file) throw std::runtime_error("Could not write " + path.string());
+}
+
+/**
+ * Converts a text table of whitespace separated numbers into a binary table.
+ * @param text_path Path to the text table.
+ * @param table_path Output path.
+ * @param n_columns Number of columns.
+ * @param skip_lines Number of header lines to ignore.
+ * @return Number of converted rows.
+ */
+template<typename T>
+size_t text_to_table(const fs::path &text_path, const fs::path &table_path, size_t n_columns,
+                     size_t skip_lines = 0) {
+    if (n_columns == 0) throw std::runtime_error("A table needs at least one column");
+    std::ifstream text(text_path);
+    if (!text.is_open()) throw std::runtime_error("Could not open " + text_path.string());
+    for (size_t line = 0; line < skip_lines; line++) text.ignore(4096, '\n');
+    std::vector<std::vector<T>> columns(n_columns);
+    // Small integers are read as such, not as characters
+    std::conditional_t<std::is_integral_v<T>, unsigned, T> entry;
+    for (size_t column = 0; text >> entry; column = (column + 1) % n_columns)
+        columns[column].push_back(static_cast<T>(entry));
+    const auto n_rows = columns.back().size();
+    if (columns.front().size() != n_rows)
+        throw std::runtime_error(text_path.string() + ": incomplete last row");
+    std::vector<const T *> pointers;
+    for (const auto &column: columns) pointers.push_back(column.data());
+    save_table(table_path, n_rows, pointers);
+    return n_rows;
+}
+
+#endif//ESERCIZI_LSN_MAPPED_TABLE_HPP
@@ -14,6 +14,7 @@
 
 #include "../ising.hpp"
 #include "distributions/uniform_int.hpp"
+#include "mapped_table.hpp"
 #include "structs.hpp"
 #include "variables.hpp"
 
@@ -115,7 +116,19 @@ namespace ising {
             file.close();
         }
 
+        /**
+         * Reads a state saved by save_state, or a binary table with a single column of 0/1 spins
+         * (see mapped_table.hpp).
+         */
         StateSpace read_state(const fs::path &state_path) {
+            if (is_binary_table(state_path)) {
+                const MappedTable table(state_path);
+                if (table.n_columns() != 1)
+                    throw std::runtime_error(state_path.string() + " is not a spin state");
+                StateSpace state(table.n_rows());
+                table.copy_column<uint8_t>(0, state.begin(), table.n_rows());
+                return state;
+            }
             std::ifstream file(state_path);
             if (!file.is_open())
                 throw std::runtime_error(state_path.string() + " could not be opened.");
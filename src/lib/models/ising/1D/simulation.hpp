@@ -12,15 +12,19 @@
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <stdexcept>
 #include <string_view>
 #include <tuple>
 
 #include <rapidcsv.h>
 
+#include "estimators/blocking.hpp"
 #include "estimators/estimators.hpp"
 #include "estimators/mean.hpp"
+#include "estimators/resampling.hpp"
 #include "estimators/variance.hpp"
 #include "ising.hpp"
+#include "tables.hpp"
 #include "utils.hpp"
 #include "variables.hpp"
 
@@ -86,8 +90,9 @@ namespace ising::D1 {
             }
         }
 
-        inline void save_results(const fs::path &output_path) const {
-            m_vars.save_data(output_path);
+        inline void save_results(const fs::path &output_path,
+                                 tables::Format format = tables::Format::Csv) const {
+            m_vars.save_data(output_path, format);
         }
 
         inline void save_state(const fs::path &output_path) const {
@@ -147,6 +152,7 @@ namespace ising::D1 {
                     rng);
             //for (size_t i = 0; i < m_block_size; i++) { step(rng); }
             compute_store_estimates(m_cachevars, m_thermovars, m_thermo_outputs);
+            if (m_resampling != nullptr) m_resampling->push_block(proxy_averages(m_cachevars));
             return acc_rate;
         }
 
@@ -163,13 +169,72 @@ namespace ising::D1 {
             for (size_t block = 0; block < n_blocks; block++) block_estimates(rng);
         }
 
-        void save_results(const fs::path &output_path) {
-            csv::Document table;
+        /**
+         * Attaches a blocking analysis to the energy: from now on it receives every measure of H.
+         * @param blocking The analysis, which must outlive the simulator.
+         */
+        void attach(Blocking<var_space> &blocking) {
+            static_assert(H, "The energy must be computed to be analysed");
+            m_blocking = &blocking;
+        }
+
+        /**
+         * Attaches a resampling engine: from now on it receives the block averages of the proxy
+         * variables (see proxy_averages), from which save_resampled estimates the errors.
+         * @param resampling The engine, with N_PROXY_AVERAGES observables, which must outlive the
+         * simulator.
+         */
+        void attach(Resampling<var_space> &resampling) {
+            if (resampling.n_observables() != N_PROXY_AVERAGES)
+                throw std::runtime_error("The resampling must take the proxy variables' averages");
+            m_resampling = &resampling;
+        }
+
+        /**
+         * Performs a simulation which stops as soon as the attached blocking analysis reaches the
+         * target error on the energy.
+         * @param max_blocks Maximum number of blocks.
+         * @param n_warmup Number of steps to be used as warmup time.
+         * @param target_error Target error of the mean energy.
+         * @param rng Random number generator.
+         * @return Number of processed blocks.
+         */
+        template<class URBG>
+        size_t run_until(size_t max_blocks, size_t n_warmup, var_space target_error, URBG &rng) {
+            if (m_blocking == nullptr) throw std::runtime_error("No blocking analysis attached");
+            m_sampler.warmup(n_warmup, rng);
+            size_t block = 0;
+            while (block < max_blocks) {
+                block_estimates(rng);
+                block++;
+                if (m_blocking->reached(target_error)) break;
+            }
+            return block;
+        }
+
+        void save_results(const fs::path &output_path,
+                          tables::Format format = tables::Format::Csv) {
+            tables::Table table(output_path, format);
             rec_store_results(table);
-            if (!fs::exists(output_path.parent_path()))
-                fs::create_directories(output_path.parent_path());
-            table.RemoveColumn(table.GetColumnCount() - 1);
-            table.Save(output_path);
+            table.save();
+        }
+
+        /**
+         * Stores the final estimates of the variables over all the blocks with their jackknife
+         * and bootstrap errors and the jackknife bias, from the attached resampling engine.
+         * @param output_path Output path; its extension follows the format.
+         * @param n_replicas Number of bootstrap replicas.
+         * @param rngs One random number generator per thread, with independent streams.
+         * @param format Table format.
+         */
+        template<class URBG>
+        void save_resampled(const fs::path &output_path, size_t n_replicas,
+                            std::vector<URBG> &rngs,
+                            tables::Format format = tables::Format::Csv) const {
+            if (m_resampling == nullptr) throw std::runtime_error("No resampling attached");
+            tables::Table table(output_path, format);
+            rec_store_resampled(table, n_replicas, rngs);
+            table.save();
         }
 
         void save_state(const fs::path &output_path) const { m_model->save_state(output_path); }
@@ -185,6 +250,8 @@ namespace ising::D1 {
                    sizeof...(Ising1DThermoVars)>
                 m_thermo_outputs{};
         block_proxy_vars<var_space> m_cachevars;
+        Blocking<var_space> *m_blocking{nullptr};
+        Resampling<var_space> *m_resampling{nullptr};
 
 
         /**
@@ -192,7 +259,10 @@ namespace ising::D1 {
          * @param sample Sample number.
          */
         void measure(size_t sample) {
-            if constexpr (H) { m_cachevars.h[sample] = m_model->energy(); }
+            if constexpr (H) {
+                m_cachevars.h[sample] = m_model->energy();
+                if (m_blocking != nullptr) m_blocking->push(m_cachevars.h[sample]);
+            }
             if constexpr (S) {
                 m_cachevars.sum_s[sample] = spin_sum(*m_model);
                 if constexpr (S2)
@@ -206,22 +276,46 @@ namespace ising::D1 {
         }
 
         /**
-         * Utility to store estimations and errors in a rapidcsv table.
+         * Utility to store estimations and errors in a table.
          * @tparam I Internal use.
-         * @param table Rapidcsv table.
+         * @param table Output table.
          */
         template<size_t I = 0>
-        inline constexpr void rec_store_results(csv::Document &table) {
+        inline constexpr void rec_store_results(tables::Table &table) {
             if constexpr (I == std::tuple_size_v<decltype(m_thermovars)>) return;
             else {
                 const auto var_name = std::get<I>(m_thermovars).name();
-                table.InsertColumn(2 * I, std::get<I>(m_thermo_outputs).first,
-                                   var_name + "_estimate");
-                table.InsertColumn(2 * I + 1, std::get<I>(m_thermo_outputs).second,
-                                   var_name + "_error");
+                table.add(var_name + "_estimate", std::get<I>(m_thermo_outputs).first);
+                table.add(var_name + "_error", std::get<I>(m_thermo_outputs).second);
                 rec_store_results<I + 1>(table);
             }
         }
+
+        /**
+         * Utility to store resampled estimates and errors in a table, one row per column.
+         * @tparam I Internal use.
+         * @param table Output table.
+         */
+        template<size_t I = 0, class URBG>
+        void rec_store_resampled(tables::Table &table, size_t n_replicas,
+                                 std::vector<URBG> &rngs) const {
+            if constexpr (I == std::tuple_size_v<decltype(m_thermovars)>) return;
+            else {
+                const auto &variable = std::get<I>(m_thermovars);
+                const auto f = [&](const std::vector<var_space> &averages) {
+                    return variable.resampled(averages);
+                };
+                const auto [estimate, jackknife_error, bias] = m_resampling->jackknife(f);
+                const auto bootstrap_error =
+                        std::get<1>(m_resampling->bootstrap(f, n_replicas, rngs));
+                const auto var_name = variable.name();
+                table.add(var_name + "_estimate", std::vector<var_space>{estimate});
+                table.add(var_name + "_jackknife_error", std::vector<var_space>{jackknife_error});
+                table.add(var_name + "_bootstrap_error", std::vector<var_space>{bootstrap_error});
+                table.add(var_name + "_bias", std::vector<var_space>{bias});
+                rec_store_resampled<I + 1>(table, n_replicas, rngs);
+            }
+        }
     };
 }// namespace ising::D1
 
@@ -17,6 +17,7 @@
 #include "estimators/mean.hpp"
 #include "estimators/variance.hpp"
 #include "ising.hpp"
+#include "tables.hpp"
 
 namespace csv = rapidcsv;
 
@@ -42,19 +43,43 @@ namespace ising::D1 {
         std::vector<var_space> h;
         std::vector<int64_t> sum_s, sum_s2;
 
-        void save_data(const fs::path &output_path) const {
+        /**
+         * Stores the proxy variables.
+         * @param output_path Output path; its extension follows the format.
+         * @param format Table format.
+         */
+        void save_data(const fs::path &output_path,
+                       tables::Format format = tables::Format::Csv) const {
+            tables::Table table(output_path, format);
+            table.add("H", h);
+            table.add("Sum_s", sum_s);
+            table.add("Sum_s2", sum_s2);
+            table.save();
+        }
+    };
 
-            csv::Document table;
-            table.InsertColumn(0, h, "H");
-            table.InsertColumn(1, sum_s, "Sum_s");
-            table.InsertColumn(2, sum_s2, "Sum_s2");
-            table.RemoveColumn(3);
+    // Entries of the block averages of the proxy variables collected for resampling
+    enum ProxyAverage : size_t { H_AVG, H2_AVG, SUM_S_AVG, SUM_S2_AVG, N_PROXY_AVERAGES };
 
-            if (!fs::exists(output_path.parent_path()))
-                fs::create_directories(output_path.parent_path());
-            table.Save(output_path);
+    /**
+     * Block averages of the proxy variables: <H>, <H^2>, <Sum_s> and <Sum_s2>. Those which were not
+     * computed are 0.
+     * @param block_data Proxy variables sample.
+     * @return The averages, indexed by ProxyAverage.
+     */
+    template<typename var_space>
+    std::vector<var_space> proxy_averages(const block_proxy_vars<var_space> &block_data) {
+        std::vector<var_space> out(N_PROXY_AVERAGES, var_space(0));
+        const auto n = var_space(block_data.h.size());
+        for (size_t i = 0; i < block_data.h.size(); i++) {
+            out[H_AVG] += block_data.h[i];
+            out[H2_AVG] += block_data.h[i] * block_data.h[i];
+            out[SUM_S_AVG] += var_space(block_data.sum_s[i]);
+            out[SUM_S2_AVG] += var_space(block_data.sum_s2[i]);
         }
-    };
+        for (auto &average: out) average /= n;
+        return out;
+    }
 
     /**
      * Computes the sum of the spins of a 1D Ising model
@@ -101,6 +126,14 @@ namespace ising::D1 {
             return {estimate / n_spins, error / n_spins};
         }
 
+        /**
+         * Value of <H> / N from the averages of the proxy variables, for resampling.
+         * @param averages Averages indexed by ProxyAverage.
+         */
+        var_space resampled(const std::vector<var_space> &averages) const {
+            return averages[H_AVG] / n_spins;
+        }
+
         [[nodiscard]] std::string name() const { return "u"; }
 
     private:
@@ -133,6 +166,15 @@ namespace ising::D1 {
             return {m_coeff * mean, m_coeff2 * error};
         }
 
+        /**
+         * Value of b^2*(<H^2> - <H>^2) / N from the averages of the proxy variables, a nonlinear
+         * function whose error is best found by resampling.
+         * @param averages Averages indexed by ProxyAverage.
+         */
+        var_space resampled(const std::vector<var_space> &averages) const {
+            return m_coeff * (averages[H2_AVG] - averages[H_AVG] * averages[H_AVG]);
+        }
+
         [[nodiscard]] std::string name() const { return "c"; }
 
     private:
@@ -163,6 +205,14 @@ namespace ising::D1 {
                     m_mean_estimator(block_data.sum_s2.cbegin(), block_data.sum_s2.cend());
             return {m_coeff * var_space(mean), m_coeff2 * var_space(error)};
         }
+        /**
+         * Value of b*<sum_s2> / N from the averages of the proxy variables, for resampling.
+         * @param averages Averages indexed by ProxyAverage.
+         */
+        var_space resampled(const std::vector<var_space> &averages) const {
+            return m_coeff * averages[SUM_S2_AVG];
+        }
+
         [[nodiscard]] std::string name() const { return "X"; }
 
     private:
@@ -190,6 +240,14 @@ namespace ising::D1 {
                     m_mean_estimator(block_data.sum_s.cbegin(), block_data.sum_s.cend());
             return {var_space(estimate) / n_spins, var_space(error) / n_spins};
         }
+        /**
+         * Value of <sum_s> / N from the averages of the proxy variables, for resampling.
+         * @param averages Averages indexed by ProxyAverage.
+         */
+        var_space resampled(const std::vector<var_space> &averages) const {
+            return averages[SUM_S_AVG] / n_spins;
+        }
+
         [[nodiscard]] std::string name() const { return "m"; }
 
     private:
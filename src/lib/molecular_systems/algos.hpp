@@ -5,13 +5,16 @@
 #ifndef ESERCIZI_LSN_MS_UTILS_HPP
 #define ESERCIZI_LSN_MS_UTILS_HPP
 
+#include <array>
 #include <cmath>
 #include <cstddef>
 #include <random>
 #include <valarray>
 
+#include "data_types/cells.hpp"
 #include "data_types/settings.hpp"
 #include "data_types/vectors.hpp"
+#include "potentials.hpp"
 
 /**
  * Periodic boundary conditions algorithm
@@ -43,6 +46,19 @@ inline void compute_previous_positions(Vectors<field> &positions, Vectors<field>
     previous_positions_out.apply([&](auto &x) { x = PBC(-x, box_edge); });
 }
 
+/**
+ * Samples particle velocities from the Maxwell-Boltzmann distribution, using reduced units
+ * (k_b = 1, m = 1). Unlike generate_velocities, neither the drift nor the temperature are fixed.
+ * @param velocities Variable where the result will be stored
+ * @param temperature The system temperature in reduced units
+ * @param rng The random number generator to use
+ */
+template<typename field, class URBG>
+void sample_velocities(Vectors<field> &velocities, field temperature, URBG &rng) {
+    std::normal_distribution<field> gauss(0, std::sqrt(temperature));
+    velocities.apply([&](auto &v) { v = gauss(rng); });
+}
+
 /**
  * Generates particle velocities following transform Maxwell-Boltzmann distribution, using reduced units (k_b = 1, m = 1)
  * @param velocities Variable where the result will be stored
@@ -52,8 +68,7 @@ inline void compute_previous_positions(Vectors<field> &positions, Vectors<field>
 template<typename field, class URBG>
 void generate_velocities(Vectors<field> &velocities, field temperature, URBG &rng) {
     const auto n_particles = velocities.e_i.size();
-    std::normal_distribution<field> gauss(0, std::sqrt(temperature));
-    velocities.apply([&](auto &v) { v = gauss(rng); });
+    sample_velocities(velocities, temperature, rng);
     velocities -= velocities.mean();
     const field v_scale_factor =
             std::sqrt(temperature / (velocities.full_norm2() / field(3 * n_particles)));
@@ -139,6 +154,297 @@ inline void verlet_next_velocities(const Vectors<field> &next_positions,
                            box_edge);
 }
 
+/**
+ * Verlet integration step fused in a single pass over the arrays: computes the next positions
+ * (with PBC), the velocities at the current time step and their squared norm. The buffers are
+ * then rotated, so that previous_positions and positions advance by one step and next_positions
+ * holds stale data to be overwritten at the next step. Nothing is allocated.
+ * @tparam out Numeric field of the squared norm of the velocities
+ * @param positions The particles positions, replaced by the next ones
+ * @param previous_positions The particles previous positions, replaced by the current ones
+ * @param next_positions Scratch buffer, of the same size as positions
+ * @param velocities The variable where the current velocities will be stored
+ * @param forces The forces acting on each particle
+ * @param dt2 The time step squared
+ * @param dbldt Double the time step
+ * @param box_edge The periodic boundary condition size
+ * @return Sum of the squared velocities
+ */
+template<typename out, typename field>
+inline out verlet_step(Vectors<field> &positions, Vectors<field> &previous_positions,
+                       Vectors<field> &next_positions, Vectors<field> &velocities,
+                       const Vectors<field> &forces, field dt2, field dbldt, field box_edge) {
+    const auto component = [=](field x, field x_prev, field f, field &x_next) {
+        x_next = PBC(field(2) * x - x_prev + f * dt2, box_edge);
+        return PBC(x_next - x_prev, box_edge) / dbldt;
+    };
+    out norm2{0};
+    for (size_t i = 0; i < positions.e_i.size(); i++) {
+        const auto vx = component(positions.e_i[i], previous_positions.e_i[i], forces.e_i[i],
+                                  next_positions.e_i[i]);
+        const auto vy = component(positions.e_j[i], previous_positions.e_j[i], forces.e_j[i],
+                                  next_positions.e_j[i]);
+        const auto vz = component(positions.e_k[i], previous_positions.e_k[i], forces.e_k[i],
+                                  next_positions.e_k[i]);
+        velocities.e_i[i] = vx;
+        velocities.e_j[i] = vy;
+        velocities.e_k[i] = vz;
+        norm2 += out(vx) * out(vx) + out(vy) * out(vy) + out(vz) * out(vz);
+    }
+    previous_positions.swap(positions);
+    positions.swap(next_positions);
+    return norm2;
+}
+
+/**
+ * Velocity Verlet half kick: advances the velocities by the given time under constant forces.
+ * @tparam out Numeric field of the squared norm of the velocities
+ * @param velocities The particles velocities, updated in place
+ * @param forces The forces acting on each particle
+ * @param dt The kick duration, usually half the time step
+ * @return Sum of the updated squared velocities
+ */
+template<typename out, typename field>
+inline out velocity_kick(Vectors<field> &velocities, const Vectors<field> &forces, field dt) {
+    out norm2{0};
+    for (size_t i = 0; i < velocities.e_i.size(); i++) {
+        velocities.e_i[i] += forces.e_i[i] * dt;
+        velocities.e_j[i] += forces.e_j[i] * dt;
+        velocities.e_k[i] += forces.e_k[i] * dt;
+        norm2 += out(velocities.e_i[i]) * out(velocities.e_i[i]) +
+                 out(velocities.e_j[i]) * out(velocities.e_j[i]) +
+                 out(velocities.e_k[i]) * out(velocities.e_k[i]);
+    }
+    return norm2;
+}
+
+/**
+ * Velocity Verlet drift: moves the particles at constant velocity (with PBC), rotating the buffers
+ * as verlet_step does. Nothing is allocated.
+ * @param positions The particles positions, replaced by the next ones
+ * @param previous_positions The particles previous positions, replaced by the current ones
+ * @param next_positions Scratch buffer, of the same size as positions
+ * @param velocities The particles velocities
+ * @param dt The time step
+ * @param box_edge The periodic boundary condition size
+ */
+template<typename field>
+inline void velocity_drift(Vectors<field> &positions, Vectors<field> &previous_positions,
+                           Vectors<field> &next_positions, const Vectors<field> &velocities,
+                           field dt, field box_edge) {
+    for (size_t i = 0; i < positions.e_i.size(); i++) {
+        next_positions.e_i[i] = PBC(positions.e_i[i] + velocities.e_i[i] * dt, box_edge);
+        next_positions.e_j[i] = PBC(positions.e_j[i] + velocities.e_j[i] * dt, box_edge);
+        next_positions.e_k[i] = PBC(positions.e_k[i] + velocities.e_k[i] * dt, box_edge);
+    }
+    previous_positions.swap(positions);
+    positions.swap(next_positions);
+}
+
+
+namespace detail {
+    /**
+     * Adds the potential and the virial of the pairs stored in a batch to "energy" and "virial" and
+     * empties it.
+     */
+    template<typename field, class Potential>
+    inline void flush_pairs(molecular_systems::potentials::PairBatch<field> &batch,
+                            const Potential &potential,
+                            const SimulationSettings<field> &simulation, field &energy,
+                            field &virial) {
+        batch.compute(potential, simulation.box_edge, energy, virial);
+        batch.clear();
+    }
+
+    /**
+     * Adds the pair between "position" and the i-th particle in "positions" to a batch, flushing it
+     * into the sums when full.
+     */
+    template<typename field, class Potential>
+    inline void push_pair(molecular_systems::potentials::PairBatch<field> &batch, size_t i,
+                          const std::array<field, 3> &position, const Vectors<field> &positions,
+                          const Potential &potential, const SimulationSettings<field> &simulation,
+                          field &energy, field &virial) {
+        batch.push(i, i, positions.e_i[i] - position[0], positions.e_j[i] - position[1],
+                   positions.e_k[i] - position[2]);
+        if (batch.full()) flush_pairs(batch, potential, simulation, energy, virial);
+    }
+}// namespace detail
+
+/**
+ * Computes the potential energy and the virial (in reduced units, without tail corrections) of the
+ * pairs between "particle" in "position" and the other particles in "positions".
+ * @tparam field Numeric field for every variable.
+ * @tparam Potential Pair potential policy.
+ * @param particle Particle number.
+ * @param position Particle's position.
+ * @param positions Positions of the system's particles.
+ * @param simulation Simulation settings.
+ * @param potential Pair potential.
+ * @param energy Output: potential energy of "particle".
+ * @param virial Output: virial of "particle".
+ */
+template<typename field, class Potential>
+void particle_sums(size_t particle, const std::array<field, 3> &position,
+                   const Vectors<field> &positions, const SimulationSettings<field> &simulation,
+                   const Potential &potential, field &energy, field &virial) {
+    energy = field(0);
+    virial = field(0);
+    molecular_systems::potentials::PairBatch<field> batch;
+    for (size_t i = 0UL; i < simulation.n_particles; i++) {
+        if (particle == i) continue;
+        detail::push_pair(batch, i, position, positions, potential, simulation, energy, virial);
+    }
+    detail::flush_pairs(batch, potential, simulation, energy, virial);
+}
+
+/**
+ * Computes the potential energy and the virial (in reduced units, without tail corrections) of the
+ * pairs between "particle" in "position" and the other particles in "positions", looking only at
+ * the particles binned in the cells surrounding "position".
+ * @tparam field Numeric field for every variable.
+ * @tparam Potential Pair potential policy.
+ * @param particle Particle number.
+ * @param position Particle's position.
+ * @param positions Positions of the system's particles.
+ * @param simulation Simulation settings.
+ * @param potential Pair potential.
+ * @param cells Linked cells built on "positions".
+ * @param energy Output: potential energy of "particle".
+ * @param virial Output: virial of "particle".
+ */
+template<typename field, class Potential>
+void particle_sums(size_t particle, const std::array<field, 3> &position,
+                   const Vectors<field> &positions, const SimulationSettings<field> &simulation,
+                   const Potential &potential, const CellList<field> &cells, field &energy,
+                   field &virial) {
+    energy = field(0);
+    virial = field(0);
+    molecular_systems::potentials::PairBatch<field> batch;
+    cells.for_each_neighbor(position, [&](size_t i) {
+        if (particle != i)
+            detail::push_pair(batch, i, position, positions, potential, simulation, energy,
+                              virial);
+    });
+    detail::flush_pairs(batch, potential, simulation, energy, virial);
+}
+
+namespace detail {
+    /**
+     * Adds r^-12 and r^-6 of the pair between "position" and the i-th particle in "positions", if
+     * within the cutoff.
+     */
+    template<typename field>
+    inline void add_lj_powers(size_t i, const std::array<field, 3> &position,
+                              const Vectors<field> &positions,
+                              const SimulationSettings<field> &simulation, field &s12, field &s6) {
+        const auto dx = PBC(positions.e_i[i] - position[0], simulation.box_edge);
+        const auto dy = PBC(positions.e_j[i] - position[1], simulation.box_edge);
+        const auto dz = PBC(positions.e_k[i] - position[2], simulation.box_edge);
+        const auto r2 = dx * dx + dy * dy + dz * dz;
+        if (r2 >= simulation.cutoff2) return;
+        const auto inv_r2 = field(1) / r2;
+        const auto inv_r6 = inv_r2 * inv_r2 * inv_r2;
+        s12 += inv_r6 * inv_r6;
+        s6 += inv_r6;
+    }
+}// namespace detail
+
+/**
+ * Computes the sums of r^-12 and r^-6 over the pairs between "particle" in "position" and the other
+ * particles in "positions". The Lennard-Jones energy of "particle" is 4 (s12 - s6) and its virial
+ * 48 s12 - 24 s6: a uniform rescaling of box, positions and cutoff by s scales the two sums by
+ * s^-12 and s^-6.
+ * @tparam field Numeric field for every variable.
+ * @param particle Particle number.
+ * @param position Particle's position.
+ * @param positions Positions of the system's particles.
+ * @param simulation Simulation settings.
+ * @param s12 Output: sum of r^-12.
+ * @param s6 Output: sum of r^-6.
+ */
+template<typename field>
+void lj_power_sums(size_t particle, const std::array<field, 3> &position,
+                   const Vectors<field> &positions, const SimulationSettings<field> &simulation,
+                   field &s12, field &s6) {
+    s12 = field(0);
+    s6 = field(0);
+    for (size_t i = 0UL; i < simulation.n_particles; i++) {
+        if (particle != i) detail::add_lj_powers(i, position, positions, simulation, s12, s6);
+    }
+}
+
+/**
+ * Computes the sums of r^-12 and r^-6 over the pairs between "particle" in "position" and the other
+ * particles in "positions", looking only at the particles binned in the cells surrounding
+ * "position".
+ * @tparam field Numeric field for every variable.
+ * @param particle Particle number.
+ * @param position Particle's position.
+ * @param positions Positions of the system's particles.
+ * @param simulation Simulation settings.
+ * @param cells Linked cells built on "positions".
+ * @param s12 Output: sum of r^-12.
+ * @param s6 Output: sum of r^-6.
+ */
+template<typename field>
+void lj_power_sums(size_t particle, const std::array<field, 3> &position,
+                   const Vectors<field> &positions, const SimulationSettings<field> &simulation,
+                   const CellList<field> &cells, field &s12, field &s6) {
+    s12 = field(0);
+    s6 = field(0);
+    cells.for_each_neighbor(position, [&](size_t i) {
+        if (particle != i) detail::add_lj_powers(i, position, positions, simulation, s12, s6);
+    });
+}
+
+/**
+ * Computes the potential energy (in reduced units) acted by particles in "positions" on "particle" in "position".
+ * @tparam field Numeric field for every variable.
+ * @tparam Potential Pair potential policy.
+ * @param particle Particle number.
+ * @param position Particle's position.
+ * @param positions Positions of the system's particles.
+ * @param simulation Simulation settings.
+ * @param potential Pair potential.
+ * @return Potential energy of "particle".
+ */
+template<bool tail_correction, typename field, class Potential>
+field pair_potential(size_t particle, const std::array<field, 3> &position,
+                     const Vectors<field> &positions, const SimulationSettings<field> &simulation,
+                     const Potential &potential) {
+    field energy, virial;
+    particle_sums(particle, position, positions, simulation, potential, energy, virial);
+    if constexpr (tail_correction)
+        return energy + potential.tail_energy(field(simulation.n_particles) / simulation.volume);
+    else
+        return energy;
+}
+
+/**
+ * Computes the potential energy (in reduced units) acted by particles in "positions" on "particle" in "position",
+ * looking only at the particles binned in the cells surrounding "position".
+ * @tparam field Numeric field for every variable.
+ * @tparam Potential Pair potential policy.
+ * @param particle Particle number.
+ * @param position Particle's position.
+ * @param positions Positions of the system's particles.
+ * @param simulation Simulation settings.
+ * @param potential Pair potential.
+ * @param cells Linked cells built on "positions".
+ * @return Potential energy of "particle".
+ */
+template<bool tail_correction, typename field, class Potential>
+field pair_potential(size_t particle, const std::array<field, 3> &position,
+                     const Vectors<field> &positions, const SimulationSettings<field> &simulation,
+                     const Potential &potential, const CellList<field> &cells) {
+    field energy, virial;
+    particle_sums(particle, position, positions, simulation, potential, cells, energy, virial);
+    if constexpr (tail_correction)
+        return energy + potential.tail_energy(field(simulation.n_particles) / simulation.volume);
+    else
+        return energy;
+}
 
 /**
  * Computes the Lennard-Jones potential (in reduced units) acted by particles in "positions" on "particle" in "position".
@@ -146,28 +452,34 @@ inline void verlet_next_velocities(const Vectors<field> &next_positions,
  * @param particle Particle number.
  * @param position Particle's position.
  * @param positions Positions of the system's particles.
- * @param r_cut Size of the cut.
+ * @param simulation Simulation settings.
  * @return Lennard-Jones potential on "particle".
  */
 template<bool tail_correction, typename field>
 field LJ_potential(size_t particle, const std::array<field, 3> &position,
                    const Vectors<field> &positions, const SimulationSettings<field> &simulation) {
-    field potential{0};
-    for (size_t i = 0UL; i < simulation.n_particles; i++) {
-        if (particle == i) continue;
-        const auto dxij = PBC(positions.e_i[i] - position[0], simulation.box_edge);
-        const auto dyij = PBC(positions.e_j[i] - position[1], simulation.box_edge);
-        const auto dzij = PBC(positions.e_k[i] - position[2], simulation.box_edge);
-        const auto drij2 = dxij * dxij + dyij * dyij + dzij * dzij;
-        if (drij2 < simulation.cutoff2) {
-            const auto lj1 = field(1) / std::pow(drij2, 6);
-            const auto lj2 = field(1) / std::pow(drij2, 3);
-            potential += lj1 - lj2;
-        }
-    }
-    potential *= 4;
-    if constexpr (tail_correction) return potential + simulation.u_tail_correction;
-    else
-        return potential;
+    return pair_potential<tail_correction>(
+            particle, position, positions, simulation,
+            molecular_systems::potentials::LennardJones<field>(simulation.cutoff));
+}
+
+/**
+ * Computes the Lennard-Jones potential (in reduced units) acted by particles in "positions" on "particle" in "position",
+ * looking only at the particles binned in the cells surrounding "position".
+ * @tparam field Numeric field for every variable.
+ * @param particle Particle number.
+ * @param position Particle's position.
+ * @param positions Positions of the system's particles.
+ * @param simulation Simulation settings.
+ * @param cells Linked cells built on "positions".
+ * @return Lennard-Jones potential on "particle".
+ */
+template<bool tail_correction, typename field>
+field LJ_potential(size_t particle, const std::array<field, 3> &position,
+                   const Vectors<field> &positions, const SimulationSettings<field> &simulation,
+                   const CellList<field> &cells) {
+    return pair_potential<tail_correction>(
+            particle, position, positions, simulation,
+            molecular_systems::potentials::LennardJones<field>(simulation.cutoff), cells);
 }
 #endif//ESERCIZI_LSN_MS_UTILS_HPP
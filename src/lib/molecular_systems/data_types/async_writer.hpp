@@ -0,0 +1,198 @@
+#ifndef ESERCIZI_LSN_MS_ASYNC_WRITER_HPP
+#define ESERCIZI_LSN_MS_ASYNC_WRITER_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "trajectory.hpp"
+#include "vectors.hpp"
+
+namespace fs = std::filesystem;
+
+/**
+ * Writes trajectory frames and checkpoints on a background thread, so that the stepping loop only
+ * pays for a copy of the state. Snapshots are copied into a fixed number of staging slots (two by
+ * default, i.e. double buffering): memory is bounded, and when every slot is waiting to be written
+ * the caller blocks until one is free. Snapshots are written in submission order; everything
+ * submitted is written before the destructor returns. An error met by the background thread is
+ * rethrown by the following call.
+ * @tparam field Numeric field of the coordinates.
+ */
+template<typename field>
+class AsyncWriter {
+public:
+    AsyncWriter(const AsyncWriter &) = delete;
+
+    /**
+     * Constructor
+     * @param trajectory Trajectory where frames are appended, if any.
+     * @param n_slots Number of staging slots.
+     */
+    explicit AsyncWriter(std::optional<TrajectoryWriter> trajectory = std::nullopt,
+                         size_t n_slots = 2)
+        : m_trajectory(std::move(trajectory)), m_slots(std::max(size_t(1), n_slots)),
+          m_thread([this]() { consume(); }) {}
+
+    ~AsyncWriter() {
+        {
+            std::lock_guard lock(m_mutex);
+            m_stop = true;
+        }
+        m_ready.notify_all();
+        m_thread.join();
+        if (m_error) {
+            try {
+                std::rethrow_exception(m_error);
+            } catch (const std::exception &e) {
+                std::cerr << "Asynchronous writer: " << e.what() << std::endl;
+            }
+        }
+    }
+
+    /**
+     * Appends a frame to the trajectory. Same as TrajectoryWriter::write, without waiting for the
+     * file system.
+     * @param positions Particles positions.
+     * @param box_edge Edge of the periodic box.
+     * @param step Time step of the frame.
+     */
+    void write(const Vectors<field> &positions, field box_edge, size_t step) {
+        if (!m_trajectory.has_value())
+            throw std::runtime_error("The asynchronous writer has no trajectory");
+        auto &slot = acquire();
+        slot.kind = Snapshot::Frame;
+        slot.positions = positions;
+        slot.box_edge = box_edge;
+        slot.step = step;
+        publish();
+    }
+
+    /**
+     * Stores positions (in units of the box edge) and velocities as LJMono::save_configurations
+     * does, without waiting for the file system.
+     * @param positions Particles positions.
+     * @param velocities Particles velocities.
+     * @param box_edge Edge of the periodic box.
+     * @param positions_path File where positions will be stored.
+     * @param velocities_path File where velocities will be stored.
+     */
+    void checkpoint(const Vectors<field> &positions, const Vectors<field> &velocities,
+                    field box_edge, const fs::path &positions_path,
+                    const fs::path &velocities_path) {
+        auto &slot = acquire();
+        slot.kind = Snapshot::Checkpoint;
+        slot.positions = positions;
+        slot.velocities = velocities;
+        slot.box_edge = box_edge;
+        slot.positions_path = positions_path;
+        slot.velocities_path = velocities_path;
+        publish();
+    }
+
+    /**
+     * Waits until every submitted snapshot has been written.
+     */
+    void flush() {
+        std::unique_lock lock(m_mutex);
+        m_free.wait(lock, [this]() { return m_count == 0; });
+        rethrow();
+        if (m_trajectory.has_value()) m_trajectory->flush();
+    }
+
+    // Number of times the caller had to wait for a free slot
+    [[nodiscard]] size_t n_waits() const noexcept { return m_waits; }
+
+private:
+    struct Snapshot {
+        enum Kind { Frame, Checkpoint } kind{Frame};
+        Vectors<field> positions{0}, velocities{0};
+        field box_edge{0};
+        size_t step{0};
+        fs::path positions_path{}, velocities_path{};
+    };
+
+    // Rethrows an error of the background thread. The mutex must be held
+    void rethrow() {
+        if (!m_error) return;
+        auto error = m_error;
+        m_error = nullptr;
+        std::rethrow_exception(error);
+    }
+
+    // Waits for a free slot (back-pressure). It is not visible to the writer until publish()
+    Snapshot &acquire() {
+        std::unique_lock lock(m_mutex);
+        rethrow();
+        if (m_count == m_slots.size()) {
+            m_waits++;
+            m_free.wait(lock, [this]() { return m_count < m_slots.size(); });
+        }
+        return m_slots[m_tail];
+    }
+
+    void publish() {
+        {
+            std::lock_guard lock(m_mutex);
+            m_tail = (m_tail + 1) % m_slots.size();
+            m_count++;
+        }
+        m_ready.notify_one();
+    }
+
+    void consume() {
+        while (true) {
+            std::unique_lock lock(m_mutex);
+            m_ready.wait(lock, [this]() { return m_count > 0 || m_stop; });
+            if (m_count == 0) return;
+            // The slot is owned by this thread until it is released below
+            const auto &slot = m_slots[m_head];
+            lock.unlock();
+            std::exception_ptr error;
+            try {
+                write_snapshot(slot);
+            } catch (...) { error = std::current_exception(); }
+            lock.lock();
+            if (error && !m_error) m_error = error;
+            m_head = (m_head + 1) % m_slots.size();
+            m_count--;
+            lock.unlock();
+            m_free.notify_all();
+        }
+    }
+
+    void write_snapshot(const Snapshot &slot) {
+        if (slot.kind == Snapshot::Frame) {
+            m_trajectory->write(slot.positions, slot.box_edge, slot.step);
+            return;
+        }
+        const auto box_edge = slot.box_edge;
+        slot.positions.save_configuration(slot.positions_path, [=](const auto x) {
+            return (x - box_edge * std::rint(x / box_edge)) / box_edge;
+        });
+        slot.velocities.save_configuration(slot.velocities_path);
+    }
+
+    std::optional<TrajectoryWriter> m_trajectory;
+    std::vector<Snapshot> m_slots;
+    // Slots between head and tail (count of them) are waiting to be written
+    size_t m_head{0}, m_tail{0}, m_count{0}, m_waits{0};
+    bool m_stop{false};
+    std::exception_ptr m_error{nullptr};
+    std::mutex m_mutex;
+    std::condition_variable m_ready, m_free;
+    // Started last, once every other member is initialized
+    std::thread m_thread;
+};
+
+#endif//ESERCIZI_LSN_MS_ASYNC_WRITER_HPP
@@ -0,0 +1,221 @@
+#ifndef ESERCIZI_LSN_MS_CELLS_HPP
+#define ESERCIZI_LSN_MS_CELLS_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "vectors.hpp"
+
+/**
+ * Linked-cell spatial binning of a periodic cubic box. The box is split in cells whose edge is at
+ * least the interaction cutoff, so that every interacting pair lies either in the same cell or in
+ * one of the 26 surrounding ones (periodic images included). Particles are stored as linked lists,
+ * one per cell.
+ * @tparam field The numeric field of the coordinates
+ */
+template<typename field>
+class CellList {
+public:
+    // Marks the end of a cell's list
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    /**
+     * Splits the box in cells.
+     * @param box_edge The periodic box edge.
+     * @param min_cell_edge Minimum edge of a cell (usually the cutoff radius).
+     */
+    CellList(field box_edge, field min_cell_edge)
+        : m_box_edge(box_edge),
+          m_cells_per_side(std::max(size_t(1),
+                                    static_cast<size_t>(std::floor(box_edge / min_cell_edge)))),
+          m_cell_edge(box_edge / field(m_cells_per_side)),
+          m_head(m_cells_per_side * m_cells_per_side * m_cells_per_side, npos) {
+        init_stencils();
+    }
+
+    /**
+     * Whether the binning is fine enough to be useful: with less than three cells per side a
+     * cell would be its own neighbor and pairs would be counted more than once.
+     */
+    [[nodiscard]] bool usable() const noexcept { return m_cells_per_side >= 3; }
+
+    [[nodiscard]] size_t cells_per_side() const noexcept { return m_cells_per_side; }
+    [[nodiscard]] size_t n_cells() const noexcept { return m_head.size(); }
+    [[nodiscard]] field cell_edge() const noexcept { return m_cell_edge; }
+
+    /**
+     * Shifts the grid by an offset, e.g. to randomize the cell boundaries. Particles must then be
+     * binned again with build().
+     * @param offset Displacement of the grid along each axis, each in [0, cell_edge()).
+     */
+    void shift(const std::array<field, 3> &offset) noexcept { m_offset = offset; }
+
+    // Index of the cell of coordinates (cx, cy, cz), each in [0, cells_per_side())
+    [[nodiscard]] size_t cell(size_t cx, size_t cy, size_t cz) const noexcept {
+        return (cx * m_cells_per_side + cy) * m_cells_per_side + cz;
+    }
+
+    // Index of the cell holding a (PBC) position
+    [[nodiscard]] size_t cell_at(const std::array<field, 3> &position) const noexcept {
+        return cell_index(position[0], position[1], position[2]);
+    }
+
+    // Index of the cell holding a particle, as of the last build() or move()
+    [[nodiscard]] size_t cell_of(size_t particle) const noexcept { return m_cell_of[particle]; }
+
+    /**
+     * Calls f(i) for every particle i lying in a cell.
+     * @param cell Cell index.
+     * @param f Action on a particle index.
+     */
+    template<class Fn>
+    void for_each_in_cell(size_t cell, Fn f) const {
+        for (size_t i = m_head[cell]; i != npos; i = m_next[i]) f(i);
+    }
+
+    /**
+     * Bins every particle. Positions must lie in [-box_edge/2, box_edge/2), i.e. after PBC.
+     * @param positions Molecular positions.
+     */
+    void build(const Vectors<field> &positions) {
+        const auto n_particles = positions.e_i.size();
+        std::fill(m_head.begin(), m_head.end(), npos);
+        m_next.resize(n_particles);
+        m_cell_of.resize(n_particles);
+        for (size_t particle = 0; particle < n_particles; particle++) {
+            const auto cell = cell_index(positions.e_i[particle], positions.e_j[particle],
+                                         positions.e_k[particle]);
+            push(particle, cell);
+        }
+    }
+
+    /**
+     * Updates the cell of a single particle after it has been displaced.
+     * @param particle Particle index.
+     * @param position New (PBC) position of the particle.
+     */
+    void move(size_t particle, const std::array<field, 3> &position) {
+        const auto new_cell = cell_index(position[0], position[1], position[2]);
+        const auto old_cell = m_cell_of[particle];
+        if (new_cell == old_cell) return;
+        // Unlinking the particle from its old cell
+        if (m_head[old_cell] == particle) {
+            m_head[old_cell] = m_next[particle];
+        } else {
+            size_t p = m_head[old_cell];
+            while (m_next[p] != particle) p = m_next[p];
+            m_next[p] = m_next[particle];
+        }
+        push(particle, new_cell);
+    }
+
+    /**
+     * Calls f(i, j) once for every unordered pair of particles lying in the same or in adjacent cells.
+     * The cells can be split in interleaved slices: only slice "first" out of "stride" is processed.
+     * @param f Pair action.
+     * @param first Index of the slice.
+     * @param stride Number of slices.
+     */
+    template<class PairFn>
+    void for_each_pair(PairFn f, size_t first = 0, size_t stride = 1) const {
+        for (size_t cell = first; cell < m_head.size(); cell += stride) {
+            for (size_t i = m_head[cell]; i != npos; i = m_next[i]) {
+                // Pairs inside the same cell
+                for (size_t j = m_next[i]; j != npos; j = m_next[j]) f(i, j);
+                // Pairs with half of the surrounding cells: the other half is covered when those
+                // cells are processed
+                for (size_t s = 0; s < half_stencil_size; s++) {
+                    const auto neighbor = m_half_stencils[cell * half_stencil_size + s];
+                    for (size_t j = m_head[neighbor]; j != npos; j = m_next[j]) f(i, j);
+                }
+            }
+        }
+    }
+
+    /**
+     * Calls f(j) for every particle j lying in the cell of "position" or in the adjacent ones.
+     * @param position A (PBC) position.
+     * @param f Action on a particle index.
+     */
+    template<class Fn>
+    void for_each_neighbor(const std::array<field, 3> &position, Fn f) const {
+        const auto cell = cell_index(position[0], position[1], position[2]);
+        for (size_t s = 0; s < full_stencil_size; s++) {
+            const auto neighbor = m_full_stencils[cell * full_stencil_size + s];
+            for (size_t j = m_head[neighbor]; j != npos; j = m_next[j]) f(j);
+        }
+    }
+
+private:
+    static constexpr size_t half_stencil_size = 13;
+    static constexpr size_t full_stencil_size = 27;
+
+    field m_box_edge;
+    size_t m_cells_per_side;
+    field m_cell_edge;
+    // Displacement of the grid
+    std::array<field, 3> m_offset{};
+    // First particle of each cell
+    std::vector<size_t> m_head;
+    // Next particle in the same cell
+    std::vector<size_t> m_next{};
+    // Cell of each particle
+    std::vector<size_t> m_cell_of{};
+    // Neighbor cells of each cell, flattened
+    std::vector<size_t> m_half_stencils{}, m_full_stencils{};
+
+    inline void push(size_t particle, size_t cell) noexcept {
+        m_next[particle] = m_head[cell];
+        m_head[cell] = particle;
+        m_cell_of[particle] = cell;
+    }
+
+    inline size_t axis_index(field x, size_t axis) const noexcept {
+        x -= m_offset[axis];
+        if (x < -m_box_edge / 2) x += m_box_edge;
+        const auto c = static_cast<long>(std::floor((x + m_box_edge / 2) / m_cell_edge));
+        // Rounding may place a particle lying on the box boundary just outside the grid
+        return static_cast<size_t>(std::clamp(c, 0L, static_cast<long>(m_cells_per_side) - 1));
+    }
+
+    inline size_t cell_index(field x, field y, field z) const noexcept {
+        return cell(axis_index(x, 0), axis_index(y, 1), axis_index(z, 2));
+    }
+
+    /**
+     * Computes, for every cell, the indices of the surrounding cells taking periodicity into account.
+     * The half stencil holds the 13 neighbors with a "greater" offset, the full one all 27 cells.
+     */
+    void init_stencils() {
+        const auto n = static_cast<long>(m_cells_per_side);
+        const auto wrap = [n](long c) { return static_cast<size_t>(((c % n) + n) % n); };
+        m_half_stencils.reserve(n_cells() * half_stencil_size);
+        m_full_stencils.reserve(n_cells() * full_stencil_size);
+        for (long cx = 0; cx < n; cx++) {
+            for (long cy = 0; cy < n; cy++) {
+                for (long cz = 0; cz < n; cz++) {
+                    for (long dx = -1; dx <= 1; dx++) {
+                        for (long dy = -1; dy <= 1; dy++) {
+                            for (long dz = -1; dz <= 1; dz++) {
+                                const auto neighbor =
+                                        (wrap(cx + dx) * m_cells_per_side + wrap(cy + dy)) *
+                                                m_cells_per_side +
+                                        wrap(cz + dz);
+                                m_full_stencils.push_back(neighbor);
+                                // Lexicographically positive offsets
+                                const bool is_half = (dx > 0) || (dx == 0 && dy > 0) ||
+                                                     (dx == 0 && dy == 0 && dz > 0);
+                                if (is_half) m_half_stencils.push_back(neighbor);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+};
+
+#endif//ESERCIZI_LSN_MS_CELLS_HPP
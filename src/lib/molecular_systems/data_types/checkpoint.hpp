@@ -0,0 +1,235 @@
+#ifndef ESERCIZI_LSN_MS_CHECKPOINT_HPP
+#define ESERCIZI_LSN_MS_CHECKPOINT_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <valarray>
+#include <vector>
+
+#include "vectors.hpp"
+
+namespace fs = std::filesystem;
+
+namespace detail {
+    // File layout, in native byte order: a header, then the payload. The payload is a plain
+    // sequence of values, in the order they were archived, with the length of every container
+    // in front of its elements and named sections marking each archived object
+    inline constexpr std::array<char, 8> checkpoint_magic{'L', 'S', 'N', 'C', 'K', 'P', 'T', '\0'};
+    inline constexpr uint32_t checkpoint_version = 3;
+
+    struct CheckpointHeader {
+        std::array<char, 8> magic{checkpoint_magic};
+        uint32_t version{checkpoint_version};
+        // sizeof(size_t), which must match between the writer and the reader
+        uint32_t word_size{sizeof(size_t)};
+        uint64_t payload_size{0};
+    };
+    static_assert(sizeof(CheckpointHeader) == 24);
+
+    template<class T, class Archive, class = void>
+    struct has_checkpoint : std::false_type {};
+    template<class T, class Archive>
+    struct has_checkpoint<T, Archive,
+                          std::void_t<decltype(std::declval<T &>().checkpoint(
+                                  std::declval<Archive &>()))>> : std::true_type {};
+
+    template<class T>
+    struct is_sequence : std::false_type {};
+    template<class T, class A>
+    struct is_sequence<std::vector<T, A>> : std::true_type {};
+    template<class T>
+    struct is_sequence<std::valarray<T>> : std::true_type {};
+
+    template<class T>
+    struct is_tuple_like : std::false_type {};
+    template<class... T>
+    struct is_tuple_like<std::tuple<T...>> : std::true_type {};
+    template<class T, class U>
+    struct is_tuple_like<std::pair<T, U>> : std::true_type {};
+    template<class T, size_t N>
+    struct is_tuple_like<std::array<T, N>> : std::true_type {};
+
+    template<class T>
+    struct is_vectors : std::false_type {};
+    template<class T>
+    struct is_vectors<Vectors<T>> : std::true_type {};
+}// namespace detail
+
+/**
+ * Binary archive of a simulation state. Objects describe their state once, in a template member
+ * `template<class Archive> void checkpoint(Archive &archive)` which passes their members to
+ * archive(...): the same member stores them into a CheckpointWriter and restores them from a
+ * CheckpointReader (Archive::loading tells which). Arithmetic values, std::vector, std::valarray,
+ * std::string, Vectors, tuples, arrays and objects with a checkpoint member are supported. Values
+ * are copied as they are in memory, so that a restored state is bit-identical to the saved one.
+ * @tparam loading_ Whether values are restored (true) or stored (false).
+ */
+template<bool loading_>
+class CheckpointArchive {
+public:
+    static constexpr bool loading = loading_;
+
+    /**
+     * Stores or restores values, in order.
+     * @param values References to the values.
+     */
+    template<class... T>
+    void operator()(T &...values) {
+        (io(values), ...);
+    }
+
+    /**
+     * Marks the beginning of an object's state: a reader checks that the same object follows, so
+     * that restoring into a different kind of object fails instead of scrambling it.
+     * @param name Name of the section.
+     */
+    void section(std::string_view name) {
+        std::string stored(name);
+        io(stored);
+        if (loading && stored != name)
+            throw std::runtime_error("Checkpoint mismatch: expected " + std::string(name) +
+                                     ", found " + stored);
+    }
+
+    /**
+     * Stores a value, or checks that the restored one matches it, e.g. a number of particles
+     * that must not change across a restart.
+     * @param value Expected value.
+     * @param what Description used in the error message.
+     */
+    template<class T>
+    void expect(T value, std::string_view what) {
+        auto stored = value;
+        io(stored);
+        if (loading && !(stored == value))
+            throw std::runtime_error("Checkpoint mismatch: " + std::string(what) + " differs");
+    }
+
+    /**
+     * Stores or restores the state of a random number generator, through its stream operators
+     * (as provided by the standard engines and ARandom).
+     * @param rng The generator.
+     */
+    template<class URBG>
+    void rng(URBG &rng) {
+        std::string state;
+        if constexpr (!loading) {
+            std::ostringstream out;
+            out << rng;
+            state = out.str();
+        }
+        io(state);
+        if constexpr (loading) {
+            std::istringstream in(state);
+            if (!(in >> rng)) throw std::runtime_error("Could not restore a generator state");
+        }
+    }
+
+protected:
+    // Payload, and the position of the next value to be read
+    std::vector<char> m_payload{};
+    size_t m_cursor{0};
+
+    void bytes(void *data, size_t size) {
+        if constexpr (loading) {
+            if (size > m_payload.size() - m_cursor)
+                throw std::runtime_error("Truncated checkpoint");
+            std::memcpy(data, m_payload.data() + m_cursor, size);
+            m_cursor += size;
+        } else {
+            const auto *first = static_cast<const char *>(data);
+            m_payload.insert(m_payload.end(), first, first + size);
+        }
+    }
+
+    template<class T>
+    void io(T &value) {
+        if constexpr (detail::has_checkpoint<T, CheckpointArchive>::value) {
+            value.checkpoint(*this);
+        } else if constexpr (std::is_arithmetic_v<T> || std::is_enum_v<T>) {
+            bytes(&value, sizeof(value));
+        } else if constexpr (detail::is_sequence<T>::value || std::is_same_v<T, std::string>) {
+            uint64_t size = value.size();
+            io(size);
+            if constexpr (loading) value.resize(size_t(size));
+            using U = std::remove_reference_t<decltype(value[0])>;
+            if constexpr (std::is_arithmetic_v<U>) {
+                if (size > 0) bytes(&value[0], size_t(size) * sizeof(U));
+            } else {
+                for (auto &element: value) io(element);
+            }
+        } else if constexpr (detail::is_tuple_like<T>::value) {
+            std::apply([this](auto &...elements) { (io(elements), ...); }, value);
+        } else {
+            static_assert(detail::is_vectors<T>::value, "Type not supported by checkpoints");
+            io(value.e_i);
+            io(value.e_j);
+            io(value.e_k);
+        }
+    }
+};
+
+/**
+ * Collects a checkpoint in memory and writes it at once.
+ */
+class CheckpointWriter : public CheckpointArchive<false> {
+public:
+    /**
+     * Writes the checkpoint. The file is replaced atomically: an interrupted save leaves the
+     * previous checkpoint in place.
+     * @param path Output path.
+     */
+    void save(const fs::path &path) const {
+        detail::CheckpointHeader header;
+        header.payload_size = m_payload.size();
+        auto partial = path;
+        partial += ".partial";
+        {
+            std::ofstream out(partial, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            out.write(m_payload.data(), static_cast<std::streamsize>(m_payload.size()));
+            if (!out) throw std::runtime_error("Could not write " + partial.string());
+        }
+        fs::rename(partial, path);
+    }
+};
+
+/**
+ * Loads a checkpoint written by CheckpointWriter in memory. Values must be restored in the order
+ * they were stored.
+ */
+class CheckpointReader : public CheckpointArchive<true> {
+public:
+    explicit CheckpointReader(const fs::path &path) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in.is_open()) throw std::runtime_error("Could not open " + path.string());
+        detail::CheckpointHeader header;
+        if (!in.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+            header.magic != detail::checkpoint_magic)
+            throw std::runtime_error(path.string() + " is not a checkpoint");
+        if (header.version != detail::checkpoint_version)
+            throw std::runtime_error(path.string() + ": unsupported checkpoint version " +
+                                     std::to_string(header.version));
+        if (header.word_size != sizeof(size_t))
+            throw std::runtime_error(path.string() + " was written on a different architecture");
+        m_payload.resize(size_t(header.payload_size));
+        if (!in.read(m_payload.data(), static_cast<std::streamsize>(m_payload.size())))
+            throw std::runtime_error(path.string() + ": truncated checkpoint");
+    }
+
+    // Whether every stored value has been restored
+    [[nodiscard]] bool done() const noexcept { return m_cursor == m_payload.size(); }
+};
+
+#endif//ESERCIZI_LSN_MS_CHECKPOINT_HPP
@@ -5,11 +5,14 @@
 #ifndef ESERCIZI_LSN_MS_MEASURES_HPP
 #define ESERCIZI_LSN_MS_MEASURES_HPP
 
+#include <array>
 #include <cstddef>
 #include <vector>
 
 #include <rapidcsv.h>
 
+#include "estimators/accumulators.hpp"
+#include "estimators/blocking.hpp"
 #include "utils.hpp"
 
 namespace csv = rapidcsv;
@@ -85,6 +88,7 @@ public:
     template<Variable var>
     constexpr void push_measure(const var_out_t<field, var> &measure) {
         if constexpr (has_member<var>()) {
+            notify<var>(measure);
             std::get<indexer_v<var, VarList>>(m_measures).push_back(measure);
         }
     }
@@ -92,11 +96,22 @@ public:
     template<Variable var>
     constexpr void push_measure(var_out_t<field, var> &&measure) {
         if constexpr (has_member<var>()) {
+            notify<var>(measure);
             std::get<indexer_v<var, VarList>>(m_measures)
                     .push_back(std::forward<var_out_t<field, var>>(measure));
         }
     }
 
+    /**
+     * Passes every following measure of a scalar variable to a blocking analysis too.
+     * @param blocking The analysis, which must outlive the measures; nullptr detaches it.
+     */
+    template<Variable var>
+    constexpr void observe(estimators::Blocking<field> *blocking) {
+        static_assert(has_member<var>() && var != Variable::RadialFn);
+        m_observers[indexer_v<var, VarList>] = blocking;
+    }
+
     // NOTE: this is terrible
     template<Variable var>
     constexpr void push_vector(const std::vector<field> &measure) {
@@ -134,6 +149,78 @@ public:
 
 private:
     std::tuple<std::vector<var_out_t<field, vars>>...> m_measures;
+    std::array<estimators::Blocking<field> *, N_VARS> m_observers{};
+
+    template<Variable var>
+    constexpr void notify(const var_out_t<field, var> &measure) {
+        if constexpr (var != Variable::RadialFn) {
+            if (auto *blocking = m_observers[indexer_v<var, VarList>]) blocking->push(measure);
+        }
+    }
+};
+
+/**
+ * Drop-in replacement of MeasureOutputs for block averages: measures are pushed into online
+ * accumulators instead of being stored, so that memory does not grow with the block size and the
+ * block average is ready at the end of the block. MeasureOutputs keeps the whole series, as needed
+ * e.g. by autocorrelation studies.
+ */
+template<typename field, Variable... vars>
+class OnlineMeasures {
+    typedef varlist<vars...> VarList;
+
+public:
+    constexpr void clear() {
+        utils::tuple_apply([&](auto &accumulator) { accumulator.reset(); }, m_accumulators);
+    }
+
+    template<Variable var>
+    constexpr void push_measure(const var_out_t<field, var> &measure) {
+        if constexpr (has_member<var>()) {
+            if constexpr (var != Variable::RadialFn) {
+                if (auto *blocking = m_observers[indexer_v<var, VarList>]) blocking->push(measure);
+            }
+            std::get<indexer_v<var, VarList>>(m_accumulators).push(measure);
+        }
+    }
+
+    // As MeasureOutputs::observe
+    template<Variable var>
+    constexpr void observe(estimators::Blocking<field> *blocking) {
+        static_assert(has_member<var>() && var != Variable::RadialFn);
+        m_observers[indexer_v<var, VarList>] = blocking;
+    }
+
+    template<Variable var>
+    constexpr void push_vector(const std::vector<field> &measure) {
+        push_measure<var>(measure);
+    }
+
+    // Bins are sized by the first push
+    template<Variable var>
+    constexpr void init_vector(size_t /*n_bins*/) {}
+
+    template<Variable var>
+    static constexpr bool has_member() {
+        return ((var == vars) || ...);
+    }
+
+    template<Variable var>
+    constexpr auto &get_accumulator() const {
+        static_assert(has_member<var>());
+        return std::get<indexer_v<var, VarList>>(m_accumulators);
+    }
+
+    auto &all_accumulators() const { return m_accumulators; }
+
+    static constexpr size_t N_VARS = sizeof...(vars);
+
+    static constexpr size_t N_SCALARS =
+            N_VARS - static_cast<size_t>(has_member<Variable::RadialFn>());
+
+private:
+    std::tuple<estimators::Welford<var_out_t<field, vars>>...> m_accumulators;
+    std::array<estimators::Blocking<field> *, N_VARS> m_observers{};
 };
 
 #endif//ESERCIZI_LSN_MS_MEASURES_HPP
@@ -0,0 +1,153 @@
+#ifndef ESERCIZI_LSN_MS_NEIGHBOR_LIST_HPP
+#define ESERCIZI_LSN_MS_NEIGHBOR_LIST_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iterator>
+#include <optional>
+#include <vector>
+
+#include "cells.hpp"
+#include "vectors.hpp"
+
+/**
+ * Verlet neighbor list: for each particle stores the partners lying within cutoff + skin at the time
+ * of the last build. The list stays valid (i.e. contains every pair within the cutoff) until some
+ * particle has moved by more than skin / 2.
+ * @tparam field The numeric field of the coordinates
+ */
+template<typename field>
+class NeighborList {
+public:
+    /**
+     * Initializer.
+     * @param box_edge The periodic box edge.
+     * @param cutoff Interaction cutoff.
+     * @param skin Additional shell stored in the list.
+     */
+    NeighborList(field box_edge, field cutoff, field skin)
+        : m_box_edge(box_edge), m_skin(skin), m_radius2((cutoff + skin) * (cutoff + skin)) {
+        // The list is built in O(N) using linked cells whenever the box is big enough
+        CellList<field> cells(box_edge, cutoff + skin);
+        if (cells.usable()) m_cells = std::move(cells);
+    }
+
+    /**
+     * Whether the list must be rebuilt because a particle moved by more than skin / 2 since the last
+     * build.
+     * @param positions Current (PBC) positions.
+     */
+    [[nodiscard]] bool outdated(const Vectors<field> &positions) const {
+        if (m_reference.e_i.size() != positions.e_i.size()) return true;
+        const auto threshold2 = m_skin * m_skin / field(4);
+        for (size_t i = 0; i < positions.e_i.size(); i++) {
+            const auto dx = pbc(positions.e_i[i] - m_reference.e_i[i]);
+            const auto dy = pbc(positions.e_j[i] - m_reference.e_j[i]);
+            const auto dz = pbc(positions.e_k[i] - m_reference.e_k[i]);
+            if (dx * dx + dy * dy + dz * dz > threshold2) return true;
+        }
+        return false;
+    }
+
+    /**
+     * Stores every pair within cutoff + skin.
+     * @param positions Current (PBC) positions.
+     */
+    void build(const Vectors<field> &positions) {
+        const auto n_particles = positions.e_i.size();
+        // Pairs are first collected per particle, then flattened
+        m_buckets.resize(n_particles);
+        for (auto &bucket: m_buckets) bucket.clear();
+        const auto add = [&](size_t i, size_t j) {
+            const auto dx = pbc(positions.e_i[i] - positions.e_i[j]);
+            const auto dy = pbc(positions.e_j[i] - positions.e_j[j]);
+            const auto dz = pbc(positions.e_k[i] - positions.e_k[j]);
+            if (dx * dx + dy * dy + dz * dz < m_radius2)
+                m_buckets[std::min(i, j)].push_back(std::max(i, j));
+        };
+        if (m_cells.has_value()) {
+            m_cells->build(positions);
+            m_cells->for_each_pair(add);
+        } else {
+            for (size_t i = 0; i + 1 < n_particles; i++)
+                for (size_t j = i + 1; j < n_particles; j++) add(i, j);
+        }
+        m_offsets.resize(n_particles + 1);
+        m_offsets[0] = 0;
+        for (size_t i = 0; i < n_particles; i++)
+            m_offsets[i + 1] = m_offsets[i] + m_buckets[i].size();
+        m_partners.resize(m_offsets.back());
+        for (size_t i = 0; i < n_particles; i++)
+            std::copy(m_buckets[i].cbegin(), m_buckets[i].cend(),
+                      std::next(m_partners.begin(), static_cast<long>(m_offsets[i])));
+        m_reference = positions;
+        m_rebuilds++;
+    }
+
+    /**
+     * Rebuilds the list only if it is outdated.
+     * @param positions Current (PBC) positions.
+     * @return Whether the list was rebuilt.
+     */
+    bool update(const Vectors<field> &positions) {
+        if (!outdated(positions)) return false;
+        build(positions);
+        return true;
+    }
+
+    /**
+     * Calls f(i, j) once for every stored pair, with i < j. The particles can be split in
+     * interleaved slices: only slice "first" out of "stride" is processed.
+     * @param f Pair action.
+     * @param first Index of the slice.
+     * @param stride Number of slices.
+     */
+    template<class PairFn>
+    void for_each_pair(PairFn f, size_t first = 0, size_t stride = 1) const {
+        for (size_t i = first; i + 1 < m_offsets.size(); i += stride) {
+            for (size_t k = m_offsets[i]; k < m_offsets[i + 1]; k++) f(i, m_partners[k]);
+        }
+    }
+
+    /**
+     * Stores or restores the list (see CheckpointArchive). Only the positions of the last build are
+     * stored: the list is rebuilt from them, so that it holds the same pairs in the same order and
+     * expires at the same step as the saved one.
+     * @param archive A checkpoint writer or reader.
+     */
+    template<class Archive>
+    void checkpoint(Archive &archive) {
+        archive.expect(m_skin, "neighbor list skin");
+        archive(m_reference, m_rebuilds);
+        if constexpr (Archive::loading) {
+            if (m_reference.e_i.size() == 0) return;
+            const auto reference = m_reference;
+            const auto rebuilds = m_rebuilds;
+            build(reference);
+            m_rebuilds = rebuilds;
+        }
+    }
+
+    // Number of times the list has been built
+    [[nodiscard]] size_t rebuilds() const noexcept { return m_rebuilds; }
+    [[nodiscard]] size_t n_pairs() const noexcept { return m_partners.size(); }
+    [[nodiscard]] field skin() const noexcept { return m_skin; }
+
+private:
+    field m_box_edge, m_skin, m_radius2;
+    std::optional<CellList<field>> m_cells{};
+    // Partners of particle i are m_partners[m_offsets[i]:m_offsets[i+1]]
+    std::vector<size_t> m_offsets{}, m_partners{};
+    // Scratch space used while building
+    std::vector<std::vector<size_t>> m_buckets{};
+    // Positions at the time of the last build
+    Vectors<field> m_reference{0};
+    size_t m_rebuilds{0};
+
+    inline field pbc(field x) const noexcept {
+        return x - m_box_edge * std::rint(x / m_box_edge);
+    }
+};
+
+#endif//ESERCIZI_LSN_MS_NEIGHBOR_LIST_HPP
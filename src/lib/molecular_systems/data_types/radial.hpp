@@ -0,0 +1,129 @@
+#ifndef ESERCIZI_LSN_MS_RADIAL_HPP
+#define ESERCIZI_LSN_MS_RADIAL_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+/**
+ * Running histogram of the pair distances, normalized to the radial distribution function g(r)
+ * only when a block is closed. Pairs are binned into a caller-owned count buffer of n_bins() + 1
+ * entries, the last one collecting the pairs beyond r_max, so that binning needs no branch. The
+ * buffer of a sampled configuration is then pushed into the running counts of the block.
+ * @tparam field Numeric field of the coordinates
+ * @tparam Field Numeric field of g(r)
+ */
+template<typename field, typename Field = field>
+class RadialHistogram {
+public:
+    /**
+     * Initializer.
+     * @param n_bins Number of bins.
+     * @param r_max Largest distance in the histogram.
+     * @param n_particles Number of particles.
+     * @param density Number density.
+     * @param stride A configuration is sampled every stride steps.
+     */
+    RadialHistogram(size_t n_bins, field r_max, size_t n_particles, Field density,
+                    size_t stride = 1)
+        : m_n_bins(n_bins), m_stride(std::max(size_t(1), stride)), m_r_max(r_max),
+          m_r_max2(r_max * r_max), m_inv_dr(field(n_bins) / r_max), m_counts(n_bins + 1, 0),
+          m_normcoeffs(n_bins), m_rs(n_bins) {
+        const auto dr = Field(r_max) / Field(n_bins);
+        const Field k = static_cast<Field>(n_particles) * density;
+        const auto cube = [](Field x) { return x * x * x; };
+        Field r{0};
+        for (size_t bin = 0; bin < n_bins; bin++) {
+            Field dV_r = (Field(4) * Field(M_PI) / Field(3)) * (cube(r + dr) - cube(r));
+            m_normcoeffs[bin] = Field(1) / (k * dV_r);
+            m_rs[bin] = r;
+            r += dr;
+        }
+    }
+
+    // Whether the configuration at the given time step must be sampled
+    [[nodiscard]] bool due(size_t time) const noexcept { return time % m_stride == 0; }
+
+    // Whether every binned pair lies within distance r
+    [[nodiscard]] bool within(field r) const noexcept { return m_r_max <= r; }
+
+    /**
+     * Bin of a pair.
+     * @param r2 Squared (minimum image) distance of the pair.
+     * @return The bin index, or n_bins() if the pair lies beyond r_max.
+     */
+    [[nodiscard]] inline size_t bin(field r2) const noexcept {
+        if (r2 >= m_r_max2) return m_n_bins;
+        return std::min(static_cast<size_t>(std::sqrt(r2) * m_inv_dr), m_n_bins - 1);
+    }
+
+    /**
+     * Adds the counts of a sampled configuration to the block.
+     * @param counts Count buffer of n_bins() + 1 entries, as filled using bin().
+     */
+    void push(const std::vector<size_t> &counts) {
+        std::transform(m_counts.begin(), m_counts.end(), counts.begin(), m_counts.begin(),
+                       std::plus<>());
+        m_samples++;
+    }
+
+    /**
+     * Normalizes a count buffer to g(r).
+     * @param counts Count buffer of n_bins() + 1 entries, each pair counted twice.
+     * @param n_samples Number of configurations summed in counts.
+     * @param g_r Output, resized to n_bins().
+     */
+    void normalize(const std::vector<size_t> &counts, size_t n_samples,
+                   std::vector<Field> &g_r) const {
+        g_r.resize(m_n_bins);
+        const auto inv_samples = n_samples > 0 ? Field(1) / Field(n_samples) : Field(0);
+        for (size_t bin = 0; bin < m_n_bins; bin++)
+            g_r[bin] = Field(counts[bin]) * m_normcoeffs[bin] * inv_samples;
+    }
+
+    /**
+     * Closes the block: stores the average g(r) of the sampled configurations and resets the
+     * running counts.
+     * @param g_r Output, resized to n_bins().
+     */
+    void block_average(std::vector<Field> &g_r) {
+        normalize(m_counts, m_samples, g_r);
+        reset();
+    }
+
+    void reset() {
+        std::fill(m_counts.begin(), m_counts.end(), size_t(0));
+        m_samples = 0;
+    }
+
+    /**
+     * Stores or restores the counts of the current block (see CheckpointArchive).
+     * @param archive A checkpoint writer or reader.
+     */
+    template<class Archive>
+    void checkpoint(Archive &archive) {
+        archive.expect(m_n_bins, "number of g(r) bins");
+        archive(m_counts, m_samples);
+    }
+
+    [[nodiscard]] size_t n_bins() const noexcept { return m_n_bins; }
+    [[nodiscard]] size_t stride() const noexcept { return m_stride; }
+    // Number of configurations sampled in the current block
+    [[nodiscard]] size_t n_samples() const noexcept { return m_samples; }
+    // Lower edge of each bin
+    [[nodiscard]] const std::vector<Field> &rs() const noexcept { return m_rs; }
+
+private:
+    size_t m_n_bins, m_stride;
+    field m_r_max, m_r_max2, m_inv_dr;
+    // Running counts of the block, overflow bin included
+    std::vector<size_t> m_counts;
+    size_t m_samples{0};
+    // Normalization coefficients: 1/(rho*N*dV)
+    std::vector<Field> m_normcoeffs;
+    std::vector<Field> m_rs;
+};
+
+#endif//ESERCIZI_LSN_MS_RADIAL_HPP
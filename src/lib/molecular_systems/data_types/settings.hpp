@@ -35,6 +35,31 @@ struct ThermoSettings {
     field temperature, density;
 };
 
+/**
+ * Tail correction to the potential energy per particle of a truncated Lennard-Jones system
+ * @param density Numeric density.
+ * @param cutoff Interaction cutoff.
+ */
+template<typename field>
+inline field lj_u_tail_correction(field density, field cutoff) {
+    const auto rc3 = cutoff * cutoff * cutoff;
+    return field(8) * field(M_PI) * density *
+           (field(1) / (field(9) * rc3 * rc3 * rc3) - field(1) / (field(3) * rc3));
+}
+
+/**
+ * Tail correction to the virial of a truncated Lennard-Jones system
+ * @param density Numeric density.
+ * @param n_particles Number of particles.
+ * @param cutoff Interaction cutoff.
+ */
+template<typename field>
+inline field lj_W_tail_correction(field density, size_t n_particles, field cutoff) {
+    const auto rc3 = cutoff * cutoff * cutoff;
+    return field(96) * field(M_PI) * density * static_cast<field>(n_particles) *
+           (field(1) / (field(9) * rc3 * rc3 * rc3) - field(1) / (field(6) * rc3));
+}
+
 /**
  * Collection of MD related settings
  * @tparam field
@@ -46,10 +71,8 @@ struct SimulationSettings {
         : n_particles{n_part}, n_blocks{n_b},
           block_size{n_s}, cutoff{r}, cutoff2{r * r}, volume{field(n_particles) / density},
           box_edge{std::cbrt(volume)}, delta{d}, delta2{delta * delta}, dbldelta{2 * delta},
-          u_tail_correction{8 * M_PI * density *
-                            (1.0 / (9 * std::pow(cutoff, 9)) - 1.0 / (3 * std::pow(cutoff, 3)))},
-          W_tail_correction{field(96) * M_PI * density * static_cast<field>(n_particles) *
-                            (1.0 / (9 * std::pow(cutoff, 9)) - 1.0 / (6 * std::pow(cutoff, 3)))} {}
+          u_tail_correction{lj_u_tail_correction(density, cutoff)},
+          W_tail_correction{lj_W_tail_correction(density, n_particles, cutoff)} {}
 
     explicit SimulationSettings(const fs::path &settings_path) {
         std::ifstream settings(settings_path);
@@ -0,0 +1,267 @@
+#ifndef ESERCIZI_LSN_MS_TRAJECTORY_HPP
+#define ESERCIZI_LSN_MS_TRAJECTORY_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "vectors.hpp"
+
+namespace fs = std::filesystem;
+
+/**
+ * How coordinates are stored in a trajectory file.
+ * Exact: 64-bit floats, as they are in memory.
+ * Fixed16: coordinates folded into the box and stored as 16-bit fractions of the box edge, with an
+ * error of at most box_edge / 2^17: four times smaller frames, meant for visualization.
+ */
+enum class TrajectoryEncoding : uint32_t { Exact = 0, Fixed16 = 1 };
+
+/**
+ * Time step and box edge of a trajectory frame.
+ */
+struct TrajectoryFrame {
+    uint64_t step;
+    double box_edge;
+};
+
+namespace detail {
+    // File layout, in native byte order: a header, then fixed-size frames, each made of the step,
+    // the box edge and the x, y and z coordinates of every particle
+    inline constexpr std::array<char, 8> trajectory_magic{'L', 'S', 'N', 'T', 'R', 'A', 'J', '\0'};
+    inline constexpr uint32_t trajectory_version = 1;
+
+    struct TrajectoryHeader {
+        std::array<char, 8> magic{trajectory_magic};
+        uint32_t version{trajectory_version};
+        TrajectoryEncoding encoding{TrajectoryEncoding::Exact};
+        uint64_t n_particles{0};
+        uint64_t frame_size{0};
+    };
+    static_assert(sizeof(TrajectoryHeader) == 32);
+
+    inline uint64_t trajectory_frame_size(uint64_t n_particles, TrajectoryEncoding encoding) {
+        const uint64_t coordinate_size = encoding == TrajectoryEncoding::Exact ? 8 : 2;
+        return sizeof(TrajectoryFrame) + 3 * n_particles * coordinate_size;
+    }
+
+    inline TrajectoryHeader read_trajectory_header(std::istream &in, const fs::path &path) {
+        TrajectoryHeader header;
+        if (!in.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+            header.magic != trajectory_magic)
+            throw std::runtime_error(path.string() + " is not a trajectory file");
+        if (header.version != trajectory_version)
+            throw std::runtime_error(path.string() + ": unsupported trajectory version " +
+                                     std::to_string(header.version));
+        if (header.frame_size != trajectory_frame_size(header.n_particles, header.encoding))
+            throw std::runtime_error(path.string() + ": corrupted trajectory header");
+        return header;
+    }
+}// namespace detail
+
+/**
+ * Append-only binary trajectory: a single file with a header and fixed-size frames, so that a
+ * frame is found by its offset. Each frame is packed in memory and written at once; nothing is
+ * flushed until the writer is closed or flush() is called.
+ */
+class TrajectoryWriter {
+public:
+    /**
+     * Opens a trajectory file.
+     * @param path Path to the trajectory.
+     * @param n_particles Number of particles in each frame.
+     * @param encoding How coordinates are stored.
+     * @param append Whether to append to an existing trajectory of the same kind, instead of
+     * overwriting it. A partially written last frame is discarded.
+     */
+    TrajectoryWriter(const fs::path &path, size_t n_particles,
+                     TrajectoryEncoding encoding = TrajectoryEncoding::Exact, bool append = false)
+        : m_encoding(encoding), m_n_particles(n_particles),
+          m_frame(detail::trajectory_frame_size(n_particles, encoding)) {
+        if (append && fs::exists(path)) {
+            std::ifstream in(path, std::ios::binary);
+            const auto header = detail::read_trajectory_header(in, path);
+            if (header.n_particles != n_particles || header.encoding != encoding)
+                throw std::runtime_error(path.string() +
+                                         ": cannot append frames of a different kind");
+            in.close();
+            const auto n_frames = (fs::file_size(path) - sizeof(header)) / m_frame.size();
+            fs::resize_file(path, sizeof(header) + n_frames * m_frame.size());
+            m_file.open(path, std::ios::binary | std::ios::app);
+        } else {
+            m_file.open(path, std::ios::binary | std::ios::trunc);
+            detail::TrajectoryHeader header;
+            header.encoding = encoding;
+            header.n_particles = n_particles;
+            header.frame_size = m_frame.size();
+            m_file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        }
+        if (!m_file) throw std::runtime_error("Could not open " + path.string());
+    }
+
+    /**
+     * Appends a frame.
+     * @param positions Particles positions.
+     * @param box_edge Edge of the periodic box.
+     * @param step Time step of the frame.
+     */
+    template<typename field>
+    void write(const Vectors<field> &positions, field box_edge, size_t step) {
+        if (positions.e_i.size() != m_n_particles)
+            throw std::runtime_error("The frame does not match the trajectory's particles");
+        const TrajectoryFrame frame{uint64_t(step), double(box_edge)};
+        std::memcpy(m_frame.data(), &frame, sizeof(frame));
+        char *out = m_frame.data() + sizeof(frame);
+        for (const auto *axis: {&positions.e_i, &positions.e_j, &positions.e_k}) {
+            if (m_encoding == TrajectoryEncoding::Exact) {
+                for (const auto x: *axis) {
+                    const auto xd = double(x);
+                    std::memcpy(out, &xd, sizeof(xd));
+                    out += sizeof(xd);
+                }
+            } else {
+                // Fractions of the box edge in [0, 1), rounded to 16 bits
+                const auto inv_edge = 1 / double(box_edge);
+                for (const auto x: *axis) {
+                    const auto s = double(x) * inv_edge;
+                    const auto q = static_cast<uint16_t>(
+                            std::llround((s - std::floor(s)) * 65536.0) & 0xFFFF);
+                    std::memcpy(out, &q, sizeof(q));
+                    out += sizeof(q);
+                }
+            }
+        }
+        m_file.write(m_frame.data(), static_cast<std::streamsize>(m_frame.size()));
+        if (!m_file) throw std::runtime_error("Could not write a trajectory frame");
+    }
+
+    void flush() { m_file.flush(); }
+
+    [[nodiscard]] TrajectoryEncoding encoding() const noexcept { return m_encoding; }
+
+private:
+    const TrajectoryEncoding m_encoding;
+    const size_t m_n_particles;
+    std::vector<char> m_frame;
+    std::ofstream m_file;
+};
+
+/**
+ * Random access reader of trajectories written by TrajectoryWriter.
+ */
+class TrajectoryReader {
+public:
+    explicit TrajectoryReader(const fs::path &path) : m_file(path, std::ios::binary) {
+        if (!m_file.is_open()) throw std::runtime_error("Could not open " + path.string());
+        m_header = detail::read_trajectory_header(m_file, path);
+        // A partially written last frame is ignored
+        m_n_frames = size_t((fs::file_size(path) - sizeof(m_header)) / m_header.frame_size);
+        m_frame.resize(m_header.frame_size);
+    }
+
+    [[nodiscard]] size_t n_frames() const noexcept { return m_n_frames; }
+    [[nodiscard]] size_t n_particles() const noexcept { return size_t(m_header.n_particles); }
+    [[nodiscard]] TrajectoryEncoding encoding() const noexcept { return m_header.encoding; }
+
+    /**
+     * Reads a frame. Fixed16 positions are folded into [0, box_edge).
+     * @param frame Index of the frame.
+     * @param positions Where positions will be stored; resized if needed.
+     * @return Time step and box edge of the frame.
+     */
+    template<typename field>
+    TrajectoryFrame read(size_t frame, Vectors<field> &positions) {
+        if (frame >= m_n_frames) throw std::out_of_range("No such trajectory frame");
+        m_file.seekg(static_cast<std::streamoff>(sizeof(m_header) + frame * m_header.frame_size));
+        if (!m_file.read(m_frame.data(), static_cast<std::streamsize>(m_frame.size())))
+            throw std::runtime_error("Could not read a trajectory frame");
+        TrajectoryFrame info{};
+        std::memcpy(&info, m_frame.data(), sizeof(info));
+        const auto n = n_particles();
+        if (positions.e_i.size() != n) positions = Vectors<field>(n);
+        const char *in = m_frame.data() + sizeof(info);
+        for (auto *axis: {&positions.e_i, &positions.e_j, &positions.e_k}) {
+            if (encoding() == TrajectoryEncoding::Exact) {
+                for (auto &x: *axis) {
+                    double xd;
+                    std::memcpy(&xd, in, sizeof(xd));
+                    x = field(xd);
+                    in += sizeof(xd);
+                }
+            } else {
+                const auto scale = info.box_edge / 65536.0;
+                for (auto &x: *axis) {
+                    uint16_t q;
+                    std::memcpy(&q, in, sizeof(q));
+                    x = field(double(q) * scale);
+                    in += sizeof(q);
+                }
+            }
+        }
+        return info;
+    }
+
+    /**
+     * Finds the frame of a time step, assuming steps increase along the trajectory.
+     * @param step Time step.
+     * @return Index of the first frame whose step is not less than the given one (n_frames() if
+     * there is none).
+     */
+    size_t frame_of(size_t step) {
+        size_t first = 0, count = m_n_frames;
+        while (count > 0) {
+            const auto half = count / 2;
+            if (step_at(first + half) < step) {
+                first += half + 1;
+                count -= half + 1;
+            } else {
+                count = half;
+            }
+        }
+        return first;
+    }
+
+private:
+    uint64_t step_at(size_t frame) {
+        m_file.seekg(static_cast<std::streamoff>(sizeof(m_header) + frame * m_header.frame_size));
+        uint64_t step;
+        m_file.read(reinterpret_cast<char *>(&step), sizeof(step));
+        return step;
+    }
+
+    std::ifstream m_file;
+    detail::TrajectoryHeader m_header;
+    size_t m_n_frames;
+    std::vector<char> m_frame;
+};
+
+/**
+ * Converts a trajectory into one xyz file per frame, named after its time step, with coordinates
+ * in units of the box edge (as LJMono::save_xyz_positions does).
+ * @param trajectory_path Path to the trajectory.
+ * @param dir Directory where the xyz files will be stored.
+ * @return Number of converted frames.
+ */
+inline size_t trajectory_to_xyz(const fs::path &trajectory_path, const fs::path &dir) {
+    TrajectoryReader reader(trajectory_path);
+    if (!fs::exists(dir)) fs::create_directories(dir);
+    Vectors<double> positions(reader.n_particles());
+    for (size_t frame = 0; frame < reader.n_frames(); frame++) {
+        const auto info = reader.read(frame, positions);
+        positions.save_xyz_configuration(
+                dir / (std::to_string(info.step) + ".xyz"), [&](const auto x) {
+                    return (x - info.box_edge * std::rint(x / info.box_edge)) / info.box_edge;
+                });
+    }
+    return reader.n_frames();
+}
+
+#endif//ESERCIZI_LSN_MS_TRAJECTORY_HPP
@@ -9,9 +9,12 @@
 #include <filesystem>
 #include <fstream>
 #include <iterator>
+#include <type_traits>
 #include <utility>
 #include <valarray>
 
+#include "mapped_table.hpp"
+
 namespace fs = std::filesystem;
 
 /**
@@ -24,6 +27,8 @@ struct Vectors {
 
     explicit Vectors(size_t size) : e_i(size), e_j(size), e_k(size) {}
 
+    Vectors(const Vectors<field> &) = default;
+
     // clang-format off
     Vectors(v_type &&v_i, v_type &&v_j, v_type &&v_k)
         : e_i{std::forward<v_type>(v_i)},
@@ -32,11 +37,21 @@ struct Vectors {
     // clang-format on
 
     /**
-     * Initialize from transform configuration file consisting of three columns of numbers separated by spaces
+     * Initialize from transform configuration file consisting of three columns of numbers separated by spaces,
+     * or from a binary table with three columns (see mapped_table.hpp), which is mapped instead of parsed
      * @param size
      * @param configuration_path
      */
     Vectors(size_t size, const fs::path &configuration_path) : Vectors(size) {
+        if (is_binary_table(configuration_path)) {
+            const MappedTable configuration(configuration_path);
+            if (configuration.n_columns() != 3)
+                throw std::runtime_error(configuration_path.string() + " is not a configuration");
+            configuration.copy_column<double>(0, std::begin(e_i), size);
+            configuration.copy_column<double>(1, std::begin(e_j), size);
+            configuration.copy_column<double>(2, std::begin(e_k), size);
+            return;
+        }
         std::ifstream configuration(configuration_path);
         if (!configuration.is_open())
             throw std::runtime_error("Could not open " + configuration_path.string());
@@ -80,16 +95,25 @@ struct Vectors {
         std::ofstream configuration(configuration_path);
         if (!configuration.is_open())
             throw std::runtime_error("Could not open " + configuration_path.string());
-        configuration << e_i.size() << std::endl;
-        configuration << "Comment" << std::endl;
+        configuration << e_i.size() << '\n';
+        configuration << "Comment" << '\n';
         for (size_t i = 0; i < e_i.size(); ++i) {
             configuration << "LJ  " << f(e_i[i]) << "   " << f(e_j[i]) << "   " << f(e_k[i])
-                          << std::endl;
+                          << '\n';
         }
         configuration.close();
     }
     
 
+    /**
+     * Exchanges the coordinates with those of another set of vectors, without copies.
+     */
+    void swap(Vectors<field> &oth) noexcept {
+        e_i.swap(oth.e_i);
+        e_j.swap(oth.e_j);
+        e_k.swap(oth.e_k);
+    }
+
     friend Vectors operator-(const Vectors &lhs, const Vectors &rhs) noexcept {
         return {lhs.e_i - rhs.e_i, lhs.e_j - rhs.e_j, lhs.e_k - rhs.e_k};
     }
@@ -120,6 +144,13 @@ struct Vectors {
         return *this;
     }
 
+    Vectors &operator+=(const Vectors<field> &oth) noexcept {
+        e_i += oth.e_i;
+        e_j += oth.e_j;
+        e_k += oth.e_k;
+        return *this;
+    }
+
     friend bool operator==(const Vectors<field> &lhs, const Vectors<field> &rhs) {
         return std::equal(std::begin(lhs.e_i), std::end(lhs.e_i), std::begin(rhs.e_i)) &&
                std::equal(std::begin(lhs.e_j), std::end(lhs.e_j), std::begin(rhs.e_j)) &&
@@ -148,9 +179,19 @@ struct Vectors {
 
     /**
      * Sum of all coordinates squared
-     * @return
+     * @tparam out Numeric field of the sum, possibly wider than field
      */
-    field full_norm2() const noexcept { return (e_i * e_i + e_j * e_j + e_k * e_k).sum(); }
+    template<typename out = field>
+    out full_norm2() const noexcept {
+        if constexpr (std::is_same_v<out, field>) return (e_i * e_i + e_j * e_j + e_k * e_k).sum();
+        else {
+            out norm2{0};
+            for (size_t i = 0; i < e_i.size(); i++)
+                norm2 += out(e_i[i]) * out(e_i[i]) + out(e_j[i]) * out(e_j[i]) +
+                         out(e_k[i]) * out(e_k[i]);
+            return norm2;
+        }
+    }
 
     /**
      * Applies f to each coordinate in-place
@@ -0,0 +1,196 @@
+#ifndef ESERCIZI_LSN_MS_KERNELS_HPP
+#define ESERCIZI_LSN_MS_KERNELS_HPP
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+
+/**
+ * Lennard-Jones pair kernels. They work on batches of pairs, given as the raw coordinate
+ * differences of the two particles: differences are replaced by their minimum image, the force
+ * factors f_ij / r_ij (zero beyond the cutoff) are stored and the potential and virial (sum of
+ * f_ij * r_ij) sums are accumulated. Forces follow as f_ij = factor * dr_ij. Every power of r is
+ * computed from a single reciprocal of r^2.
+ */
+namespace molecular_systems::kernels {
+    template<typename field>
+    using lj_batch_fn = void (*)(field *dx, field *dy, field *dz, field *factors, size_t n,
+                                 field box_edge, field cutoff2, field &potential, field &virial);
+
+    /**
+     * Reference scalar kernel.
+     * @param dx,dy,dz Coordinate differences, replaced by their minimum image.
+     * @param factors Output force factors.
+     * @param n Number of pairs.
+     * @param box_edge Periodic box edge.
+     * @param cutoff2 Squared interaction cutoff.
+     * @param potential Potential sum, incremented.
+     * @param virial Virial sum, incremented.
+     */
+    template<typename field>
+    void lj_batch_scalar(field *dx, field *dy, field *dz, field *factors, size_t n,
+                         field box_edge, field cutoff2, field &potential, field &virial) {
+        for (size_t k = 0; k < n; k++) {
+            dx[k] -= box_edge * std::rint(dx[k] / box_edge);
+            dy[k] -= box_edge * std::rint(dy[k] / box_edge);
+            dz[k] -= box_edge * std::rint(dz[k] / box_edge);
+            const auto r2 = dx[k] * dx[k] + dy[k] * dy[k] + dz[k] * dz[k];
+            factors[k] = field(0);
+            if (r2 < cutoff2) {
+                const auto inv_r2 = field(1) / r2;
+                const auto inv_r6 = inv_r2 * inv_r2 * inv_r2;
+                const auto inv_r12 = inv_r6 * inv_r6;
+                const auto w = field(48) * inv_r12 - field(24) * inv_r6;
+                potential += field(4) * (inv_r12 - inv_r6);
+                virial += w;
+                factors[k] = w * inv_r2;
+            }
+        }
+    }
+
+    namespace detail {
+        // Adding and subtracting 1.5 * 2^(digits - 1) rounds to the nearest integer like std::rint
+        // (for |x| < 2^(digits - 2)) using plain vector arithmetic
+        template<typename field>
+        constexpr field rint_magic =
+                field(3) * field(uint64_t(1) << (std::numeric_limits<field>::digits - 2));
+
+        template<typename field, size_t width>
+        struct pack {
+            typedef field type __attribute__((vector_size(width * sizeof(field))));
+        };
+
+        template<typename field, size_t width>
+        using pack_t = typename pack<field, width>::type;
+
+        template<typename Pack>
+        inline __attribute__((always_inline)) Pack load(const void *src) {
+            Pack v;
+            std::memcpy(&v, src, sizeof(Pack));
+            return v;
+        }
+
+        template<typename Pack>
+        inline __attribute__((always_inline)) void store(void *dst, const Pack &v) {
+            std::memcpy(dst, &v, sizeof(Pack));
+        }
+
+        /**
+         * Vector kernel working on "width" pairs at once. The cutoff is applied by masking, the
+         * remainder of the batch is left to the scalar kernel.
+         */
+        template<typename field, size_t width>
+        inline __attribute__((always_inline)) void
+        lj_batch_vector(field *dx, field *dy, field *dz, field *factors, size_t n, field box_edge,
+                        field cutoff2, field &potential, field &virial) {
+            typedef pack_t<field, width> v_type;
+            const v_type zero{};
+            const v_type edge = zero + box_edge, magic = zero + rint_magic<field>,
+                         rc2 = zero + cutoff2, one = zero + field(1), c24 = zero + field(24),
+                         c48 = zero + field(48);
+            v_type potential_acc = zero, virial_acc = zero;
+            size_t k = 0;
+            for (; k + width <= n; k += width) {
+                auto x = load<v_type>(dx + k), y = load<v_type>(dy + k), z = load<v_type>(dz + k);
+                x -= edge * ((x / edge + magic) - magic);
+                y -= edge * ((y / edge + magic) - magic);
+                z -= edge * ((z / edge + magic) - magic);
+                store(dx + k, x);
+                store(dy + k, y);
+                store(dz + k, z);
+                const auto r2 = x * x + y * y + z * z;
+                const auto inside = r2 < rc2;
+                // Pairs beyond the cutoff get a harmless r^2 = 1 and are masked out afterwards
+                const v_type inv_r2 = one / (inside ? r2 : one);
+                const auto inv_r6 = inv_r2 * inv_r2 * inv_r2;
+                const auto inv_r12 = inv_r6 * inv_r6;
+                const auto w = c48 * inv_r12 - c24 * inv_r6;
+                potential_acc += inside ? inv_r12 - inv_r6 : zero;
+                virial_acc += inside ? w : zero;
+                store(factors + k, v_type(inside ? w * inv_r2 : zero));
+            }
+            field potential_sum{0};
+            for (size_t lane = 0; lane < width; lane++) {
+                potential_sum += potential_acc[lane];
+                virial += virial_acc[lane];
+            }
+            potential += field(4) * potential_sum;
+            lj_batch_scalar(dx + k, dy + k, dz + k, factors + k, n - k, box_edge, cutoff2,
+                            potential, virial);
+        }
+    }// namespace detail
+
+    /**
+     * Portable vector kernel, 16-byte wide (SSE2 / NEON).
+     */
+    template<typename field>
+    void lj_batch_generic(field *dx, field *dy, field *dz, field *factors, size_t n,
+                          field box_edge, field cutoff2, field &potential, field &virial) {
+        detail::lj_batch_vector<field, 16 / sizeof(field)>(dx, dy, dz, factors, n, box_edge,
+                                                            cutoff2, potential, virial);
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    /**
+     * AVX2 kernel: 4 doubles or 8 floats at once.
+     */
+    template<typename field>
+    __attribute__((target("avx2,fma"))) void
+    lj_batch_avx2(field *dx, field *dy, field *dz, field *factors, size_t n, field box_edge,
+                  field cutoff2, field &potential, field &virial) {
+        detail::lj_batch_vector<field, 32 / sizeof(field)>(dx, dy, dz, factors, n, box_edge,
+                                                            cutoff2, potential, virial);
+    }
+
+    /**
+     * AVX-512 kernel: 8 doubles or 16 floats at once.
+     */
+    template<typename field>
+    __attribute__((target("avx512f"))) void
+    lj_batch_avx512(field *dx, field *dy, field *dz, field *factors, size_t n, field box_edge,
+                    field cutoff2, field &potential, field &virial) {
+        detail::lj_batch_vector<field, 64 / sizeof(field)>(dx, dy, dz, factors, n, box_edge,
+                                                            cutoff2, potential, virial);
+    }
+#endif
+
+    /**
+     * Name of the instruction set the dispatched kernel uses on this CPU.
+     */
+    inline std::string lj_batch_isa() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) return "avx512";
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return "avx2";
+#endif
+        return "generic";
+    }
+
+    /**
+     * Picks the widest kernel supported by the running CPU.
+     */
+    template<typename field>
+    lj_batch_fn<field> lj_batch_dispatch() {
+#if defined(__x86_64__) || defined(__i386__)
+        const auto isa = lj_batch_isa();
+        if (isa == "avx512") return lj_batch_avx512<field>;
+        if (isa == "avx2") return lj_batch_avx2<field>;
+#endif
+        return lj_batch_generic<field>;
+    }
+
+    /**
+     * Runs the widest kernel supported by the running CPU, chosen once per field.
+     */
+    template<typename field>
+    inline void lj_batch(field *dx, field *dy, field *dz, field *factors, size_t n,
+                         field box_edge, field cutoff2, field &potential, field &virial) {
+        static const lj_batch_fn<field> kernel = lj_batch_dispatch<field>();
+        kernel(dx, dy, dz, factors, n, box_edge, cutoff2, potential, virial);
+    }
+}// namespace molecular_systems::kernels
+
+#endif//ESERCIZI_LSN_MS_KERNELS_HPP
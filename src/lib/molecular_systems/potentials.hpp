@@ -0,0 +1,437 @@
+#ifndef ESERCIZI_LSN_MS_POTENTIALS_HPP
+#define ESERCIZI_LSN_MS_POTENTIALS_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#include "data_types/settings.hpp"
+#include "kernels.hpp"
+
+namespace fs = std::filesystem;
+
+/**
+ * Pair potentials, in reduced units, to be used as compile-time policies of LJMono and of the
+ * single-particle energy functions. Every policy exposes:
+ * - cutoff2: the squared range of the interaction;
+ * - energy(r2), force_over_r(r2), virial(r2): the pair energy u(r), the force magnitude over the
+ *   distance -u'(r)/r and the virial -u'(r)*r, given the squared distance r2 < cutoff2;
+ * - evaluate(r2, energy, force_over_r): both at once;
+ * - tail_energy(density), tail_virial(density, n_particles): tail corrections (zero when not
+ *   defined).
+ * Policies are plain classes with inline members, so that pair loops are fully inlined.
+ */
+namespace molecular_systems::potentials {
+    /**
+     * Truncated Lennard-Jones potential 4 (r^-12 - r^-6). Pair batches use the vectorized kernel.
+     */
+    template<typename field>
+    struct LennardJones {
+        explicit LennardJones(field cutoff) : cutoff2(cutoff * cutoff), m_cutoff(cutoff) {}
+
+        [[nodiscard]] inline field energy(field r2) const noexcept {
+            const auto inv_r6 = field(1) / (r2 * r2 * r2);
+            return field(4) * inv_r6 * (inv_r6 - field(1));
+        }
+
+        [[nodiscard]] inline field force_over_r(field r2) const noexcept {
+            const auto inv_r2 = field(1) / r2;
+            const auto inv_r6 = inv_r2 * inv_r2 * inv_r2;
+            return field(24) * inv_r6 * (field(2) * inv_r6 - field(1)) * inv_r2;
+        }
+
+        [[nodiscard]] inline field virial(field r2) const noexcept {
+            return force_over_r(r2) * r2;
+        }
+
+        inline void evaluate(field r2, field &u, field &f_r) const noexcept {
+            const auto inv_r2 = field(1) / r2;
+            const auto inv_r6 = inv_r2 * inv_r2 * inv_r2;
+            u = field(4) * inv_r6 * (inv_r6 - field(1));
+            f_r = field(24) * inv_r6 * (field(2) * inv_r6 - field(1)) * inv_r2;
+        }
+
+        template<typename out = field>
+        [[nodiscard]] out tail_energy(out density) const {
+            return lj_u_tail_correction(density, out(m_cutoff));
+        }
+
+        template<typename out = field>
+        [[nodiscard]] out tail_virial(out density, size_t n_particles) const {
+            return lj_W_tail_correction(density, n_particles, out(m_cutoff));
+        }
+
+        field cutoff2;
+
+    private:
+        field m_cutoff;
+    };
+
+    /**
+     * Shifted-force Lennard-Jones potential: both the energy and the force vanish at the cutoff,
+     * u_sf(r) = u(r) - u(r_c) - (r - r_c) u'(r_c).
+     */
+    template<typename field>
+    struct ShiftedForceLJ {
+        explicit ShiftedForceLJ(field cutoff)
+            : cutoff2(cutoff * cutoff), m_cutoff(cutoff), m_lj(cutoff),
+              m_energy_shift(m_lj.energy(cutoff2)),
+              m_force_shift(m_lj.force_over_r(cutoff2) * cutoff) {}
+
+        [[nodiscard]] inline field energy(field r2) const noexcept {
+            return m_lj.energy(r2) - m_energy_shift + (std::sqrt(r2) - m_cutoff) * m_force_shift;
+        }
+
+        [[nodiscard]] inline field force_over_r(field r2) const noexcept {
+            return m_lj.force_over_r(r2) - m_force_shift / std::sqrt(r2);
+        }
+
+        [[nodiscard]] inline field virial(field r2) const noexcept {
+            return force_over_r(r2) * r2;
+        }
+
+        inline void evaluate(field r2, field &u, field &f_r) const noexcept {
+            const auto r = std::sqrt(r2);
+            m_lj.evaluate(r2, u, f_r);
+            u += (r - m_cutoff) * m_force_shift - m_energy_shift;
+            f_r -= m_force_shift / r;
+        }
+
+        template<typename out = field>
+        [[nodiscard]] out tail_energy(out) const {
+            return out(0);
+        }
+
+        template<typename out = field>
+        [[nodiscard]] out tail_virial(out, size_t) const {
+            return out(0);
+        }
+
+        field cutoff2;
+
+    private:
+        field m_cutoff;
+        LennardJones<field> m_lj;
+        // u(r_c) and -u'(r_c)
+        field m_energy_shift, m_force_shift;
+    };
+
+    /**
+     * Weeks-Chandler-Andersen potential: the repulsive part of Lennard-Jones, truncated at its
+     * minimum 2^(1/6) and shifted up by 1.
+     */
+    template<typename field>
+    struct WCA {
+        WCA() : cutoff2(std::cbrt(field(2))), m_lj(std::sqrt(cutoff2)) {}
+
+        [[nodiscard]] inline field energy(field r2) const noexcept {
+            return m_lj.energy(r2) + field(1);
+        }
+
+        [[nodiscard]] inline field force_over_r(field r2) const noexcept {
+            return m_lj.force_over_r(r2);
+        }
+
+        [[nodiscard]] inline field virial(field r2) const noexcept {
+            return force_over_r(r2) * r2;
+        }
+
+        inline void evaluate(field r2, field &u, field &f_r) const noexcept {
+            m_lj.evaluate(r2, u, f_r);
+            u += field(1);
+        }
+
+        template<typename out = field>
+        [[nodiscard]] out tail_energy(out) const {
+            return out(0);
+        }
+
+        template<typename out = field>
+        [[nodiscard]] out tail_virial(out, size_t) const {
+            return out(0);
+        }
+
+        field cutoff2;
+
+    private:
+        LennardJones<field> m_lj;
+    };
+
+    /**
+     * Truncated Morse potential D (e^(-2a(r - r0)) - 2 e^(-a(r - r0))).
+     */
+    template<typename field>
+    struct Morse {
+        /**
+         * Initializer.
+         * @param cutoff Interaction cutoff.
+         * @param depth Well depth D.
+         * @param stiffness Inverse width a of the well.
+         * @param r_min Position r0 of the minimum.
+         */
+        explicit Morse(field cutoff, field depth = 1, field stiffness = 1, field r_min = 1)
+            : cutoff2(cutoff * cutoff), m_depth(depth), m_stiffness(stiffness), m_r_min(r_min) {}
+
+        [[nodiscard]] inline field energy(field r2) const noexcept {
+            const auto e = std::exp(-m_stiffness * (std::sqrt(r2) - m_r_min));
+            return m_depth * e * (e - field(2));
+        }
+
+        [[nodiscard]] inline field force_over_r(field r2) const noexcept {
+            const auto r = std::sqrt(r2);
+            const auto e = std::exp(-m_stiffness * (r - m_r_min));
+            return field(2) * m_stiffness * m_depth * e * (e - field(1)) / r;
+        }
+
+        [[nodiscard]] inline field virial(field r2) const noexcept {
+            return force_over_r(r2) * r2;
+        }
+
+        inline void evaluate(field r2, field &u, field &f_r) const noexcept {
+            const auto r = std::sqrt(r2);
+            const auto e = std::exp(-m_stiffness * (r - m_r_min));
+            u = m_depth * e * (e - field(2));
+            f_r = field(2) * m_stiffness * m_depth * e * (e - field(1)) / r;
+        }
+
+        template<typename out = field>
+        [[nodiscard]] out tail_energy(out) const {
+            return out(0);
+        }
+
+        template<typename out = field>
+        [[nodiscard]] out tail_virial(out, size_t) const {
+            return out(0);
+        }
+
+        field cutoff2;
+
+    private:
+        field m_depth, m_stiffness, m_r_min;
+    };
+
+    /**
+     * Tabulated potential. The table, a file with two columns (r, u(r)) sorted by r, is
+     * interpolated by a natural cubic spline, which is resampled on a uniform grid in r^2: pair
+     * evaluations only need an index computation and two cubic polynomials, with no square root,
+     * power or transcendental function. The force is the exact derivative of the interpolated
+     * energy. The range of the potential is the last r of the table.
+     */
+    template<typename field>
+    struct Tabulated {
+        // An empty table: no interactions at all
+        Tabulated() : cutoff2(0), m_s_min(0), m_ds(1), m_inv_ds(1), m_coeffs(1) {}
+
+        /**
+         * Reads and interpolates the table.
+         * @param table_path Path to the table.
+         * @param n_intervals Number of intervals of the grid in r^2.
+         */
+        explicit Tabulated(const fs::path &table_path, size_t n_intervals = 4096) {
+            std::ifstream table(table_path);
+            if (!table.is_open())
+                throw std::runtime_error("Could not open " + table_path.string());
+            std::vector<double> rs, us;
+            double r, u;
+            while (table >> r >> u) {
+                rs.push_back(r);
+                us.push_back(u);
+            }
+            table.close();
+            if (rs.size() < 3)
+                throw std::runtime_error(table_path.string() + " must hold at least three points");
+            if (!std::is_sorted(rs.cbegin(), rs.cend()) || rs.front() <= 0)
+                throw std::runtime_error(table_path.string() + " must hold increasing positive r");
+            init(rs, us, n_intervals);
+        }
+
+        [[nodiscard]] inline field energy(field r2) const noexcept {
+            field u, f_r;
+            evaluate(r2, u, f_r);
+            return u;
+        }
+
+        [[nodiscard]] inline field force_over_r(field r2) const noexcept {
+            field u, f_r;
+            evaluate(r2, u, f_r);
+            return f_r;
+        }
+
+        [[nodiscard]] inline field virial(field r2) const noexcept {
+            return force_over_r(r2) * r2;
+        }
+
+        inline void evaluate(field r2, field &u, field &f_r) const noexcept {
+            // Distances below the table are extrapolated from the first interval
+            const auto x = std::max((r2 - m_s_min) * m_inv_ds, field(0));
+            const auto k = std::min(static_cast<size_t>(x), m_coeffs.size() - 1);
+            const auto t = r2 - (m_s_min + field(k) * m_ds);
+            const auto &c = m_coeffs[k];
+            u = ((c[3] * t + c[2]) * t + c[1]) * t + c[0];
+            // -u'(r)/r = -2 du/d(r^2)
+            f_r = field(-2) * ((field(3) * c[3] * t + field(2) * c[2]) * t + c[1]);
+        }
+
+        template<typename out = field>
+        [[nodiscard]] out tail_energy(out) const {
+            return out(0);
+        }
+
+        template<typename out = field>
+        [[nodiscard]] out tail_virial(out, size_t) const {
+            return out(0);
+        }
+
+        field cutoff2;
+
+    private:
+        // Grid in r^2: origin, step and its inverse
+        field m_s_min, m_ds, m_inv_ds;
+        // Coefficients of the cubic in (r^2 - s_k) on each interval, lowest order first
+        std::vector<std::array<field, 4>> m_coeffs;
+
+        /**
+         * Natural cubic spline through the table, evaluated with its derivative at r.
+         */
+        struct Spline {
+            std::vector<double> r, u, u2;
+
+            void operator()(double x, double &value, double &derivative) const {
+                const auto hi = static_cast<size_t>(std::clamp<long>(
+                        std::upper_bound(r.cbegin(), r.cend(), x) - r.cbegin(), 1,
+                        static_cast<long>(r.size()) - 1));
+                const auto lo = hi - 1;
+                const auto h = r[hi] - r[lo];
+                const auto a = (r[hi] - x) / h, b = (x - r[lo]) / h;
+                value = a * u[lo] + b * u[hi] +
+                        ((a * a * a - a) * u2[lo] + (b * b * b - b) * u2[hi]) * h * h / 6;
+                derivative = (u[hi] - u[lo]) / h -
+                             (3 * a * a - 1) * h * u2[lo] / 6 + (3 * b * b - 1) * h * u2[hi] / 6;
+            }
+        };
+
+        void init(const std::vector<double> &rs, const std::vector<double> &us,
+                  size_t n_intervals) {
+            const auto n = rs.size();
+            // Second derivatives of the natural spline (tridiagonal system, Thomas algorithm)
+            Spline spline{rs, us, std::vector<double>(n, 0.0)};
+            std::vector<double> c(n, 0.0), d(n, 0.0);
+            for (size_t i = 1; i + 1 < n; i++) {
+                const auto h0 = rs[i] - rs[i - 1], h1 = rs[i + 1] - rs[i];
+                const auto diag = 2 * (h0 + h1) - h0 * c[i - 1];
+                const auto rhs = 6 * ((us[i + 1] - us[i]) / h1 - (us[i] - us[i - 1]) / h0);
+                c[i] = h1 / diag;
+                d[i] = (rhs - h0 * d[i - 1]) / diag;
+            }
+            for (size_t i = n - 2; i > 0; i--) spline.u2[i] = d[i] - c[i] * spline.u2[i + 1];
+
+            // Cubic Hermite interpolation in s = r^2 of the spline values and derivatives
+            const auto s_min = rs.front() * rs.front(), s_max = rs.back() * rs.back();
+            const auto ds = (s_max - s_min) / double(n_intervals);
+            const auto sample = [&](double s, double &value, double &derivative) {
+                const auto r = std::sqrt(s);
+                spline(r, value, derivative);
+                // du/ds = u'(r) / (2 r)
+                derivative /= 2 * r;
+            };
+            m_coeffs.resize(n_intervals);
+            double y0, d0, y1, d1;
+            sample(s_min, y0, d0);
+            for (size_t k = 0; k < n_intervals; k++) {
+                sample(s_min + double(k + 1) * ds, y1, d1);
+                const auto slope = (y1 - y0) / ds;
+                m_coeffs[k] = {field(y0), field(d0), field((3 * slope - 2 * d0 - d1) / ds),
+                               field((d0 + d1 - 2 * slope) / (ds * ds))};
+                y0 = y1;
+                d0 = d1;
+            }
+            cutoff2 = field(s_max);
+            m_s_min = field(s_min);
+            m_ds = field(ds);
+            m_inv_ds = field(1 / ds);
+        }
+    };
+
+    /**
+     * Interactions of a batch of pairs through a generic policy: same contract as the kernels in
+     * kernels.hpp.
+     */
+    template<class Potential, typename field>
+    inline void pair_batch(const Potential &potential, field *dx, field *dy, field *dz,
+                           field *factors, size_t n, field box_edge, field &energy,
+                           field &virial) {
+        for (size_t k = 0; k < n; k++) {
+            dx[k] -= box_edge * std::rint(dx[k] / box_edge);
+            dy[k] -= box_edge * std::rint(dy[k] / box_edge);
+            dz[k] -= box_edge * std::rint(dz[k] / box_edge);
+            const auto r2 = dx[k] * dx[k] + dy[k] * dy[k] + dz[k] * dz[k];
+            factors[k] = field(0);
+            if (r2 < potential.cutoff2) {
+                field u, f_r;
+                potential.evaluate(r2, u, f_r);
+                energy += u;
+                virial += f_r * r2;
+                factors[k] = f_r;
+            }
+        }
+    }
+
+    /**
+     * Lennard-Jones batches go through the vectorized kernel.
+     */
+    template<typename field>
+    inline void pair_batch(const LennardJones<field> &potential, field *dx, field *dy, field *dz,
+                           field *factors, size_t n, field box_edge, field &energy,
+                           field &virial) {
+        kernels::lj_batch(dx, dy, dz, factors, n, box_edge, potential.cutoff2, energy, virial);
+    }
+
+    /**
+     * Fixed-size scratch space used to feed pairs to the kernels, so that callers iterating pair by
+     * pair need no allocations.
+     */
+    template<typename field, size_t size = 64>
+    struct PairBatch {
+        static constexpr size_t capacity = size;
+        size_t n{0};
+        std::array<size_t, size> first, second;
+        std::array<field, size> dx, dy, dz, factors;
+
+        [[nodiscard]] bool full() const noexcept { return n == capacity; }
+        void clear() noexcept { n = 0; }
+
+        inline void push(size_t i, size_t j, field x, field y, field z) noexcept {
+            first[n] = i;
+            second[n] = j;
+            dx[n] = x;
+            dy[n] = y;
+            dz[n] = z;
+            n++;
+        }
+
+        /**
+         * Computes the interactions of the stored pairs. The sums of the batch are computed in
+         * field and then added to the (possibly wider) accumulators.
+         * @param potential Pair potential policy.
+         * @param box_edge Periodic box edge.
+         * @param energy Potential energy sum, incremented.
+         * @param virial Virial sum, incremented.
+         */
+        template<class Potential, typename accumulator>
+        inline void compute(const Potential &potential, field box_edge, accumulator &energy,
+                            accumulator &virial) {
+            field batch_energy{0}, batch_virial{0};
+            pair_batch(potential, dx.data(), dy.data(), dz.data(), factors.data(), n, box_edge,
+                       batch_energy, batch_virial);
+            energy += accumulator(batch_energy);
+            virial += accumulator(batch_virial);
+        }
+    };
+}// namespace molecular_systems::potentials
+
+#endif//ESERCIZI_LSN_MS_POTENTIALS_HPP
@@ -0,0 +1,229 @@
+#ifndef ESERCIZI_LSN_MS_STEPPER_CHECKERBOARD_MC_HPP
+#define ESERCIZI_LSN_MS_STEPPER_CHECKERBOARD_MC_HPP
+
+#include <array>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "../algos.hpp"
+#include "../data_types/cells.hpp"
+#include "distributions/uniform_int.hpp"
+#include "molecular_systems/system.hpp"
+#include "utils.hpp"
+
+namespace molecular_systems::steppers {
+    /**
+     * Explores an LJMono system's states using the Metropolis-Hastings algorithm on several threads.
+     * The box is split in an even number of cells per side, of edge at least the cutoff, colored as
+     * an 8-color checkerboard: cells of the same color do not interact, so their particles are
+     * displaced concurrently. Colors are swept in random order, and the grid is randomly shifted at
+     * each sweep; a trial move taking a particle out of its cell is rejected, so that the cells of
+     * the other threads are never touched. Each thread draws from its own random number generator,
+     * and cells are assigned to threads statically: a run only depends on the generators' streams.
+     * @tparam field System's numeric field.
+     * @tparam tail_corrections Whether tail corrections to the thermodynamic variables are used.
+     * @tparam URBG Random number generator.
+     * @tparam accumulator Numeric field of the measured variables.
+     * @tparam Potential Pair potential policy.
+     */
+    template<typename field, bool tail_corrections, class URBG, typename accumulator = field,
+             class Potential = potentials::LennardJones<field>>
+    class CheckerboardMC {
+    public:
+        typedef LJMono<field, tail_corrections, Ensamble::NVT, accumulator, Potential> System;
+        typedef accumulator Field;
+        CheckerboardMC(CheckerboardMC &) = delete;
+        CheckerboardMC(const CheckerboardMC &) = delete;
+        CheckerboardMC(CheckerboardMC &&) noexcept = default;
+
+        /**
+         * Constructor
+         * @param simulation Simulation settings of the system.
+         * @param displacement_diameter Diameter in which a tentative particle will be sampled.
+         * @param rngs One random number generator per thread, with independent streams.
+         */
+        CheckerboardMC(const SimulationSettings<field> &simulation, field displacement_diameter,
+                       std::vector<URBG> rngs)
+            : m_cells(checkerboard(simulation)),
+              m_displacement(-displacement_diameter / 2, displacement_diameter / 2),
+              m_rngs(std::move(rngs)), m_threads(m_rngs.size()) {
+            if (m_rngs.empty()) throw std::runtime_error("At least a random generator is needed");
+        }
+
+        /**
+         * Samples a new state for the system with a sweep over every color.
+         * @param system An LJMono system.
+         */
+        void step(System &system) {
+            auto &rng = m_rngs[0];
+            std::uniform_real_distribution<field> offset(0, m_cells.cell_edge());
+            const auto dx = offset(rng), dy = offset(rng), dz = offset(rng);
+            m_cells.shift({dx, dy, dz});
+            m_cells.build(system.m_positions);
+            // The running sums are rebuilt if the system was evolved by someone else
+            if (m_sums_time != system.time()) {
+                m_e_pot = accumulator(0);
+                m_virial = accumulator(0);
+                for (size_t particle = 0; particle < system.m_simulation.n_particles; particle++) {
+                    field energy, virial;
+                    particle_sums(particle, system.m_positions[particle], system.m_positions,
+                                  system.m_simulation, system.m_potential, m_cells, energy,
+                                  virial);
+                    m_e_pot += accumulator(energy) / 2;
+                    m_virial += accumulator(virial) / 2;
+                }
+            }
+            // Colors in random order
+            std::array<size_t, 8> colors{};
+            std::iota(colors.begin(), colors.end(), size_t(0));
+            for (size_t i = colors.size() - 1; i > 0; i--) {
+                distributions::uniform_int<size_t> other(0, i);
+                std::swap(colors[i], colors[other(rng)]);
+            }
+            for (const auto color: colors) {
+                utils::parallel_for(m_rngs.size(),
+                                    [&](size_t thread) { sweep_color(system, color, thread); });
+                // Reduction in a fixed order
+                for (auto &sums: m_threads) {
+                    m_e_pot += sums.e_pot;
+                    m_virial += sums.virial;
+                    sums.e_pot = accumulator(0);
+                    sums.virial = accumulator(0);
+                }
+            }
+            system.time_step();
+            system.cache_pair_sums(m_e_pot, m_virial);
+            m_sums_time = system.time();
+        }
+
+        // Acceptance rate since the beginning
+        [[nodiscard]] double acceptance_rate() const {
+            size_t accepted = 0, total = 0;
+            for (const auto &sums: m_threads) {
+                accepted += sums.accepted_steps;
+                total += sums.total_steps;
+            }
+            return double(accepted) / double(total);
+        }
+
+        [[nodiscard]] size_t n_threads() const noexcept { return m_rngs.size(); }
+        [[nodiscard]] size_t cells_per_side() const noexcept { return m_cells.cells_per_side(); }
+
+        // Random number generators of each thread, e.g. to save their seeds
+        [[nodiscard]] std::vector<URBG> &rngs() noexcept { return m_rngs; }
+
+        /**
+         * Stores or restores the generators of every thread, the displacement, the acceptance
+         * counters and the running sums (see CheckpointArchive). The number of threads must not
+         * change across a restart, as the streams are tied to them.
+         * @param archive A checkpoint writer or reader.
+         */
+        template<class Archive>
+        void checkpoint(Archive &archive) {
+            archive.section("CheckerboardMC");
+            archive.expect(m_rngs.size(), "number of threads");
+            for (auto &rng: m_rngs) archive.rng(rng);
+            auto a = m_displacement.a(), b = m_displacement.b();
+            archive(a, b);
+            if constexpr (Archive::loading)
+                m_displacement = std::uniform_real_distribution<field>(a, b);
+            for (auto &sums: m_threads) archive(sums.accepted_steps, sums.total_steps);
+            archive(m_e_pot, m_virial, m_sums_time);
+        }
+
+        static constexpr bool tails = tail_corrections;
+        static constexpr bool compute_forces = false;
+
+    private:
+        // Per-thread scratch space and counters
+        struct ThreadSums {
+            std::vector<size_t> members{};
+            accumulator e_pot{0}, virial{0};
+            size_t accepted_steps{0}, total_steps{0};
+        };
+
+        /**
+         * Cells of edge at least the cutoff, in an even number per side, so that the checkerboard
+         * wraps around the periodic box.
+         */
+        static CellList<field> checkerboard(const SimulationSettings<field> &simulation) {
+            auto n = static_cast<size_t>(std::floor(simulation.box_edge / simulation.cutoff));
+            n -= n % 2;
+            if (n < 4)
+                throw std::runtime_error("The box is too small for a checkerboard of cells: at "
+                                         "least 4 cells per side are needed");
+            return CellList<field>(simulation.box_edge,
+                                   simulation.box_edge / (field(n) + field(0.5)));
+        }
+
+        /**
+         * Sweeps the cells of a color assigned to a thread.
+         */
+        void sweep_color(System &system, size_t color, size_t thread) {
+            const auto n = m_cells.cells_per_side();
+            const auto n_threads = m_rngs.size();
+            size_t k = 0;
+            for (size_t cx = (color >> 2) & 1; cx < n; cx += 2)
+                for (size_t cy = (color >> 1) & 1; cy < n; cy += 2)
+                    for (size_t cz = color & 1; cz < n; cz += 2)
+                        if (k++ % n_threads == thread)
+                            sweep_cell(system, m_cells.cell(cx, cy, cz), thread);
+        }
+
+        /**
+         * Attempts as many moves as the particles in a cell.
+         */
+        void sweep_cell(System &system, size_t cell, size_t thread) {
+            auto &rng = m_rngs[thread];
+            auto &sums = m_threads[thread];
+            auto &members = sums.members;
+            members.clear();
+            m_cells.for_each_in_cell(cell, [&](size_t i) { members.push_back(i); });
+            if (members.empty()) return;
+            distributions::uniform_int<size_t> pick(0, members.size() - 1);
+            std::uniform_real_distribution<field> displacement(m_displacement.param());
+            std::uniform_real_distribution<field> unit(0, 1);
+            for (size_t trial = 0; trial < members.size(); trial++) {
+                // Sampling a particle to displace
+                const size_t particle = members[pick(rng)];
+                const auto old_position = system.m_positions[particle];
+                // Sampling a new position
+                const std::array<field, 3> new_position{
+                        system.pbc(old_position[0] + displacement(rng)),
+                        system.pbc(old_position[1] + displacement(rng)),
+                        system.pbc(old_position[2] + displacement(rng))};
+                sums.total_steps++;
+                if (m_cells.cell_at(new_position) != cell) continue;
+                field e_old, w_old, e_new, w_new;
+                particle_sums(particle, old_position, system.m_positions, system.m_simulation,
+                              system.m_potential, m_cells, e_old, w_old);
+                particle_sums(particle, new_position, system.m_positions, system.m_simulation,
+                              system.m_potential, m_cells, e_new, w_new);
+                // Metropolis' threshold
+                const auto p = std::exp(accumulator(e_old - e_new) / system.m_thermo.temperature);
+                if (accumulator(unit(rng)) <= p) {
+                    system.m_positions.e_i[particle] = new_position[0];
+                    system.m_positions.e_j[particle] = new_position[1];
+                    system.m_positions.e_k[particle] = new_position[2];
+                    sums.e_pot += accumulator(e_new) - accumulator(e_old);
+                    sums.virial += accumulator(w_new) - accumulator(w_old);
+                    sums.accepted_steps++;
+                }
+            }
+        }
+
+        CellList<field> m_cells;
+        std::uniform_real_distribution<field> m_displacement;
+        std::vector<URBG> m_rngs;
+        std::vector<ThreadSums> m_threads;
+        // Running sums of the pair potentials and virials, and the time step they refer to
+        accumulator m_e_pot{0}, m_virial{0};
+        size_t m_sums_time{static_cast<size_t>(-1)};
+    };
+}// namespace molecular_systems::steppers
+
+#endif//ESERCIZI_LSN_MS_STEPPER_CHECKERBOARD_MC_HPP
@@ -8,10 +8,13 @@
 #include <array>
 #include <filesystem>
 #include <memory>
-#include <optional>
 #include <tuple>
+#include <type_traits>
 #include <utility>
 
+#include "../data_types/checkpoint.hpp"
+#include "../data_types/measures.hpp"
+#include "../data_types/trajectory.hpp"
 #include "../system.hpp"
 
 namespace fs = std::filesystem;
@@ -28,58 +31,45 @@ namespace molecular_systems::steppers {
 
 
         /**
-        * Computes mean and variance block estimates for each thermodynamical variable and checkpoints molecular positions in xyz format
+        * Computes mean and variance block estimates for each thermodynamical variable and checkpoints molecular positions in a trajectory
         * @param save_every_n_frames Checkpoint interval
-        * @param dir Directory where frames will be saved
+        * @param trajectory Trajectory where frames will be appended (a TrajectoryWriter or an AsyncWriter)
         */
-        auto block_estimates(size_t save_every, const std::optional<fs::path> &dir) {
-            assert(save_every == 0 || dir.has_value());
-            std::array<std::vector<field>, System::N_VARS()> block_data;
-            for (auto &vec: block_data) { vec.resize(m_system->m_simulation.block_size); }
-            auto stepper = static_cast<Impl &>(*this);
+        template<class Trajectory = TrajectoryWriter>
+        auto block_estimates(size_t save_every, Trajectory *trajectory) {
+            assert(save_every == 0 || trajectory != nullptr);
+            // Only the block averages are needed: measures are accumulated as they come
+            std::array<estimators::Welford<field>, System::N_VARS()> block_data;
+            std::array<field, System::N_VARS()> step_data;
+            auto &stepper = static_cast<Impl &>(*this);
             for (size_t i = 0UL; i < m_system->m_simulation.block_size; i++) {
-                m_system->measures(block_data[0][i], block_data[1][i], block_data[2][i],
-                                   block_data[3][i], block_data[4][i]);
+                m_system->measures(step_data[0], step_data[1], step_data[2], step_data[3],
+                                   step_data[4]);
+                for (size_t var = 0UL; var < System::N_VARS(); var++)
+                    block_data[var].push(step_data[var]);
                 stepper.step();
                 if ((save_every > 0) && ((m_frame_counter % save_every) == 0)) {
-                    m_system->save_xyz_positions(dir.value(), m_frame_counter);
+                    trajectory->write(m_system->m_positions, m_system->m_simulation.box_edge,
+                                      m_frame_counter);
                 }
                 m_frame_counter++;
             }
             std::array<std::tuple<field, field, field>, System::N_VARS()> results;
             for (size_t var = 0UL; var < System::N_VARS(); var++) {
-                results[var] = m_estimators[var](block_data[var].cbegin(), block_data[var].cend());
+                results[var] = m_estimators[var].push_block(block_data[var].mean());
             }
             return results;
         }
 
 
         /**
-        * Computes mean and variance block estimates for each thermodynamical variable and checkpoints molecular positions in xyz format
+        * Computes mean and variance block estimates for each thermodynamical variable and checkpoints molecular positions in a trajectory
         * @param save_every_n_frames Checkpoint interval
-        * @param dir Directory where frames will be saved
+        * @param trajectory Trajectory where frames will be appended (a TrajectoryWriter or an AsyncWriter)
         */
-        template<Variable... vars>
-        auto block_estimates2(size_t save_every, const std::optional<fs::path> &dir) {
-            assert(save_every == 0 || dir.has_value());
-            MeasureOutputs<field, vars...> outputs(m_system->m_simulation.block_size);
-            std::array<std::vector<field>, System::N_VARS()> block_data;
-            for (auto &vec: block_data) { vec.resize(m_system->m_simulation.block_size); }
-            auto stepper = static_cast<Impl &>(*this);
-            for (size_t i = 0UL; i < m_system->m_simulation.block_size; i++) {
-                m_system->measures(block_data[0][i], block_data[1][i], block_data[2][i],
-                                   block_data[3][i], block_data[4][i]);
-                stepper.step();
-                if ((save_every > 0) && ((m_frame_counter % save_every) == 0)) {
-                    m_system->save_xyz_positions(dir.value(), m_frame_counter);
-                }
-                m_frame_counter++;
-            }
-            std::array<std::tuple<field, field, field>, System::N_VARS()> results;
-            for (size_t var = 0UL; var < System::N_VARS(); var++) {
-                results[var] = m_estimators[var](block_data[var].cbegin(), block_data[var].cend());
-            }
-            return results;
+        template<Variable... vars, class Trajectory = TrajectoryWriter>
+        auto block_estimates2(size_t save_every, Trajectory *trajectory) {
+            return block_estimates(save_every, trajectory);
         }
 
 
@@ -128,22 +118,48 @@ namespace molecular_systems::steppers {
         template<template<class...> class Extractor, class TupleLike>
         using extract_t = typename extract<Extractor, TupleLike>::type;
 
+        // Whether an estimator can be fed with block averages of type T (see ProgAvg::push_block)
+        template<class Estimator, class T, class = void>
+        struct takes_block_averages : std::false_type {};
+
+        template<class Estimator, class T>
+        struct takes_block_averages<
+                Estimator, T,
+                std::void_t<decltype(std::declval<Estimator &>().push_block(std::declval<T>()))>>
+            : std::true_type {};
 
     }// namespace detail
 
 
+    /**
+     * Block statistics of the thermodynamical variables. When every estimator can be fed with
+     * block averages (as ProgAvg and SampleProgAvg), measures are accumulated online and the
+     * memory does not depend on the block size; otherwise the whole block is stored and passed to
+     * the estimators.
+     */
     template<class Stepper, class Estimators, Variable... vars>
     class BlockStats {
         using System = typename Stepper::System;
         using field = typename Stepper::Field;
-        using Outs = MeasureOutputs<field, vars...>;
         using EstimatorsOuts = detail::extract_t<detail::output_t, Estimators>;
         static_assert(std::tuple_size<Estimators>() == sizeof...(vars));
 
+    public:
+        static constexpr bool online =
+                (detail::takes_block_averages<
+                         std::tuple_element_t<indexer_v<vars, varlist<vars...>>, Estimators>,
+                         var_out_t<field, vars>>::value &&
+                 ...);
+
+    private:
+        using Outs = std::conditional_t<online, OnlineMeasures<field, vars...>,
+                                        MeasureOutputs<field, vars...>>;
+
     public:
         BlockStats(Stepper &&stepper, Estimators &&estimators, size_t block_size)
             : m_stepper(std::forward<Stepper>(stepper)),
-              m_estimators(std::forward<Estimators>(estimators)), m_measures(block_size) {}
+              m_estimators(std::forward<Estimators>(estimators)),
+              m_measures(make_outs(block_size)) {}
 
         auto statistics(System &system) {
             for (size_t i = 0UL; i < system.m_simulation.block_size; i++) {
@@ -151,16 +167,55 @@ namespace molecular_systems::steppers {
                 m_stepper.step(system);
             }
             EstimatorsOuts results;
-            utils::tuple_transform(
-                    [](const auto &var_measures, auto &var_estimator) {
-                        return var_estimator(var_measures.cbegin(), var_measures.cend());
-                    },
-                    /*outs=*/results, /*ins=*/m_measures.all_measures(), m_estimators);
+            if constexpr (online) {
+                utils::tuple_transform(
+                        [](const auto &var_accumulator, auto &var_estimator) {
+                            return var_estimator.push_block(var_accumulator.mean());
+                        },
+                        /*outs=*/results, /*ins=*/m_measures.all_accumulators(), m_estimators);
+            } else {
+                utils::tuple_transform(
+                        [](const auto &var_measures, auto &var_estimator) {
+                            return var_estimator(var_measures.cbegin(), var_measures.cend());
+                        },
+                        /*outs=*/results, /*ins=*/m_measures.all_measures(), m_estimators);
+            }
             m_measures.clear();
             return results;
         }
 
+        /**
+         * Attaches a blocking analysis to a scalar variable: from now on it receives every measure
+         * of the variable, so that its error and autocorrelation time can be checked between
+         * blocks, and the run stopped as soon as the target precision is reached.
+         * @param blocking The analysis, which must outlive the statistics.
+         */
+        template<Variable var>
+        void attach(estimators::Blocking<field> &blocking) {
+            m_measures.template observe<var>(&blocking);
+        }
+
+        /**
+         * Stores or restores the estimators and the stepper's state (see CheckpointArchive).
+         * Meant to be called between blocks.
+         * @param archive A checkpoint writer or reader.
+         */
+        template<class Archive>
+        void checkpoint(Archive &archive) {
+            archive.section("BlockStats");
+            static_assert(::detail::has_checkpoint<Stepper, Archive>::value,
+                          "The stepper must implement checkpoint, even if it has no state");
+            archive(m_stepper);
+            archive(m_estimators);
+        }
+
     private:
+        static Outs make_outs(size_t block_size) {
+            if constexpr (online) return Outs();
+            else
+                return Outs(block_size);
+        }
+
         Stepper m_stepper;
         Estimators m_estimators;
         Outs m_measures;
@@ -184,6 +239,23 @@ namespace molecular_systems::steppers {
             return measures;
         }
 
+        /**
+         * As sample, also appending the positions to a trajectory every save_every steps.
+         * @param trajectory A TrajectoryWriter or an AsyncWriter.
+         */
+        template<class Trajectory>
+        auto sample(System &system, size_t n_steps, size_t save_every, Trajectory &trajectory) {
+            Outs measures(n_steps);
+            for (size_t i = 0UL; i < n_steps; i++) {
+                system.template measures<Stepper::compute_forces>(measures);
+                m_stepper.step(system);
+                if (save_every > 0 && system.time() % save_every == 0)
+                    trajectory.write(system.m_positions, system.m_simulation.box_edge,
+                                     system.time());
+            }
+            return measures;
+        }
+
         Stepper m_stepper;
     };
 
@@ -0,0 +1,420 @@
+#ifndef ESERCIZI_LSN_MS_STEPPER_DOMAIN_MD_HPP
+#define ESERCIZI_LSN_MS_STEPPER_DOMAIN_MD_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <mpi.h>
+
+#include "../algos.hpp"
+#include "../system.hpp"
+
+namespace molecular_systems::steppers {
+    namespace detail {
+        template<typename field>
+        MPI_Datatype mpi_type();
+
+        template<>
+        inline MPI_Datatype mpi_type<double>() {
+            return MPI_DOUBLE;
+        }
+
+        template<>
+        inline MPI_Datatype mpi_type<float>() {
+            return MPI_FLOAT;
+        }
+
+        // Whether MPI has been finalized: handles owned by objects outliving it can't be freed
+        inline bool finalized() {
+            int flag;
+            MPI_Finalized(&flag);
+            return flag != 0;
+        }
+
+        // Narrows a number of records to an MPI count
+        inline int mpi_count(size_t n) {
+            if (n > static_cast<size_t>(std::numeric_limits<int>::max()))
+                throw std::runtime_error("Too many records for a single MPI message: " +
+                                         std::to_string(n));
+            return static_cast<int>(n);
+        }
+
+        /**
+         * Committed MPI datatype spanning a Record, so that MPI counts are numbers of records.
+         * Records are sent as raw bytes: all the ranks are supposed to run on the same
+         * architecture.
+         */
+        template<class Record>
+        class RecordType {
+        public:
+            RecordType() {
+                MPI_Type_contiguous(static_cast<int>(sizeof(Record)), MPI_BYTE, &m_type);
+                MPI_Type_commit(&m_type);
+            }
+
+            RecordType(const RecordType &) = delete;
+            RecordType &operator=(const RecordType &) = delete;
+
+            ~RecordType() {
+                if (!finalized()) MPI_Type_free(&m_type);
+            }
+
+            [[nodiscard]] MPI_Datatype get() const noexcept { return m_type; }
+
+        private:
+            MPI_Datatype m_type{};
+        };
+
+        /**
+         * Sends "out" to rank "destination" and receives "in" from rank "source".
+         */
+        template<class Record>
+        void exchange(const std::vector<Record> &out, std::vector<Record> &in,
+                      const RecordType<Record> &type, int destination, int source,
+                      MPI_Comm comm) {
+            unsigned long n_out = out.size(), n_in = 0;
+            const auto count_out = mpi_count(n_out);
+            MPI_Sendrecv(&n_out, 1, MPI_UNSIGNED_LONG, destination, 0, &n_in, 1,
+                         MPI_UNSIGNED_LONG, source, 0, comm, MPI_STATUS_IGNORE);
+            in.resize(n_in);
+            MPI_Sendrecv(out.data(), count_out, type.get(), destination, 1, in.data(),
+                         mpi_count(n_in), type.get(), source, 1, comm, MPI_STATUS_IGNORE);
+        }
+    }// namespace detail
+
+    /**
+     * Verlet integrator (the same scheme as MD2) distributed with MPI by spatial domain
+     * decomposition. The ranks are arranged in a periodic 3D grid, each one owning the molecules
+     * lying in its sub-box. Every step the molecules leaving a sub-box migrate to the neighboring
+     * rank and each rank receives, one dimension at a time, a halo of ghost molecules lying within
+     * a cutoff from its boundaries (periodic images included). Forces on the owned molecules are
+     * then computed using linked cells over the sub-box and its halo. Pairs straddling two
+     * sub-boxes are evaluated on both ranks, so that no force has to be sent back.
+     * @tparam field Numeric field
+     * @tparam tail_corrections Whether to apply tail corrections to the measures
+     * @tparam Potential Pair potential policy
+     */
+    template<typename field, bool tail_corrections,
+             class Potential = potentials::LennardJones<field>>
+    class DomainMD {
+    public:
+        typedef LJMono<field, tail_corrections, Ensamble::NVE, field, Potential> System;
+        typedef field Field;
+
+        DomainMD(const DomainMD &) = delete;
+        DomainMD &operator=(const DomainMD &) = delete;
+
+        /**
+         * Splits the state of a system among the ranks of a communicator. Every rank must pass
+         * the same system, with velocities initialized.
+         * @param system A system.
+         * @param comm MPI communicator.
+         */
+        explicit DomainMD(const System &system, MPI_Comm comm = MPI_COMM_WORLD)
+            : m_n_particles(system.m_simulation.n_particles),
+              m_box_edge(system.m_simulation.box_edge), m_cutoff(system.m_simulation.cutoff),
+              m_delta2(system.m_simulation.delta2), m_dbldelta(system.m_simulation.dbldelta),
+              m_density(field(system.m_thermo.density)), m_potential(system.m_potential),
+              m_u_tail(m_potential.template tail_energy<field>(m_density)),
+              m_W_tail(m_potential.template tail_virial<field>(m_density, m_n_particles)) {
+            int n_ranks;
+            MPI_Comm_size(comm, &n_ranks);
+            MPI_Dims_create(n_ranks, 3, m_dims.data());
+            const std::array<int, 3> periods{1, 1, 1};
+            MPI_Cart_create(comm, 3, m_dims.data(), periods.data(), 0, &m_comm);
+            MPI_Comm_rank(m_comm, &m_rank);
+            MPI_Cart_coords(m_comm, m_rank, 3, m_coords.data());
+            for (size_t d = 0; d < 3; d++) {
+                MPI_Cart_shift(m_comm, static_cast<int>(d), 1, &m_lower[d], &m_upper[d]);
+                m_sub_edge[d] = m_box_edge / field(m_dims[d]);
+                m_low[d] = -m_box_edge / field(2) + field(m_coords[d]) * m_sub_edge[d];
+                // Ghosts are only received from the adjacent sub-boxes
+                if (m_sub_edge[d] < m_cutoff)
+                    throw std::runtime_error("Too many ranks: the sub-boxes are thinner than the "
+                                             "cutoff");
+                const auto extended = m_sub_edge[d] + field(2) * m_cutoff;
+                m_cells_per_side[d] = std::max(
+                        size_t(1), static_cast<size_t>(std::floor(extended / m_cutoff)));
+                m_cell_edge[d] = extended / field(m_cells_per_side[d]);
+            }
+            m_head.resize(m_cells_per_side[0] * m_cells_per_side[1] * m_cells_per_side[2]);
+            for (size_t i = 0; i < m_n_particles; i++) {
+                const Particle p{i,
+                                 {system.m_positions.e_i[i], system.m_positions.e_j[i],
+                                  system.m_positions.e_k[i]},
+                                 {system.m_prev_positions.e_i[i], system.m_prev_positions.e_j[i],
+                                  system.m_prev_positions.e_k[i]},
+                                 {system.m_velocities.e_i[i], system.m_velocities.e_j[i],
+                                  system.m_velocities.e_k[i]}};
+                if (owner(p.position, 0) == m_coords[0] && owner(p.position, 1) == m_coords[1] &&
+                    owner(p.position, 2) == m_coords[2])
+                    m_owned.push_back(p);
+            }
+            exchange_halo();
+            compute_forces();
+        }
+
+        ~DomainMD() {
+            if (!detail::finalized()) MPI_Comm_free(&m_comm);
+        }
+
+        /**
+         * Evolves the owned molecules, then redistributes them and recomputes the forces.
+         */
+        void step() {
+            for (size_t i = 0; i < m_owned.size(); i++) {
+                auto &p = m_owned[i];
+                for (size_t d = 0; d < 3; d++) {
+                    const auto next = PBC(field(2) * p.position[d] - p.previous[d] +
+                                                  m_forces[i][d] * m_delta2,
+                                          m_box_edge);
+                    p.velocity[d] = PBC(next - p.previous[d], m_box_edge) / m_dbldelta;
+                    p.previous[d] = p.position[d];
+                    p.position[d] = next;
+                }
+            }
+            migrate();
+            exchange_halo();
+            compute_forces();
+            m_time++;
+        }
+
+        /**
+         * Global thermodynamical variables at the current time step, reduced over all the ranks.
+         * Every rank gets the result.
+         */
+        void measures(Field &potential_energy, Field &kinetic_energy, Field &total_energy,
+                      Field &temperature, Field &pressure) const {
+            std::array<field, 3> sums{m_e_pot, m_virial, field(0)};
+            for (const auto &p: m_owned)
+                sums[2] += p.velocity[0] * p.velocity[0] + p.velocity[1] * p.velocity[1] +
+                           p.velocity[2] * p.velocity[2];
+            MPI_Allreduce(MPI_IN_PLACE, sums.data(), 3, detail::mpi_type<field>(), MPI_SUM,
+                          m_comm);
+            auto [e_pot_, virial_, v2] = sums;
+            e_pot_ /= field(m_n_particles);
+            virial_ /= field(3);
+            if constexpr (tail_corrections) {
+                e_pot_ += m_u_tail;
+                virial_ += m_W_tail;
+            }
+            potential_energy = e_pot_;
+            kinetic_energy = v2 / field(2 * m_n_particles);
+            total_energy = potential_energy + kinetic_energy;
+            temperature = 2 * kinetic_energy / field(3);
+            pressure = m_density * temperature + virial_ / (field(m_n_particles) / m_density);
+        }
+
+        /**
+         * Collects the whole state on every rank.
+         * @param system Output: positions, previous positions and velocities are overwritten, the
+         * time step is set to the one of the stepper and the caches of the system are discarded.
+         */
+        void gather(System &system) const {
+            int n_ranks;
+            MPI_Comm_size(m_comm, &n_ranks);
+            // Offsets are bounded by the number of molecules, the same on every rank
+            detail::mpi_count(m_n_particles);
+            const int count = detail::mpi_count(m_owned.size());
+            std::vector<int> counts(static_cast<size_t>(n_ranks)),
+                    offsets(static_cast<size_t>(n_ranks), 0);
+            MPI_Allgather(&count, 1, MPI_INT, counts.data(), 1, MPI_INT, m_comm);
+            for (size_t r = 1; r < counts.size(); r++) offsets[r] = offsets[r - 1] + counts[r - 1];
+            std::vector<Particle> all(m_n_particles);
+            MPI_Allgatherv(m_owned.data(), count, m_particle_type.get(), all.data(),
+                           counts.data(), offsets.data(), m_particle_type.get(), m_comm);
+            for (const auto &p: all) {
+                system.m_positions.e_i[p.id] = p.position[0];
+                system.m_positions.e_j[p.id] = p.position[1];
+                system.m_positions.e_k[p.id] = p.position[2];
+                system.m_prev_positions.e_i[p.id] = p.previous[0];
+                system.m_prev_positions.e_j[p.id] = p.previous[1];
+                system.m_prev_positions.e_k[p.id] = p.previous[2];
+                system.m_velocities.e_i[p.id] = p.velocity[0];
+                system.m_velocities.e_j[p.id] = p.velocity[1];
+                system.m_velocities.e_k[p.id] = p.velocity[2];
+            }
+            system.set_time(m_time);
+        }
+
+        // Number of molecules owned by this rank
+        [[nodiscard]] size_t n_owned() const noexcept { return m_owned.size(); }
+        // Number of ghost molecules in the halo of this rank
+        [[nodiscard]] size_t n_ghosts() const noexcept { return m_local.size() - m_owned.size(); }
+        [[nodiscard]] int rank() const noexcept { return m_rank; }
+        // Number of ranks along each dimension
+        [[nodiscard]] const std::array<int, 3> &dims() const noexcept { return m_dims; }
+        [[nodiscard]] size_t time() const noexcept { return m_time; }
+
+    private:
+        typedef std::array<field, 3> Point;
+        struct Particle {
+            size_t id;
+            Point position, previous, velocity;
+        };
+        static constexpr size_t npos = static_cast<size_t>(-1);
+
+        size_t m_n_particles;
+        field m_box_edge, m_cutoff, m_delta2, m_dbldelta, m_density;
+        Potential m_potential;
+        field m_u_tail, m_W_tail;
+        MPI_Comm m_comm{};
+        int m_rank{0};
+        std::array<int, 3> m_dims{0, 0, 0}, m_coords{}, m_lower{}, m_upper{};
+        // Edges and lower corner of the sub-box
+        Point m_sub_edge{}, m_low{};
+        // Cells over the sub-box and its halo
+        std::array<size_t, 3> m_cells_per_side{};
+        Point m_cell_edge{};
+        std::vector<size_t> m_head{}, m_next{};
+        detail::RecordType<Particle> m_particle_type{};
+        detail::RecordType<Point> m_point_type{};
+        std::vector<Particle> m_owned{}, m_send_lower{}, m_send_upper{}, m_received{};
+        // Forces on the owned molecules
+        std::vector<Point> m_forces{};
+        // Positions of the owned molecules followed by the ghosts
+        std::vector<Point> m_local{};
+        std::vector<Point> m_ghosts_lower{}, m_ghosts_upper{}, m_ghosts_received{};
+        // Local pair sums: each pair counts one half on each side
+        field m_e_pot{0}, m_virial{0};
+        size_t m_time{0};
+
+        // Coordinate of the rank owning a (PBC) position, along dimension d
+        [[nodiscard]] int owner(const Point &x, size_t d) const noexcept {
+            const auto c = static_cast<int>(std::floor((x[d] + m_box_edge / 2) / m_sub_edge[d]));
+            return std::clamp(c, 0, m_dims[d] - 1);
+        }
+
+        /**
+         * Hands the molecules which left the sub-box to the adjacent ranks, one dimension at a
+         * time. Molecules are assumed to move by less than a sub-box edge per step.
+         */
+        void migrate() {
+            for (size_t d = 0; d < 3; d++) {
+                if (m_dims[d] == 1) continue;
+                m_send_lower.clear();
+                m_send_upper.clear();
+                size_t kept = 0;
+                for (auto &p: m_owned) {
+                    const auto c = owner(p.position, d);
+                    if (c == m_coords[d]) m_owned[kept++] = p;
+                    else if (c == (m_coords[d] + m_dims[d] - 1) % m_dims[d])
+                        m_send_lower.push_back(p);
+                    else
+                        m_send_upper.push_back(p);
+                }
+                m_owned.resize(kept);
+                detail::exchange(m_send_lower, m_received, m_particle_type, m_lower[d], m_upper[d],
+                                 m_comm);
+                m_owned.insert(m_owned.end(), m_received.cbegin(), m_received.cend());
+                detail::exchange(m_send_upper, m_received, m_particle_type, m_upper[d], m_lower[d],
+                                 m_comm);
+                m_owned.insert(m_owned.end(), m_received.cbegin(), m_received.cend());
+            }
+        }
+
+        /**
+         * Collects the ghosts within a cutoff from the sub-box. Ghosts received along a dimension
+         * are forwarded along the following ones, which covers edges and corners. Positions are
+         * shifted across the periodic boundaries, so that ghosts lie next to the sub-box.
+         */
+        void exchange_halo() {
+            m_local.clear();
+            for (const auto &p: m_owned) m_local.push_back(p.position);
+            for (size_t d = 0; d < 3; d++) {
+                m_ghosts_lower.clear();
+                m_ghosts_upper.clear();
+                const auto low = m_low[d], high = m_low[d] + m_sub_edge[d];
+                for (const auto &x: m_local) {
+                    if (x[d] < low + m_cutoff) {
+                        m_ghosts_lower.push_back(x);
+                        if (m_coords[d] == 0) m_ghosts_lower.back()[d] += m_box_edge;
+                    }
+                    if (x[d] >= high - m_cutoff) {
+                        m_ghosts_upper.push_back(x);
+                        if (m_coords[d] == m_dims[d] - 1) m_ghosts_upper.back()[d] -= m_box_edge;
+                    }
+                }
+                detail::exchange(m_ghosts_lower, m_ghosts_received, m_point_type, m_lower[d],
+                                 m_upper[d], m_comm);
+                m_local.insert(m_local.end(), m_ghosts_received.cbegin(),
+                               m_ghosts_received.cend());
+                detail::exchange(m_ghosts_upper, m_ghosts_received, m_point_type, m_upper[d],
+                                 m_lower[d], m_comm);
+                m_local.insert(m_local.end(), m_ghosts_received.cbegin(),
+                               m_ghosts_received.cend());
+            }
+        }
+
+        [[nodiscard]] size_t axis_cell(field x, size_t d) const noexcept {
+            const auto c =
+                    static_cast<long>(std::floor((x - m_low[d] + m_cutoff) / m_cell_edge[d]));
+            return static_cast<size_t>(
+                    std::clamp(c, 0L, static_cast<long>(m_cells_per_side[d]) - 1));
+        }
+
+        [[nodiscard]] size_t cell_index(size_t cx, size_t cy, size_t cz) const noexcept {
+            return (cx * m_cells_per_side[1] + cy) * m_cells_per_side[2] + cz;
+        }
+
+        /**
+         * Forces on the owned molecules and local pair sums. The cells of the halo are not
+         * periodic: ghosts already are the periodic images.
+         */
+        void compute_forces() {
+            std::fill(m_head.begin(), m_head.end(), npos);
+            m_next.resize(m_local.size());
+            for (size_t j = 0; j < m_local.size(); j++) {
+                const auto &x = m_local[j];
+                const auto cell =
+                        cell_index(axis_cell(x[0], 0), axis_cell(x[1], 1), axis_cell(x[2], 2));
+                m_next[j] = m_head[cell];
+                m_head[cell] = j;
+            }
+            m_forces.assign(m_owned.size(), Point{0, 0, 0});
+            m_e_pot = 0;
+            m_virial = 0;
+            const auto interact = [&](size_t i, size_t j) {
+                const auto dx = m_local[i][0] - m_local[j][0];
+                const auto dy = m_local[i][1] - m_local[j][1];
+                const auto dz = m_local[i][2] - m_local[j][2];
+                const auto r2 = dx * dx + dy * dy + dz * dz;
+                if (r2 >= m_potential.cutoff2) return;
+                field u, f_r;
+                m_potential.evaluate(r2, u, f_r);
+                m_forces[i][0] += f_r * dx;
+                m_forces[i][1] += f_r * dy;
+                m_forces[i][2] += f_r * dz;
+                m_e_pot += u / field(2);
+                m_virial += f_r * r2 / field(2);
+            };
+            // Range of the cells adjacent to c along dimension d
+            const auto first = [](size_t c) { return c > 0 ? c - 1 : 0; };
+            const auto last = [&](size_t c, size_t d) {
+                return std::min(c + 1, m_cells_per_side[d] - 1);
+            };
+            for (size_t i = 0; i < m_owned.size(); i++) {
+                const auto &x = m_local[i];
+                const std::array<size_t, 3> c{axis_cell(x[0], 0), axis_cell(x[1], 1),
+                                              axis_cell(x[2], 2)};
+                for (size_t cx = first(c[0]); cx <= last(c[0], 0); cx++) {
+                    for (size_t cy = first(c[1]); cy <= last(c[1], 1); cy++) {
+                        for (size_t cz = first(c[2]); cz <= last(c[2], 2); cz++) {
+                            for (size_t j = m_head[cell_index(cx, cy, cz)]; j != npos;
+                                 j = m_next[j])
+                                if (j != i) interact(i, j);
+                        }
+                    }
+                }
+            }
+        }
+    };
+}// namespace molecular_systems::steppers
+
+#endif//ESERCIZI_LSN_MS_STEPPER_DOMAIN_MD_HPP
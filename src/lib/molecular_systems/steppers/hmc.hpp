@@ -0,0 +1,124 @@
+#ifndef ESERCIZI_LSN_MS_STEPPER_HMC_HPP
+#define ESERCIZI_LSN_MS_STEPPER_HMC_HPP
+
+#include <cmath>
+#include <memory>
+#include <random>
+#include <utility>
+
+#include "../algos.hpp"
+#include "molecular_systems/system.hpp"
+
+namespace molecular_systems::steppers {
+    /**
+     * Hybrid Monte Carlo: momenta are drawn from the Maxwell-Boltzmann distribution, the system is
+     * evolved along a velocity Verlet trajectory of a few steps, and the whole trajectory is
+     * accepted or rejected on the change of the total energy. Being time reversible and volume
+     * preserving, the integrator gives a valid move of any length: the canonical distribution is
+     * sampled exactly, whatever the time step. A step of the chain is a whole trajectory.
+     * @tparam field System's numeric field.
+     * @tparam tail_corrections Whether tail corrections to the thermodynamic variables are used.
+     * @tparam URBG Random number generator.
+     * @tparam accumulator Numeric field of the measured variables.
+     * @tparam Potential Pair potential policy.
+     */
+    template<typename field, bool tail_corrections, class URBG, typename accumulator = field,
+             class Potential = potentials::LennardJones<field>>
+    class HMC {
+    public:
+        typedef LJMono<field, tail_corrections, Ensamble::NVT, accumulator, Potential> System;
+        typedef accumulator Field;
+        HMC(HMC &) = delete;
+        HMC(const HMC &) = delete;
+        HMC(HMC &&) noexcept = default;
+
+        /**
+         * Constructor
+         * @param n_trajectory_steps Number of velocity Verlet steps in a trajectory.
+         * @param dt Time step of the trajectories.
+         * @param rng Pointer to a random number generator.
+         */
+        HMC(size_t n_trajectory_steps, field dt, std::shared_ptr<URBG> rng)
+            : m_n_trajectory_steps(n_trajectory_steps), m_dt(dt), m_rng(std::move(rng)) {}
+
+        /**
+         * Samples a new state for the system with a trajectory.
+         * @param system An LJMono system.
+         */
+        void step(System &system) {
+            // Buffers are allocated only once
+            const auto n_particles = system.m_positions.e_i.size();
+            if (system.m_velocities.e_i.size() != n_particles)
+                system.m_velocities = Vectors<field>(n_particles);
+            if (system.m_prev_positions.e_i.size() != n_particles)
+                system.m_prev_positions = system.m_positions;
+            if (system.m_next_positions.e_i.size() != n_particles)
+                system.m_next_positions = system.m_positions;
+            if (!system.forces_computed()) system.compute_forces();
+            Field e_pot_old, virial_old;
+            system.cached_pair_sums(e_pot_old, virial_old);
+            m_old_positions = system.m_positions;
+            m_old_forces = system.m_forces;
+            // The tail corrections do not change at fixed density, and are left out of H
+            sample_velocities(system.m_velocities, field(system.m_thermo.temperature), *m_rng);
+            const auto h_old =
+                    e_pot_old + system.m_velocities.template full_norm2<Field>() / Field(2);
+            const auto half_dt = m_dt / 2;
+            Field norm2{0};
+            for (size_t t = 0; t < m_n_trajectory_steps; t++) {
+                velocity_kick<Field>(system.m_velocities, system.m_forces, half_dt);
+                velocity_drift(system.m_positions, system.m_prev_positions,
+                               system.m_next_positions, system.m_velocities, m_dt,
+                               system.m_simulation.box_edge);
+                system.template compute_forces<false>();
+                norm2 = velocity_kick<Field>(system.m_velocities, system.m_forces, half_dt);
+            }
+            Field e_pot, virial;
+            system.cached_pair_sums(e_pot, virial);
+            // Metropolis' threshold
+            const auto p = std::exp(-(e_pot + norm2 / Field(2) - h_old) /
+                                    system.m_thermo.temperature);
+            m_total_steps++;
+            if (Field(m_unit(*m_rng)) <= p) {
+                m_accepted_steps++;
+            } else {
+                system.m_positions.swap(m_old_positions);
+                system.m_forces.swap(m_old_forces);
+                e_pot = e_pot_old;
+                virial = virial_old;
+            }
+            system.time_step();
+            system.cache_forces(e_pot, virial);
+        }
+
+        // Fraction of accepted trajectories
+        [[nodiscard]] double acceptance_rate() const {
+            return double(m_accepted_steps) / double(m_total_steps);
+        }
+
+        /**
+         * Stores or restores the acceptance counters (see CheckpointArchive). The generator is
+         * shared, and is checkpointed by its owner.
+         * @param archive A checkpoint writer or reader.
+         */
+        template<class Archive>
+        void checkpoint(Archive &archive) {
+            archive.section("HMC");
+            archive(m_accepted_steps, m_total_steps);
+        }
+
+        static constexpr bool tails = tail_corrections;
+        static constexpr bool compute_forces = false;
+
+    private:
+        const size_t m_n_trajectory_steps;
+        const field m_dt;
+        std::uniform_real_distribution<field> m_unit{0, 1};
+        size_t m_accepted_steps{0}, m_total_steps{0};
+        std::shared_ptr<URBG> m_rng;
+        // Configuration at the beginning of the trajectory, restored on rejection
+        Vectors<field> m_old_positions{0}, m_old_forces{0};
+    };
+}// namespace molecular_systems::steppers
+
+#endif//ESERCIZI_LSN_MS_STEPPER_HMC_HPP
@@ -5,6 +5,8 @@
 #ifndef ESERCIZI_LSN_MS_STEPPER_MC_HPP
 #define ESERCIZI_LSN_MS_STEPPER_MC_HPP
 
+#include <algorithm>
+#include <array>
 #include <cmath>
 #include <random>
 #include <vector>
@@ -12,18 +14,25 @@
 #include "../algos.hpp"
 #include "distributions/uniform_int.hpp"
 #include "molecular_systems/system.hpp"
+#include "samplers/MCMC/tuning.hpp"
 
 namespace molecular_systems::steppers {
     /**
-     * Explores an LJMono system's states using the Metropolis-Hastings algorithm.
+     * Explores an LJMono system's states using the Metropolis-Hastings algorithm. Each trial move
+     * only evaluates the pairs of the displaced particle (those in the surrounding cells, if linked
+     * cells are enabled), and the potential energy and virial sums are kept up to date on
+     * acceptance, so that the following measures need no pass over the pairs.
      * @tparam field System's numeric field.
      * @tparam tail_corrections Whether tail corrections to the thermodynamic variables are used.
+     * @tparam accumulator Numeric field of the measured variables.
+     * @tparam Potential Pair potential policy.
      */
-    template<typename field, bool tail_corrections, class URBG>
+    template<typename field, bool tail_corrections, class URBG, typename accumulator = field,
+             class Potential = potentials::LennardJones<field>>
     class MC {
     public:
-        typedef LJMono<field, tail_corrections, Ensamble::NVT> System;
-        typedef field Field;
+        typedef LJMono<field, tail_corrections, Ensamble::NVT, accumulator, Potential> System;
+        typedef accumulator Field;
         MC(MC &) = delete;
         MC(const MC &) = delete;
         MC(MC &&) noexcept = default;
@@ -43,34 +52,105 @@ namespace molecular_systems::steppers {
          * @param system An LJMono system.
          */
         void step(System &system) {
+            // Linked cells, if enabled, are rebuilt once per sweep and kept up to date on acceptance
+            auto &cells = system.m_cells;
+            if (cells.has_value()) cells->build(system.m_positions);
+            // Pair energy and virial of a particle. Tail corrections cancel out in the differences
+            const auto sums = [&](size_t particle, const std::array<field, 3> &position,
+                                  field &energy, field &virial) {
+                if (cells.has_value())
+                    particle_sums(particle, position, system.m_positions, system.m_simulation,
+                                  system.m_potential, *cells, energy, virial);
+                else
+                    particle_sums(particle, position, system.m_positions, system.m_simulation,
+                                  system.m_potential, energy, virial);
+            };
+            // The running sums are rebuilt if the system was evolved by someone else
+            if (m_sums_time != system.time()) {
+                m_e_pot = accumulator(0);
+                m_virial = accumulator(0);
+                for (size_t particle = 0; particle < m_n_particles; particle++) {
+                    field energy, virial;
+                    sums(particle, system.m_positions[particle], energy, virial);
+                    m_e_pot += accumulator(energy) / 2;
+                    m_virial += accumulator(virial) / 2;
+                }
+            }
             for (size_t i = 0; i < m_n_particles; i++) {
                 // Sampling a particle to displace
                 const size_t particle = m_particle(*m_rng);
                 const auto old_position = system.m_positions[particle];
                 // Sampled particle's energy
-                const auto e_old = LJ_potential<tail_corrections>(
-                        particle, old_position, system.m_positions, system.m_simulation);
+                field e_old, w_old;
+                sums(particle, old_position, e_old, w_old);
                 // Sampling a new position
                 const auto newx = system.pbc(old_position[0] + m_displacement(*m_rng));
                 const auto newy = system.pbc(old_position[1] + m_displacement(*m_rng));
                 const auto newz = system.pbc(old_position[2] + m_displacement(*m_rng));
                 // Displaced particle's energy
-                const auto e_new = LJ_potential<tail_corrections>(
-                        particle, {newx, newy, newz}, system.m_positions, system.m_simulation);
+                field e_new, w_new;
+                sums(particle, {newx, newy, newz}, e_new, w_new);
                 // Metropolis' threshold
-                const auto p = std::exp((e_old - e_new) / system.m_thermo.temperature);
-                if (m_unit(*m_rng) <= p) {
+                const auto p =
+                        std::exp(accumulator(e_old - e_new) / system.m_thermo.temperature);
+                if (accumulator(m_unit(*m_rng)) <= p) {
                     //                    system.m_prev_positions.e_i[particle] = old_position[0];
                     //                    system.m_prev_positions.e_j[particle] = old_position[1];
                     //                    system.m_prev_positions.e_k[particle] = old_position[2];
                     system.m_positions.e_i[particle] = newx;
                     system.m_positions.e_j[particle] = newy;
                     system.m_positions.e_k[particle] = newz;
+                    if (cells.has_value()) cells->move(particle, {newx, newy, newz});
+                    m_e_pot += accumulator(e_new) - accumulator(e_old);
+                    m_virial += accumulator(w_new) - accumulator(w_old);
                     m_accepted_steps++;
                 }
             }
             m_total_steps += m_n_particles;
             system.time_step();
+            system.cache_pair_sums(m_e_pot, m_virial);
+            m_sums_time = system.time();
+        }
+
+        /**
+         * Warmup which adapts the displacement diameter block by block toward a target
+         * acceptance rate (see samplers::mcmc::tuned_width), up to the box edge. The last diameter
+         * is then kept fixed, so that the following sweeps obey detailed balance; the acceptance
+         * rate only counts the latter.
+         * @param system An LJMono system.
+         * @param n_blocks Number of warmup blocks.
+         * @param block_size Number of sweeps in a block.
+         * @param target Target acceptance rate.
+         * @return Displacement diameter and acceptance rate of each block.
+         */
+        std::vector<samplers::mcmc::TuningBlock<field>> tune(System &system, size_t n_blocks,
+                                                             size_t block_size,
+                                                             double target = 0.5) {
+            std::vector<samplers::mcmc::TuningBlock<field>> blocks;
+            blocks.reserve(n_blocks);
+            for (size_t block = 0; block < n_blocks; block++) {
+                m_accepted_steps = 0;
+                m_total_steps = 0;
+                for (size_t sweep = 0; sweep < block_size; sweep++) step(system);
+                const auto diameter = displacement_diameter();
+                blocks.push_back({diameter, acceptance_rate()});
+                set_displacement_diameter(
+                        std::min(samplers::mcmc::tuned_width(diameter, acceptance_rate(), target),
+                                 system.m_simulation.box_edge));
+            }
+            m_accepted_steps = 0;
+            m_total_steps = 0;
+            return blocks;
+        }
+
+        // Diameter in which a tentative particle is sampled
+        [[nodiscard]] field displacement_diameter() const noexcept {
+            return m_displacement.b() - m_displacement.a();
+        }
+
+        void set_displacement_diameter(field displacement_diameter) {
+            m_displacement = std::uniform_real_distribution<field>(-displacement_diameter / 2,
+                                                                   displacement_diameter / 2);
         }
 
         // Acceptance rate during the last round
@@ -78,6 +158,20 @@ namespace molecular_systems::steppers {
             return double(m_accepted_steps) / double(m_total_steps);
         }
 
+        /**
+         * Stores or restores the displacement, the acceptance counters and the running sums (see
+         * CheckpointArchive). The generator is shared, and is checkpointed by its owner.
+         * @param archive A checkpoint writer or reader.
+         */
+        template<class Archive>
+        void checkpoint(Archive &archive) {
+            archive.section("MC");
+            auto a = m_displacement.a(), b = m_displacement.b();
+            archive(a, b, m_accepted_steps, m_total_steps, m_e_pot, m_virial, m_sums_time);
+            if constexpr (Archive::loading)
+                m_displacement = std::uniform_real_distribution<field>(a, b);
+        }
+
         static constexpr bool tails = tail_corrections;
         static constexpr bool compute_forces = false;
 
@@ -89,6 +183,9 @@ namespace molecular_systems::steppers {
         size_t m_accepted_steps{0};
         size_t m_total_steps{0};
         std::shared_ptr<URBG> m_rng;
+        // Running sums of the pair potentials and virials, and the time step they refer to
+        accumulator m_e_pot{0}, m_virial{0};
+        size_t m_sums_time{static_cast<size_t>(-1)};
     };
 }// namespace molecular_systems::steppers
 
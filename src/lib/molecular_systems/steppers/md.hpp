@@ -6,54 +6,67 @@
 #define ESERCIZI_LSN_MS_STEPPER_MD_HPP
 
 #include <memory>
+#include <utility>
 
 #include "../algos.hpp"
 #include "../system.hpp"
 #include "collectors.hpp"
+#include "thermostats.hpp"
 
 namespace molecular_systems::steppers {
+    namespace detail {
+        /**
+         * Advances a system by a Verlet step, rotating its position buffers in place.
+         * @param system An LJMono system, with forces computed at the current time step.
+         */
+        template<class System>
+        void advance(System &system) {
+            // The buffer is allocated only once
+            if (system.m_next_positions.e_i.size() != system.m_positions.e_i.size())
+                system.m_next_positions = system.m_positions;
+            const auto norm2 = verlet_step<typename System::Field>(
+                    system.m_positions, system.m_prev_positions, system.m_next_positions,
+                    system.m_velocities, system.m_forces, system.m_simulation.delta2,
+                    system.m_simulation.dbldelta, system.m_simulation.box_edge);
+            system.time_step();
+            system.cache_velocities_norm2(norm2);
+        }
+    }// namespace detail
 
     /**
      * Stepper used in exercise 04
      * @tparam field
      * @tparam tail_corrections
+     * @tparam accumulator Numeric field of the measured variables
+     * @tparam Potential Pair potential policy
      */
-    template<typename field, bool tail_corrections>
-    class MD : public Stepper<LJMono<field, tail_corrections, Ensamble::NVE>,
-                              MD<field, tail_corrections>> {
+    template<typename field, bool tail_corrections, typename accumulator = field,
+             class Potential = potentials::LennardJones<field>>
+    class MD : public Stepper<LJMono<field, tail_corrections, Ensamble::NVE, accumulator, Potential>,
+                              MD<field, tail_corrections, accumulator, Potential>> {
         typedef Vectors<field> V;
-        using System = LJMono<field, tail_corrections, Ensamble::NVE>;
-        using Base = Stepper<LJMono<field, tail_corrections, Ensamble::NVE>,
-                             MD<field, tail_corrections>>;
+        using System = LJMono<field, tail_corrections, Ensamble::NVE, accumulator, Potential>;
+        using Base = Stepper<System, MD<field, tail_corrections, accumulator, Potential>>;
 
     public:
         explicit MD(std::shared_ptr<System> system) : Base(system) {}
 
-        void step() {
-            Vectors<field> next_positions(this->m_system->m_simulation.n_particles);
-            verlet_next_positions(this->m_system->m_positions, this->m_system->m_prev_positions,
-                                  next_positions, this->m_system->m_forces,
-                                  this->m_system->m_simulation.delta2,
-                                  this->m_system->m_simulation.box_edge);
-            verlet_next_velocities(
-                    next_positions, this->m_system->m_prev_positions, this->m_system->m_velocities,
-                    this->m_system->m_simulation.dbldelta, this->m_system->m_simulation.box_edge);
-            this->m_system->m_prev_positions = std::move(this->m_system->m_positions);
-            this->m_system->m_positions = std::move(next_positions);
-            this->m_system->time_step();
-        }
+        void step() { detail::advance(*this->m_system); }
     };
 
     /**
      * Stepper used in exercise 07
      * @tparam field
      * @tparam tail_corrections
+     * @tparam accumulator Numeric field of the measured variables
+     * @tparam Potential Pair potential policy
      */
-    template<typename field, bool tail_corrections>
+    template<typename field, bool tail_corrections, typename accumulator = field,
+             class Potential = potentials::LennardJones<field>>
     class MD2 {
     public:
-        typedef LJMono<field, tail_corrections, Ensamble::NVE> System;
-        typedef field Field;
+        typedef LJMono<field, tail_corrections, Ensamble::NVE, accumulator, Potential> System;
+        typedef accumulator Field;
         MD2(MD2 &) = delete;
         MD2(const MD2 &) = delete;
         MD2(MD2 &&) noexcept = default;
@@ -66,20 +79,79 @@ namespace molecular_systems::steppers {
          * is very bad
          * @param system An LJMono system.
          */
+        void step(System &system) { detail::advance(system); }
+
+        // The stepper is stateless: everything lives in the system (see CheckpointArchive)
+        template<class Archive>
+        void checkpoint(Archive &archive) {
+            archive.section("MD2");
+        }
+
+        static constexpr bool tails = tail_corrections;
+        static constexpr bool compute_forces = true;
+    };
+
+    /**
+     * Velocity Verlet stepper, with a pluggable thermostat acting on the velocities at both ends
+     * of the step (see thermostats.hpp).
+     * @tparam field
+     * @tparam tail_corrections
+     * @tparam Thermostat Thermostat policy: thermostats::None gives NVE dynamics
+     * @tparam accumulator Numeric field of the measured variables
+     * @tparam Potential Pair potential policy
+     */
+    template<typename field, bool tail_corrections, class Thermostat = thermostats::None<field>,
+             typename accumulator = field, class Potential = potentials::LennardJones<field>>
+    class VelocityVerlet {
+    public:
+        typedef LJMono<field, tail_corrections, Ensamble::NVE, accumulator, Potential> System;
+        typedef accumulator Field;
+        VelocityVerlet(VelocityVerlet &) = delete;
+        VelocityVerlet(const VelocityVerlet &) = delete;
+        VelocityVerlet(VelocityVerlet &&) noexcept = default;
+
+        explicit VelocityVerlet(Thermostat thermostat = Thermostat())
+            : m_thermostat(std::move(thermostat)) {}
+
+        /**
+         * Evolves the system's state by a velocity Verlet step. Forces at the new time step are
+         * computed here, so that the following call to "measures" reuses them.
+         * @param system An LJMono system.
+         */
         void step(System &system) {
-            Vectors<field> next_positions(system.m_simulation.n_particles);
-            verlet_next_positions(system.m_positions, system.m_prev_positions, next_positions,
-                                  system.m_forces, system.m_simulation.delta2,
-                                  system.m_simulation.box_edge);
-            verlet_next_velocities(next_positions, system.m_prev_positions, system.m_velocities,
-                                   system.m_simulation.dbldelta, system.m_simulation.box_edge);
-            system.m_prev_positions = std::move(system.m_positions);
-            system.m_positions = std::move(next_positions);
+            if (system.m_next_positions.e_i.size() != system.m_positions.e_i.size())
+                system.m_next_positions = system.m_positions;
+            if (!system.forces_computed()) system.compute_forces();
+            const auto dt = system.m_simulation.delta;
+            const auto half_dt = dt / 2;
+            m_thermostat.begin(system, half_dt);
+            velocity_kick<Field>(system.m_velocities, system.m_forces, half_dt);
+            velocity_drift(system.m_positions, system.m_prev_positions, system.m_next_positions,
+                           system.m_velocities, dt, system.m_simulation.box_edge);
             system.time_step();
+            system.compute_forces();
+            const auto norm2 = velocity_kick<Field>(system.m_velocities, system.m_forces, half_dt);
+            system.cache_velocities_norm2(m_thermostat.end(system, half_dt, norm2));
+        }
+
+        [[nodiscard]] Thermostat &thermostat() noexcept { return m_thermostat; }
+        [[nodiscard]] const Thermostat &thermostat() const noexcept { return m_thermostat; }
+
+        /**
+         * Stores or restores the thermostat's state (see CheckpointArchive).
+         * @param archive A checkpoint writer or reader.
+         */
+        template<class Archive>
+        void checkpoint(Archive &archive) {
+            archive.section("VelocityVerlet");
+            archive(m_thermostat);
         }
 
         static constexpr bool tails = tail_corrections;
         static constexpr bool compute_forces = true;
+
+    private:
+        Thermostat m_thermostat;
     };
 }// namespace molecular_systems::steppers
 
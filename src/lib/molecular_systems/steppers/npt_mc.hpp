@@ -0,0 +1,189 @@
+#ifndef ESERCIZI_LSN_MS_STEPPER_NPT_MC_HPP
+#define ESERCIZI_LSN_MS_STEPPER_NPT_MC_HPP
+
+#include <array>
+#include <cmath>
+#include <memory>
+#include <random>
+
+#include "../algos.hpp"
+#include "distributions/uniform_int.hpp"
+#include "molecular_systems/system.hpp"
+
+namespace molecular_systems::steppers {
+    /**
+     * Explores the states of a Lennard-Jones system in the isothermal-isobaric ensemble with the
+     * Metropolis-Hastings algorithm: a sweep is made of N single particle moves and one volume
+     * move. The cutoff scales with the box, and the sums of r^-12 and r^-6 over the pairs are kept
+     * separately: a uniform rescaling by s multiplies them by s^-12 and s^-6, so that a volume move
+     * costs O(1). The system is rescaled only when the move is accepted.
+     * @tparam field System's numeric field.
+     * @tparam tail_corrections Whether tail corrections to the thermodynamic variables are used.
+     * @tparam URBG Random number generator.
+     * @tparam accumulator Numeric field of the measured variables.
+     */
+    template<typename field, bool tail_corrections, class URBG, typename accumulator = field>
+    class NPTMC {
+    public:
+        typedef LJMono<field, tail_corrections, Ensamble::NPT, accumulator> System;
+        typedef accumulator Field;
+        NPTMC(NPTMC &) = delete;
+        NPTMC(const NPTMC &) = delete;
+        NPTMC(NPTMC &&) noexcept = default;
+
+        /**
+         * Constructor
+         * @param n_particles Number of particles in the system.
+         * @param displacement_diameter Diameter in which a tentative particle will be sampled.
+         * @param log_volume_diameter Diameter in which the logarithm of the volume ratio of a
+         * tentative volume move will be sampled.
+         * @param pressure Pressure of the ensemble.
+         * @param rng Pointer to a random number generator.
+         */
+        NPTMC(size_t n_particles, field displacement_diameter, Field log_volume_diameter,
+              Field pressure, std::shared_ptr<URBG> rng)
+            : m_n_particles(n_particles), m_pressure(pressure), m_particle(0, n_particles - 1),
+              m_displacement(-displacement_diameter / 2, displacement_diameter / 2),
+              m_log_volume(-log_volume_diameter / 2, log_volume_diameter / 2), m_rng(rng) {}
+
+        /**
+         * Samples a new state for the system with a sweep of particle moves and a volume move.
+         * @param system An LJMono system.
+         */
+        void step(System &system) {
+            // Linked cells, if enabled, are rebuilt once per sweep and kept up to date on acceptance
+            auto &cells = system.m_cells;
+            if (cells.has_value()) cells->build(system.m_positions);
+            const auto sums = [&](size_t particle, const std::array<field, 3> &position,
+                                  field &s12, field &s6) {
+                if (cells.has_value())
+                    lj_power_sums(particle, position, system.m_positions, system.m_simulation,
+                                  *cells, s12, s6);
+                else
+                    lj_power_sums(particle, position, system.m_positions, system.m_simulation,
+                                  s12, s6);
+            };
+            // The running sums are rebuilt if the system was evolved by someone else
+            if (m_sums_time != system.time()) {
+                m_s12 = Field(0);
+                m_s6 = Field(0);
+                for (size_t particle = 0; particle < m_n_particles; particle++) {
+                    field s12, s6;
+                    sums(particle, system.m_positions[particle], s12, s6);
+                    m_s12 += Field(s12) / 2;
+                    m_s6 += Field(s6) / 2;
+                }
+            }
+            for (size_t i = 0; i < m_n_particles; i++) {
+                // Sampling a particle to displace
+                const size_t particle = m_particle(*m_rng);
+                const auto old_position = system.m_positions[particle];
+                field s12_old, s6_old;
+                sums(particle, old_position, s12_old, s6_old);
+                // Sampling a new position
+                const std::array<field, 3> new_position{
+                        system.pbc(old_position[0] + m_displacement(*m_rng)),
+                        system.pbc(old_position[1] + m_displacement(*m_rng)),
+                        system.pbc(old_position[2] + m_displacement(*m_rng))};
+                field s12_new, s6_new;
+                sums(particle, new_position, s12_new, s6_new);
+                const auto delta_s12 = Field(s12_new) - Field(s12_old);
+                const auto delta_s6 = Field(s6_new) - Field(s6_old);
+                // Metropolis' threshold
+                const auto p = std::exp(-Field(4) * (delta_s12 - delta_s6) /
+                                        system.m_thermo.temperature);
+                if (Field(m_unit(*m_rng)) <= p) {
+                    system.m_positions.e_i[particle] = new_position[0];
+                    system.m_positions.e_j[particle] = new_position[1];
+                    system.m_positions.e_k[particle] = new_position[2];
+                    if (cells.has_value()) cells->move(particle, new_position);
+                    m_s12 += delta_s12;
+                    m_s6 += delta_s6;
+                    m_accepted_steps++;
+                }
+            }
+            m_total_steps += m_n_particles;
+            volume_move(system);
+            system.time_step();
+            system.cache_pair_sums(Field(4) * (m_s12 - m_s6),
+                                   Field(48) * m_s12 - Field(24) * m_s6);
+            m_sums_time = system.time();
+        }
+
+        // Acceptance rate of the particle moves
+        [[nodiscard]] double acceptance_rate() const {
+            return double(m_accepted_steps) / double(m_total_steps);
+        }
+
+        // Acceptance rate of the volume moves
+        [[nodiscard]] double volume_acceptance_rate() const {
+            return double(m_accepted_volumes) / double(m_total_volumes);
+        }
+
+        /**
+         * Stores or restores the move widths, the acceptance counters and the running sums (see
+         * CheckpointArchive). The generator is shared, and is checkpointed by its owner.
+         * @param archive A checkpoint writer or reader.
+         */
+        template<class Archive>
+        void checkpoint(Archive &archive) {
+            archive.section("NPTMC");
+            auto a = m_displacement.a(), b = m_displacement.b();
+            auto log_a = m_log_volume.a(), log_b = m_log_volume.b();
+            archive(a, b, log_a, log_b);
+            if constexpr (Archive::loading) {
+                m_displacement = std::uniform_real_distribution<field>(a, b);
+                m_log_volume = std::uniform_real_distribution<Field>(log_a, log_b);
+            }
+            archive(m_accepted_steps, m_total_steps, m_accepted_volumes, m_total_volumes);
+            archive(m_s12, m_s6, m_sums_time);
+        }
+
+        static constexpr bool tails = tail_corrections;
+        static constexpr bool compute_forces = false;
+
+    private:
+        /**
+         * Attempts a random walk step in the logarithm of the volume.
+         */
+        void volume_move(System &system) {
+            const auto n = Field(m_n_particles);
+            const auto density = system.m_thermo.density;
+            const auto cutoff = Field(system.m_simulation.cutoff);
+            const auto log_ratio = m_log_volume(*m_rng);
+            const auto ratio = std::exp(log_ratio);
+            const auto scale = std::cbrt(ratio);
+            const auto scale6 = Field(1) / (ratio * ratio);
+            const auto scale12 = scale6 * scale6;
+            auto delta_u = Field(4) * (m_s12 * (scale12 - Field(1)) - m_s6 * (scale6 - Field(1)));
+            if constexpr (tail_corrections)
+                delta_u += n * (lj_u_tail_correction(density / ratio, cutoff * scale) -
+                                lj_u_tail_correction(density, cutoff));
+            const auto volume = n / density;
+            const auto exponent = -(delta_u + m_pressure * volume * (ratio - Field(1))) /
+                                          system.m_thermo.temperature +
+                                  (n + Field(1)) * log_ratio;
+            m_total_volumes++;
+            if (Field(m_unit(*m_rng)) > std::exp(exponent)) return;
+            system.rescale(field(scale));
+            m_s12 *= scale12;
+            m_s6 *= scale6;
+            m_accepted_volumes++;
+        }
+
+        const size_t m_n_particles;
+        const Field m_pressure;
+        distributions::uniform_int<size_t> m_particle;
+        std::uniform_real_distribution<field> m_displacement;
+        std::uniform_real_distribution<Field> m_log_volume;
+        std::uniform_real_distribution<field> m_unit{0, 1};
+        size_t m_accepted_steps{0}, m_total_steps{0};
+        size_t m_accepted_volumes{0}, m_total_volumes{0};
+        std::shared_ptr<URBG> m_rng;
+        // Running sums of r^-12 and r^-6 over the pairs, and the time step they refer to
+        Field m_s12{0}, m_s6{0};
+        size_t m_sums_time{static_cast<size_t>(-1)};
+    };
+}// namespace molecular_systems::steppers
+
+#endif//ESERCIZI_LSN_MS_STEPPER_NPT_MC_HPP
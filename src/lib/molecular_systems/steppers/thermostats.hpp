@@ -0,0 +1,234 @@
+#ifndef ESERCIZI_LSN_MS_THERMOSTATS_HPP
+#define ESERCIZI_LSN_MS_THERMOSTATS_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * Thermostats for the velocity Verlet stepper. Each one acts on the velocities of an LJMono system
+ * twice per time step, through
+ *  - begin(system, half_dt), before the first half kick;
+ *  - end(system, half_dt, norm2), after the second half kick, where norm2 is the sum of the
+ *    squared velocities. It returns the sum after the thermostat acted.
+ * Temperatures are in reduced units, with 3N degrees of freedom.
+ */
+namespace molecular_systems::steppers::thermostats {
+    /**
+     * No thermostat: plain NVE dynamics.
+     */
+    template<typename field>
+    struct None {
+        template<class System>
+        void begin(System &, field) {}
+
+        template<class System>
+        typename System::Field end(System &, field, typename System::Field norm2) {
+            return norm2;
+        }
+
+        // Nothing to store (see CheckpointArchive)
+        template<class Archive>
+        void checkpoint(Archive &archive) {
+            archive.section("None");
+        }
+    };
+
+    /**
+     * Berendsen's weak coupling: velocities are rescaled so that the temperature relaxes
+     * exponentially towards the target one. Fast at equilibrating, but it does not sample the
+     * canonical ensemble.
+     */
+    template<typename field>
+    class Berendsen {
+    public:
+        /**
+         * Constructor
+         * @param temperature Target temperature.
+         * @param tau Relaxation time.
+         */
+        Berendsen(field temperature, field tau) : m_temperature(temperature), m_tau(tau) {}
+
+        template<class System>
+        void begin(System &, field) {}
+
+        template<class System>
+        typename System::Field end(System &system, field half_dt, typename System::Field norm2) {
+            using Field = typename System::Field;
+            const auto temperature = norm2 / Field(3 * system.m_simulation.n_particles);
+            if (temperature <= Field(0)) return norm2;
+            const auto lambda2 = Field(1) + Field(2 * half_dt / m_tau) *
+                                                    (Field(m_temperature) / temperature - Field(1));
+            const auto lambda = std::sqrt(std::max(lambda2, Field(0)));
+            system.m_velocities *= field(lambda);
+            return norm2 * lambda * lambda;
+        }
+
+        // Nothing to store besides the settings (see CheckpointArchive)
+        template<class Archive>
+        void checkpoint(Archive &archive) {
+            archive.section("Berendsen");
+        }
+
+    private:
+        field m_temperature, m_tau;
+    };
+
+    /**
+     * Andersen's stochastic collisions: at each step, every particle's velocity is resampled from
+     * the Maxwell-Boltzmann distribution with probability nu*dt. Samples the canonical ensemble,
+     * but dynamical properties are disturbed.
+     */
+    template<typename field, class URBG>
+    class Andersen {
+    public:
+        /**
+         * Constructor
+         * @param temperature Target temperature.
+         * @param nu Collision frequency.
+         * @param rng Pointer to a random number generator.
+         */
+        Andersen(field temperature, field nu, std::shared_ptr<URBG> rng)
+            : m_nu(nu), m_gauss(0, std::sqrt(temperature)), m_rng(rng) {}
+
+        template<class System>
+        void begin(System &, field) {}
+
+        template<class System>
+        typename System::Field end(System &system, field half_dt, typename System::Field norm2) {
+            using Field = typename System::Field;
+            const auto probability = m_nu * 2 * half_dt;
+            auto &v = system.m_velocities;
+            for (size_t i = 0; i < system.m_simulation.n_particles; i++) {
+                if (m_unit(*m_rng) >= probability) continue;
+                norm2 -= Field(v.e_i[i]) * Field(v.e_i[i]) + Field(v.e_j[i]) * Field(v.e_j[i]) +
+                         Field(v.e_k[i]) * Field(v.e_k[i]);
+                v.e_i[i] = m_gauss(*m_rng);
+                v.e_j[i] = m_gauss(*m_rng);
+                v.e_k[i] = m_gauss(*m_rng);
+                norm2 += Field(v.e_i[i]) * Field(v.e_i[i]) + Field(v.e_j[i]) * Field(v.e_j[i]) +
+                         Field(v.e_k[i]) * Field(v.e_k[i]);
+            }
+            return norm2;
+        }
+
+        /**
+         * Stores or restores the Gaussian distribution, which caches a draw (see
+         * CheckpointArchive). The generator is shared, and is checkpointed by its owner.
+         * @param archive A checkpoint writer or reader.
+         */
+        template<class Archive>
+        void checkpoint(Archive &archive) {
+            archive.section("Andersen");
+            archive.rng(m_gauss);
+        }
+
+    private:
+        field m_nu;
+        std::normal_distribution<field> m_gauss;
+        std::uniform_real_distribution<field> m_unit{0, 1};
+        std::shared_ptr<URBG> m_rng;
+    };
+
+    /**
+     * Nosé-Hoover chain, integrated with the scheme of Martyna, Tuckerman and Klein: the chain
+     * variables are advanced by half a time step at both ends of the velocity Verlet step.
+     * Samples the canonical ensemble with a deterministic dynamics, whose extended energy is
+     * conserved.
+     */
+    template<typename field>
+    class NoseHooverChain {
+    public:
+        /**
+         * Constructor
+         * @param temperature Target temperature.
+         * @param tau Characteristic time of the thermostat.
+         * @param n_particles Number of particles of the system.
+         * @param length Number of thermostats in the chain.
+         */
+        NoseHooverChain(field temperature, field tau, size_t n_particles, size_t length = 3)
+            : m_temperature(temperature), m_dof(field(3 * n_particles)), m_masses(length),
+              m_xi(length, field(0)), m_eta(length, field(0)) {
+            if (length == 0) throw std::runtime_error("A Nosé-Hoover chain needs a thermostat");
+            for (auto &mass: m_masses) mass = temperature * tau * tau;
+            m_masses[0] *= m_dof;
+        }
+
+        template<class System>
+        void begin(System &system, field half_dt) {
+            half_step(system, half_dt, system.m_velocities.full_norm2());
+        }
+
+        template<class System>
+        typename System::Field end(System &system, field half_dt, typename System::Field norm2) {
+            return half_step(system, half_dt, norm2);
+        }
+
+        /**
+         * Energy of the chain, per particle as the measured energies: added to the total energy
+         * it gives the conserved quantity.
+         */
+        [[nodiscard]] field extended_energy() const {
+            field energy = m_dof * m_temperature * m_eta[0];
+            for (size_t k = 0; k < m_xi.size(); k++) {
+                energy += m_masses[k] * m_xi[k] * m_xi[k] / 2;
+                if (k > 0) energy += m_temperature * m_eta[k];
+            }
+            return energy / (m_dof / 3);
+        }
+
+        /**
+         * Stores or restores the velocities and positions of the thermostats (see
+         * CheckpointArchive).
+         * @param archive A checkpoint writer or reader.
+         */
+        template<class Archive>
+        void checkpoint(Archive &archive) {
+            archive.section("NoseHooverChain");
+            archive.expect(m_xi.size(), "length of the Nosé-Hoover chain");
+            archive(m_xi, m_eta);
+        }
+
+    private:
+        // Generalized force acting on the k-th thermostat
+        [[nodiscard]] field force(size_t k, field norm2) const {
+            if (k == 0) return (norm2 - m_dof * m_temperature) / m_masses[0];
+            return (m_masses[k - 1] * m_xi[k - 1] * m_xi[k - 1] - m_temperature) / m_masses[k];
+        }
+
+        // Updates the k-th thermostat velocity by dt, coupled to the next one
+        void update_xi(size_t k, field norm2, field dt) {
+            if (k + 1 == m_xi.size()) {
+                m_xi[k] += force(k, norm2) * dt;
+                return;
+            }
+            const auto damping = std::exp(-m_xi[k + 1] * dt / 2);
+            m_xi[k] *= damping;
+            m_xi[k] += force(k, norm2) * dt;
+            m_xi[k] *= damping;
+        }
+
+        template<class System, typename Norm>
+        Norm half_step(System &system, field half_dt, Norm norm2) {
+            const size_t length = m_xi.size();
+            const auto quarter_dt = half_dt / 2;
+            for (size_t k = length; k-- > 0;) update_xi(k, field(norm2), quarter_dt);
+            const auto scale = std::exp(-m_xi[0] * half_dt);
+            system.m_velocities *= scale;
+            norm2 *= Norm(scale) * Norm(scale);
+            for (size_t k = 0; k < length; k++) m_eta[k] += m_xi[k] * half_dt;
+            for (size_t k = 0; k < length; k++) update_xi(k, field(norm2), quarter_dt);
+            return norm2;
+        }
+
+        field m_temperature, m_dof;
+        // Masses, velocities and positions of the thermostats
+        std::vector<field> m_masses, m_xi, m_eta;
+    };
+}// namespace molecular_systems::steppers::thermostats
+
+#endif//ESERCIZI_LSN_MS_THERMOSTATS_HPP
@@ -11,29 +11,40 @@
 #include <cstddef>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <optional>
 #include <random>
 #include <type_traits>
 
 #include "algos.hpp"
+#include "data_types/cells.hpp"
 #include "data_types/measures.hpp"
+#include "data_types/neighbor_list.hpp"
+#include "data_types/radial.hpp"
 #include "data_types/settings.hpp"
 #include "data_types/vectors.hpp"
 #include "estimators/mean.hpp"
+#include "potentials.hpp"
+#include "utils.hpp"
 
 using namespace estimators;
 namespace fs = std::filesystem;
 
-enum Ensamble { NVT, NVE };
+// NVT and NPT systems are sampled at fixed temperature, NVE ones measure it from the velocities
+enum Ensamble { NVT, NVE, NPT };
 
 /**
  * Lennard-Jones molecular system
- * @tparam field Numeric field for physical variables
+ * @tparam field Numeric field for positions, velocities and forces
+ * @tparam accumulator Numeric field for energies, virial and the other measured variables. A
+ * wider type than field gives a mixed-precision system, e.g. LJMono<float, ..., double>.
+ * @tparam Potential Pair potential policy (see potentials.hpp), Lennard-Jones by default.
  */
-template<typename field, bool tail_corrections, Ensamble ens>
+template<typename field, bool tail_corrections, Ensamble ens, typename accumulator = field,
+         class Potential = molecular_systems::potentials::LennardJones<field>>
 class LJMono {
 public:
-    typedef field Field;
+    typedef accumulator Field;
     LJMono() = delete;
     LJMono(LJMono &) = delete;
     LJMono(const LJMono &) = delete;
@@ -46,7 +57,10 @@ public:
     LJMono(const fs::path &settings_path, const fs::path &positions_path)
         : m_thermo(settings_path), m_simulation(settings_path),
           m_positions(m_simulation.n_particles, positions_path),
-          m_forces(m_simulation.n_particles) {
+          m_forces(m_simulation.n_particles),
+          m_u_tail(m_potential.template tail_energy<Field>(m_thermo.density)),
+          m_W_tail(m_potential.template tail_virial<Field>(m_thermo.density,
+                                                           m_simulation.n_particles)) {
         m_positions.apply([&](auto &x) { x = pbc(x * m_simulation.box_edge); });
     }
 
@@ -67,7 +81,7 @@ public:
                                        m_simulation.box_edge, m_prev_positions);
         } else {
             m_velocities = Vectors<field>(m_simulation.n_particles);
-            generate_velocities(m_velocities, m_thermo.temperature, rng);
+            generate_velocities(m_velocities, field(m_thermo.temperature), rng);
             compute_previous_positions(m_positions, m_velocities, m_simulation.delta,
                                        m_simulation.box_edge, m_prev_positions);
         }
@@ -136,9 +150,10 @@ public:
     template<class URBG, std::enable_if_t<std::is_invocable_v<URBG>, bool> = true>
     void init_velocities(URBG &rng) {
         m_velocities = Vectors<field>(m_simulation.n_particles);
-        generate_velocities(m_velocities, m_thermo.temperature, rng);
+        generate_velocities(m_velocities, field(m_thermo.temperature), rng);
         compute_previous_positions(m_positions, m_velocities, m_simulation.delta,
                                    m_simulation.box_edge, m_prev_positions);
+        m_norm2_time = npos;
     }
 
 
@@ -150,6 +165,7 @@ public:
         m_velocities = Vectors<field>(m_simulation.n_particles, velocities_path);
         compute_previous_positions(m_positions, m_velocities, m_simulation.delta,
                                    m_simulation.box_edge, m_prev_positions);
+        m_norm2_time = npos;
     }
 
 
@@ -173,173 +189,298 @@ public:
     void time_step() { m_time++; }
 
     /**
-     * Initializes the radial distribution histogram
+     * Sets the current time step after the state has been overwritten from outside, e.g.
+     * gathered from a distributed stepper: the cached sums, forces and norm are discarded.
+     * @param time Time step of the new state.
+     */
+    void set_time(size_t time) noexcept {
+        m_time = time;
+        m_norm2_time = npos;
+        m_sums_time = npos;
+        m_forces_time = npos;
+        m_radial_time = npos;
+    }
+
+    /**
+     * Stores the squared norm of the velocities at the current time step, as computed by an
+     * integrator while updating them: measures then need no further pass over the velocities.
+     * @param norm2 Sum of the squared velocities.
+     */
+    void cache_velocities_norm2(Field norm2) noexcept {
+        m_velocities_norm2 = norm2;
+        m_norm2_time = m_time;
+    }
+
+    /**
+     * Initializes the radial distribution histogram, sampled at every step.
+     * @param n_bins Number of bins in the histogram.
+     */
+    void init_radial_func(size_t n_bins) { init_radial_sampling(n_bins); }
+
+    /**
+     * Enables the sampling of g(r) into a running histogram, closed with radial_block_average().
+     * When r_max does not exceed the cutoff the pairs are binned in the force loop, reusing the
+     * neighbor structures; otherwise sampled steps take an extra pass over every pair.
      * @param n_bins Number of bins in the histogram.
+     * @param stride g(r) is sampled every stride steps.
+     * @param r_max Reach of the histogram, half the box edge if zero.
+     */
+    void init_radial_sampling(size_t n_bins, size_t stride = 1, field r_max = field(0)) {
+        if (r_max <= field(0) || r_max > m_simulation.box_edge / field(2))
+            r_max = m_simulation.box_edge / field(2);
+        m_radial.emplace(n_bins, r_max, m_simulation.n_particles, m_thermo.density, stride);
+        m_radial_time = npos;
+        m_hist.assign(n_bins + 1, 0);
+        for (auto &sums: m_thread_sums) sums.hist.assign(n_bins + 1, 0);
+        m_g_r.reserve(n_bins);
+        m_drs = m_radial->rs();
+    }
+
+    /**
+     * Closes a block of g(r) samples.
+     * @param g_r Output: average g(r) of the configurations sampled since the last call.
+     */
+    void radial_block_average(std::vector<Field> &g_r) {
+        if (m_radial.has_value()) m_radial->block_average(g_r);
+        else
+            g_r.clear();
+    }
+
+    /**
+     * Enables the linked-cell neighbor search: interacting pairs are looked up only among particles
+     * lying in adjacent cells of edge >= cutoff, which makes a force evaluation O(N). The search is
+     * left disabled when the box is too small to hold at least three cells per side.
+     * @return Whether linked cells are in use.
+     */
+    bool init_linked_cells() {
+        CellList<field> cells(m_simulation.box_edge, m_simulation.cutoff);
+        if (cells.usable()) m_cells = std::move(cells);
+        else
+            m_cells.reset();
+        return m_cells.has_value();
+    }
+
+    /**
+     * Enables Verlet neighbor lists: the partners within cutoff + skin of each molecule are stored
+     * and reused until some molecule has moved by more than skin / 2. Takes precedence over linked
+     * cells, which are still used to build the list when the box is big enough.
+     * @param skin Width of the shell beyond the cutoff.
+     */
+    void init_neighbor_list(field skin) {
+        m_neighbors.emplace(m_simulation.box_edge, m_simulation.cutoff, skin);
+    }
+
+    /**
+     * Number of times the neighbor list has been (re)built, useful to tune the skin.
+     */
+    [[nodiscard]] size_t neighbor_list_rebuilds() const {
+        return m_neighbors.has_value() ? m_neighbors->rebuilds() : 0;
+    }
+
+    /**
+     * Replaces the pair interaction, e.g. to set the parameters of a Morse potential or to load a
+     * table. Its range must not exceed the simulation cutoff, which drives the neighbor search.
+     * @param potential Pair potential.
+     */
+    void init_potential(Potential potential) {
+        if (potential.cutoff2 > m_simulation.cutoff2)
+            throw std::runtime_error("The range of the potential exceeds the cutoff");
+        m_potential = std::move(potential);
+        m_u_tail = m_potential.template tail_energy<Field>(m_thermo.density);
+        m_W_tail = m_potential.template tail_virial<Field>(m_thermo.density,
+                                                           m_simulation.n_particles);
+    }
+
+    /**
+     * Rescales the box, the molecular positions and the cutoff by the same factor, as in a volume
+     * move of the isobaric ensemble. Density, tail corrections, pair potential and neighbor
+     * structures follow; the g(r) histogram keeps its bins and normalization.
+     * @param factor Ratio between the new and the old box edge.
+     */
+    void rescale(field factor) {
+        m_positions *= factor;
+        resize_box(m_simulation.cutoff * factor,
+                   m_thermo.density / (Field(factor) * Field(factor) * Field(factor)));
+    }
+
+    /**
+     * Stores or restores the dynamical state of the system (see CheckpointArchive): time,
+     * positions, previous positions, velocities, forces, the cached sums, the neighbor list and
+     * the g(r) block being accumulated, plus the box in the isobaric ensemble. The settings are
+     * not stored: a system built from the same settings, and with the same neighbor structures
+     * and g(r) sampling enabled, continues bit-identically once restored.
+     * @param archive A checkpoint writer or reader.
      */
-    void init_radial_func(size_t n_bins) {
-        m_n_bins = n_bins;
-        m_dr = m_simulation.box_edge / Field(2 * n_bins);
-        m_hist.resize(n_bins);
-        m_normcoeffs.resize(n_bins);
-        m_drs.resize(n_bins);
-        const Field k = static_cast<Field>(m_simulation.n_particles) * m_thermo.density;
-        Field r{0};
-        for (size_t bin = 0; bin < n_bins; bin++) {
-            Field dV_r = (4 * M_PI / 3) * (std::pow(r + m_dr, 3) - std::pow(r, 3));
-            m_normcoeffs[bin] = Field(1) / (k * dV_r);
-            m_drs[bin] = r;
-            r += m_dr;
+    template<class Archive>
+    void checkpoint(Archive &archive) {
+        archive.section("LJMono");
+        archive.expect(m_simulation.n_particles, "number of particles");
+        auto cutoff = m_simulation.cutoff;
+        auto density = m_thermo.density;
+        archive(cutoff, density);
+        if constexpr (Archive::loading) {
+            if (cutoff != m_simulation.cutoff || density != m_thermo.density) {
+                if constexpr (ens == NPT) resize_box(cutoff, density);
+                else
+                    throw std::runtime_error("Checkpoint mismatch: the box differs");
+            }
         }
+        archive(m_time, m_positions, m_prev_positions, m_velocities, m_forces);
+        archive(m_velocities_norm2, m_norm2_time, m_e_pot_sum, m_virial_sum, m_sums_time,
+                m_forces_time);
+        archive.expect(m_neighbors.has_value(), "neighbor list");
+        if (m_neighbors.has_value()) archive(*m_neighbors);
+        archive.expect(m_radial.has_value(), "g(r) sampling");
+        if (m_radial.has_value()) archive(*m_radial, m_radial_time);
+    }
+
+    /**
+     * Splits the evaluation of forces and observables among several threads. Each thread
+     * accumulates on its own buffers, which are then reduced in a fixed order: results do not
+     * depend on scheduling and differ between thread counts only by rounding.
+     * @param n_threads Number of threads (1 disables threading).
+     */
+    void init_threads(size_t n_threads) {
+        m_n_threads = std::max(size_t(1), n_threads);
+        m_thread_sums.clear();
+        if (m_n_threads > 1)
+            m_thread_sums.resize(m_n_threads, PairSums{Vectors<field>(m_simulation.n_particles),
+                                                       Field(0), Field(0), m_hist});
+    }
+
+    /**
+     * Computes the forces acting on the molecules at the current time step. The potential energy
+     * and virial sums are kept, so that the measures at the same time step (which must not be
+     * preceded by other changes to the positions) need no further pass over the pairs.
+     * @tparam sample_radial Whether a due g(r) sample may be taken along: configurations which are
+     * not part of the sampled chain (e.g. inside a hybrid Monte Carlo trajectory) must not.
+     */
+    template<bool sample_radial = true>
+    void compute_forces() {
+        Field e_pot_{0}, virial_{0};
+        m_sums_time = npos;
+        if constexpr (sample_radial)
+            sample_pairs<true, false>(e_pot_, virial_);
+        else
+            pair_sums<true, false>(e_pot_, virial_);
+        cache_forces(e_pot_, virial_);
+    }
+
+    // Whether compute_forces() has been called at the current time step
+    [[nodiscard]] bool forces_computed() const noexcept { return m_forces_time == m_time; }
+
+    /**
+     * Stores the potential energy and virial sums (without tail corrections) at the current time
+     * step, as kept up to date by a stepper: measures then need no pass over the pairs, unless
+     * forces or g(r) are due.
+     * @param e_pot Sum of the pair potentials.
+     * @param virial Sum of the pair virials.
+     */
+    void cache_pair_sums(Field e_pot, Field virial) noexcept {
+        m_e_pot_sum = e_pot;
+        m_virial_sum = virial;
+        m_sums_time = m_time;
     }
 
+    /**
+     * As cache_pair_sums, when the forces stored in m_forces are also up to date at the current
+     * time step: a following compute_forces() or measures<true> does not recompute them.
+     * @param e_pot Sum of the pair potentials.
+     * @param virial Sum of the pair virials.
+     */
+    void cache_forces(Field e_pot, Field virial) noexcept {
+        cache_pair_sums(e_pot, virial);
+        m_forces_time = m_time;
+    }
+
+    /**
+     * Retrieves the cached potential energy and virial sums (without tail corrections). Meaningful
+     * only if they were cached at the current time step, see sums_computed().
+     * @param e_pot Sum of the pair potentials.
+     * @param virial Sum of the pair virials.
+     */
+    void cached_pair_sums(Field &e_pot, Field &virial) const noexcept {
+        e_pot = m_e_pot_sum;
+        virial = m_virial_sum;
+    }
+
+    // Whether the pair sums have been cached at the current time step
+    [[nodiscard]] bool sums_computed() const noexcept { return m_sums_time == m_time; }
+
     /**
      * Measures thermodynamical variables at the current time step and computes the forces acting on the molecules
      */
     void measures(Field &potential_energy, Field &kinetic_energy, Field &total_energy,
                   Field &temperature, Field &pressure) {
-        field e_pot_{0}, virial_{0};
-        std::fill(std::begin(m_forces.e_i), std::end(m_forces.e_i), field(0));
-        std::fill(std::begin(m_forces.e_j), std::end(m_forces.e_j), field(0));
-        std::fill(std::begin(m_forces.e_k), std::end(m_forces.e_k), field(0));
-        for (size_t particle = 0UL; particle + 1 < m_simulation.n_particles; particle++) {
-            for (size_t other = particle + 1; other < m_simulation.n_particles; other++) {
-                // r_po
-                const auto dxij = pbc(m_positions.e_i[particle] - m_positions.e_i[other]);
-                const auto dyij = pbc(m_positions.e_j[particle] - m_positions.e_j[other]);
-                const auto dzij = pbc(m_positions.e_k[particle] - m_positions.e_k[other]);
-                const auto drij2 = dxij * dxij + dyij * dyij + dzij * dzij;
-                if (drij2 < m_simulation.cutoff2) {
-                    // Computing the addends of both the potential and the virial
-                    const auto lj1 = field(1) / std::pow(drij2, 6);
-                    const auto lj2 = field(1) / std::pow(drij2, 3);
-                    const auto wij = lj1 - lj2 / field(2);
-                    // Updating both particles
-                    // Force acted on "particle" by "other"
-                    const auto fxij = wij * dxij / drij2;
-                    const auto fyij = wij * dyij / drij2;
-                    const auto fzij = wij * dzij / drij2;
-                    m_forces.e_i[particle] += fxij;
-                    m_forces.e_j[particle] += fyij;
-                    m_forces.e_k[particle] += fzij;
-                    // Force acted on "other" by "particle"
-                    m_forces.e_i[other] -= fxij;
-                    m_forces.e_j[other] -= fyij;
-                    m_forces.e_k[other] -= fzij;
-                    e_pot_ += (lj1 - lj2);
-                    virial_ += wij;
-                }
-            }
-        }
-        m_forces *= field(48);
-        e_pot_ = 4 * e_pot_ / field(m_simulation.n_particles);
-        virial_ *= field(48) / field(3);
+        Field e_pot_{0}, virial_{0};
+        sample_pairs<true, false>(e_pot_, virial_);
+        e_pot_ /= Field(m_simulation.n_particles);
+        virial_ /= Field(3);
         if constexpr (tail_corrections) {
-            e_pot_ += m_simulation.u_tail_correction;
-            virial_ += m_simulation.W_tail_correction;
+            e_pot_ += m_u_tail;
+            virial_ += m_W_tail;
         }
         potential_energy = e_pot_;
-        if constexpr (ens == NVT) kinetic_energy = field(1.5) * m_thermo.temperature;
+        if constexpr (ens != NVE) kinetic_energy = Field(1.5) * m_thermo.temperature;
         else
-            kinetic_energy = m_velocities.full_norm2() / field(2 * m_simulation.n_particles);
+            kinetic_energy = velocities_norm2() / Field(2 * m_simulation.n_particles);
         total_energy = potential_energy + kinetic_energy;
-        if constexpr (ens == NVT) temperature = m_thermo.temperature;
+        if constexpr (ens != NVE) temperature = m_thermo.temperature;
         else
-            temperature = 2 * kinetic_energy / field(3);
-        pressure = m_thermo.density * temperature + virial_ / m_simulation.volume;
+            temperature = 2 * kinetic_energy / Field(3);
+        pressure = m_thermo.density * temperature + virial_ / volume();
     }
 
     /**
      * Measures thermodynamical variables at the current time step and computes the forces acting on the molecules
      * @tparam compute_forces Whether forces should be updated.
      * @tparam vars Variables which will be computed.
-     * @param output MeasureOutputs struct to store a compile-time defined number of variables.
+     * @tparam Outputs MeasureOutputs, storing the series, or OnlineMeasures, accumulating it.
+     * @param output Struct storing a compile-time defined number of variables.
      */
-    template<bool compute_forces, Variable... vars>
-    constexpr void measures(MeasureOutputs<field, vars...> &output) {
-        using Outs = MeasureOutputs<field, vars...>;
+    template<bool compute_forces, template<typename, Variable...> class Outputs, Variable... vars>
+    constexpr void measures(Outputs<Field, vars...> &output) {
+        using Outs = Outputs<Field, vars...>;
         constexpr const bool compute_radial = Outs::template has_member<Variable::RadialFn>();
-        field e_pot_{0}, virial_{0};
-        if constexpr (compute_radial) { std::fill(m_hist.begin(), m_hist.end(), size_t(0)); }
-        if constexpr (compute_forces) {
-            std::fill(std::begin(m_forces.e_i), std::end(m_forces.e_i), field(0));
-            std::fill(std::begin(m_forces.e_j), std::end(m_forces.e_j), field(0));
-            std::fill(std::begin(m_forces.e_k), std::end(m_forces.e_k), field(0));
-        }
-        for (size_t particle = 0UL; particle + 1 < m_simulation.n_particles; particle++) {
-            for (size_t other = particle + 1; other < m_simulation.n_particles; other++) {
-                // r_po
-                const auto dxij = pbc(m_positions.e_i[particle] - m_positions.e_i[other]);
-                const auto dyij = pbc(m_positions.e_j[particle] - m_positions.e_j[other]);
-                const auto dzij = pbc(m_positions.e_k[particle] - m_positions.e_k[other]);
-                const auto drij2 = dxij * dxij + dyij * dyij + dzij * dzij;
-                if (drij2 < m_simulation.cutoff2) {
-                    // Computing the addends of both the potential and the virial
-                    const auto lj1 = field(1) / std::pow(drij2, 6);
-                    const auto lj2 = field(1) / std::pow(drij2, 3);
-                    const auto wij = lj1 - lj2 / field(2);
-                    e_pot_ += (lj1 - lj2);
-                    virial_ += wij;
-                    if constexpr (compute_forces) {
-                        // Updating both particles
-                        // Force acted on "particle" by "other"
-                        const auto fxij = wij * dxij / drij2;
-                        const auto fyij = wij * dyij / drij2;
-                        const auto fzij = wij * dzij / drij2;
-                        m_forces.e_i[particle] += fxij;
-                        m_forces.e_j[particle] += fyij;
-                        m_forces.e_k[particle] += fzij;
-                        // Force acted on "other" by "particle"
-                        m_forces.e_i[other] -= fxij;
-                        m_forces.e_j[other] -= fyij;
-                        m_forces.e_k[other] -= fzij;
-                    }
-                }
-                if constexpr (compute_radial) {
-                    const auto bin = size_t(std::trunc(std::sqrt(drij2) / m_dr));
-                    if (bin < m_n_bins) m_hist[bin] += 2;
-                }
-            }
-        }
-        if constexpr (compute_forces) m_forces *= field(48);
-        e_pot_ = 4 * e_pot_ / field(m_simulation.n_particles);
-        virial_ *= (field(48) / field(3));
+        Field e_pot_{0}, virial_{0};
+        sample_pairs<compute_forces, compute_radial>(e_pot_, virial_);
+        e_pot_ /= Field(m_simulation.n_particles);
+        virial_ /= Field(3);
         if constexpr (tail_corrections) {
-            e_pot_ += m_simulation.u_tail_correction;
-            virial_ += m_simulation.W_tail_correction;
+            e_pot_ += m_u_tail;
+            virial_ += m_W_tail;
         }
 
         output.template push_measure<Variable::PotentialEnergy>(e_pot_);
 
-        field e_kin;
-        if constexpr (ens == NVT) e_kin = field(1.5) * m_thermo.temperature;
+        Field e_kin;
+        if constexpr (ens != NVE) e_kin = Field(1.5) * m_thermo.temperature;
         else
-            e_kin = m_velocities.full_norm2() / field(2 * m_simulation.n_particles);
+            e_kin = velocities_norm2() / Field(2 * m_simulation.n_particles);
         output.template push_measure<Variable::KineticEnergy>(e_kin);
 
         const auto e_tot = e_pot_ + e_kin;
         output.template push_measure<Variable::TotalEnergy>(e_tot);
 
-        field temperature;
-        if constexpr (ens == NVT) temperature = m_thermo.temperature;
+        Field temperature;
+        if constexpr (ens != NVE) temperature = m_thermo.temperature;
         else
-            temperature = 2 * e_kin / field(3);
+            temperature = 2 * e_kin / Field(3);
         output.template push_measure<Variable::Temperature>(temperature);
 
         output.template push_measure<Variable::Pressure>(m_thermo.density * temperature +
-                                                         virial_ / m_simulation.volume);
+                                                         virial_ / volume());
 
         if constexpr (compute_radial) {
-            output.template init_vector<Variable::RadialFn>(m_n_bins);
-            std::vector<field> g_r(m_hist.size());
-            std::transform(m_hist.begin(), m_hist.end(), m_normcoeffs.begin(), g_r.begin(),
-                           [](const auto bin, const auto norm) { return field(bin) * norm; });
-            output.template push_vector<Variable::RadialFn>(g_r);
+            if (m_radial.has_value()) m_radial->normalize(m_hist, 1, m_g_r);
+            output.template init_vector<Variable::RadialFn>(m_g_r.size());
+            output.template push_vector<Variable::RadialFn>(m_g_r);
         }
     }
 
 
     // Thermodynamical configuration: initial temperature and density
-    ThermoSettings<field> m_thermo;
+    ThermoSettings<Field> m_thermo;
     // Simulation settings: number of particles, box edge, periodic volume, ...
     SimulationSettings<field> m_simulation;
     // Molecular positions at the current time step
@@ -350,19 +491,272 @@ public:
     Vectors<field> m_velocities{0};
     // Molecular positions at the previous time step
     Vectors<field> m_prev_positions{0};
-
-    std::vector<field> m_drs{0};
+    // Buffer for the molecular positions at the next time step, rotated by the integrators
+    Vectors<field> m_next_positions{0};
+
+    std::vector<Field> m_drs{0};
+    // Linked cells used for the neighbor search, if enabled
+    std::optional<CellList<field>> m_cells{};
+    // Verlet neighbor list, if enabled
+    std::optional<NeighborList<field>> m_neighbors{};
+    // Running g(r) histogram, if enabled
+    std::optional<RadialHistogram<field, Field>> m_radial{};
+    // Pair interaction
+    Potential m_potential{default_potential(m_simulation.cutoff)};
 
 private:
+    /**
+     * Resizes the box to the given cutoff and density: settings, tail corrections, pair potential
+     * and neighbor structures follow, cached sums are dropped. Positions are left as they are.
+     */
+    void resize_box(field cutoff, Field density) {
+        static_assert(std::is_constructible_v<Potential, field>,
+                      "The pair potential must be built from the cutoff alone");
+        m_thermo.density = density;
+        m_simulation = SimulationSettings<field>(m_simulation.n_particles, m_simulation.n_blocks,
+                                                 m_simulation.block_size, cutoff,
+                                                 m_simulation.delta, field(m_thermo.density));
+        init_potential(Potential(m_simulation.cutoff));
+        if (m_cells.has_value()) init_linked_cells();
+        if (m_neighbors.has_value()) init_neighbor_list(m_neighbors->skin());
+        m_sums_time = npos;
+        m_forces_time = npos;
+    }
+
+    /**
+     * Potential built from the cutoff alone, or default-constructed when it takes no cutoff.
+     */
+    static Potential default_potential(field cutoff) {
+        if constexpr (std::is_constructible_v<Potential, field>) {
+            return Potential(cutoff);
+        } else {
+            return Potential();
+        }
+    }
+
+    // Per-thread accumulators of the pair sums
+    struct PairSums {
+        Vectors<field> forces;
+        Field potential{0}, virial{0};
+        std::vector<size_t> hist{};
+    };
+
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    // Squared norm of the velocities, cached if up to date
+    [[nodiscard]] Field velocities_norm2() const {
+        if (m_norm2_time == m_time) return m_velocities_norm2;
+        return m_velocities.template full_norm2<Field>();
+    }
+
+    // Periodic volume, in the precision of the measured variables
+    [[nodiscard]] inline Field volume() const noexcept {
+        return Field(m_simulation.n_particles) / m_thermo.density;
+    }
+
+    /**
+     * Prepares the neighbor structures (if any) for the current positions.
+     * @tparam all_pairs Whether every pair will be visited regardless of the neighbor structures.
+     */
+    template<bool all_pairs = false>
+    void prepare_pairs() {
+        if (all_pairs) return;
+        if (m_neighbors.has_value()) m_neighbors->update(m_positions);
+        else if (m_cells.has_value())
+            m_cells->build(m_positions);
+    }
+
+    /**
+     * Calls f(particle, other) once for every pair of molecules which may interact: all of them, or
+     * only those stored in the neighbor list or lying in adjacent cells when these are enabled.
+     * The work is split in interleaved slices: only slice "first" out of "stride" is processed.
+     * @tparam all_pairs Whether every pair must be visited regardless of the neighbor structures.
+     * @param f Pair action.
+     * @param first Index of the slice.
+     * @param stride Number of slices.
+     */
+    template<bool all_pairs = false, class PairFn>
+    void for_each_pair(PairFn f, size_t first = 0, size_t stride = 1) const {
+        if (!all_pairs && m_neighbors.has_value()) {
+            m_neighbors->for_each_pair(f, first, stride);
+            return;
+        }
+        if (!all_pairs && m_cells.has_value()) {
+            m_cells->for_each_pair(f, first, stride);
+            return;
+        }
+        for (size_t particle = first; particle + 1 < m_simulation.n_particles; particle += stride) {
+            for (size_t other = particle + 1; other < m_simulation.n_particles; other++) {
+                f(particle, other);
+            }
+        }
+    }
+
+    /**
+     * Accumulates the pair sums of a slice of the pairs: potential, virial, forces and the g(r)
+     * histogram. Pairs are gathered in fixed-size batches and handed to the potential policy.
+     */
+    template<bool compute_forces, bool compute_radial>
+    void accumulate_pairs(Vectors<field> &forces, Field &e_pot_, Field &virial_,
+                          std::vector<size_t> &hist, size_t first, size_t stride) const {
+        molecular_systems::potentials::PairBatch<field> batch;
+        const auto flush = [&]() {
+            batch.compute(m_potential, m_simulation.box_edge, e_pot_, virial_);
+            for (size_t k = 0; k < batch.n; k++) {
+                if constexpr (compute_forces) {
+                    const auto particle = batch.first[k], other = batch.second[k];
+                    // Force acted on "particle" by "other"
+                    const auto fxij = batch.factors[k] * batch.dx[k];
+                    const auto fyij = batch.factors[k] * batch.dy[k];
+                    const auto fzij = batch.factors[k] * batch.dz[k];
+                    forces.e_i[particle] += fxij;
+                    forces.e_j[particle] += fyij;
+                    forces.e_k[particle] += fzij;
+                    // Force acted on "other" by "particle"
+                    forces.e_i[other] -= fxij;
+                    forces.e_j[other] -= fyij;
+                    forces.e_k[other] -= fzij;
+                }
+                if constexpr (compute_radial) {
+                    const auto drij2 = batch.dx[k] * batch.dx[k] + batch.dy[k] * batch.dy[k] +
+                                       batch.dz[k] * batch.dz[k];
+                    hist[m_radial->bin(drij2)] += 2;
+                }
+            }
+            batch.clear();
+        };
+        for_each_pair(
+                [&](const size_t particle, const size_t other) {
+                    // r_po, before the minimum image
+                    batch.push(particle, other, m_positions.e_i[particle] - m_positions.e_i[other],
+                               m_positions.e_j[particle] - m_positions.e_j[other],
+                               m_positions.e_k[particle] - m_positions.e_k[other]);
+                    if (batch.full()) flush();
+                },
+                first, stride);
+        flush();
+    }
+
+    /**
+     * Bins every pair of a slice of the molecules, regardless of the neighbor structures.
+     */
+    void bin_pairs(std::vector<size_t> &hist, size_t first, size_t stride) const {
+        for_each_pair<true>(
+                [&](const size_t particle, const size_t other) {
+                    const auto dx = pbc(m_positions.e_i[particle] - m_positions.e_i[other]);
+                    const auto dy = pbc(m_positions.e_j[particle] - m_positions.e_j[other]);
+                    const auto dz = pbc(m_positions.e_k[particle] - m_positions.e_k[other]);
+                    hist[m_radial->bin(dx * dx + dy * dy + dz * dz)] += 2;
+                },
+                first, stride);
+    }
+
+    /**
+     * Pair sums of a slice, binning g(r) in the same pass if fused, in a separate one otherwise.
+     */
+    template<bool compute_forces, bool compute_radial>
+    void accumulate_slice(bool fused, Vectors<field> &forces, Field &e_pot_, Field &virial_,
+                          std::vector<size_t> &hist, size_t first, size_t stride) const {
+        if constexpr (compute_radial) {
+            if (!fused) {
+                accumulate_pairs<compute_forces, false>(forces, e_pot_, virial_, hist, first,
+                                                        stride);
+                bin_pairs(hist, first, stride);
+                return;
+            }
+        }
+        accumulate_pairs<compute_forces, compute_radial>(forces, e_pot_, virial_, hist, first,
+                                                         stride);
+    }
+
+    /**
+     * Computes the pair sums over every interacting pair, resetting forces and g(r) histogram.
+     * @param e_pot_ Potential energy sum.
+     * @param virial_ Virial sum.
+     */
+    template<bool compute_forces, bool compute_radial>
+    void pair_sums(Field &e_pot_, Field &virial_) {
+        if constexpr (compute_radial) { std::fill(m_hist.begin(), m_hist.end(), size_t(0)); }
+        if constexpr (compute_forces) {
+            std::fill(std::begin(m_forces.e_i), std::end(m_forces.e_i), field(0));
+            std::fill(std::begin(m_forces.e_j), std::end(m_forces.e_j), field(0));
+            std::fill(std::begin(m_forces.e_k), std::end(m_forces.e_k), field(0));
+        }
+        prepare_pairs();
+        // The visited pairs contain every pair within the reach of the histogram
+        const bool fused = compute_radial && (m_radial->within(m_simulation.cutoff) ||
+                                              (!m_neighbors.has_value() && !m_cells.has_value()));
+        if (m_n_threads == 1) {
+            accumulate_slice<compute_forces, compute_radial>(fused, m_forces, e_pot_, virial_,
+                                                             m_hist, 0, 1);
+            return;
+        }
+        utils::parallel_for(m_n_threads, [&](size_t thread) {
+            auto &sums = m_thread_sums[thread];
+            sums.potential = 0;
+            sums.virial = 0;
+            if constexpr (compute_radial) std::fill(sums.hist.begin(), sums.hist.end(), size_t(0));
+            if constexpr (compute_forces) sums.forces.apply([](auto &f) { f = field(0); });
+            accumulate_slice<compute_forces, compute_radial>(fused, sums.forces, sums.potential,
+                                                             sums.virial, sums.hist, thread,
+                                                             m_n_threads);
+        });
+        // Reduction in a fixed order
+        for (const auto &sums: m_thread_sums) {
+            e_pot_ += sums.potential;
+            virial_ += sums.virial;
+            if constexpr (compute_forces) m_forces += sums.forces;
+            if constexpr (compute_radial)
+                std::transform(m_hist.begin(), m_hist.end(), sums.hist.begin(), m_hist.begin(),
+                               std::plus<>());
+        }
+    }
+
+    /**
+     * Pair sums of the current step. The g(r) histogram is filled when it is due for sampling, or
+     * when requested for output, and only then.
+     * @tparam output_radial Whether the g(r) of this step is needed for output.
+     */
+    template<bool compute_forces, bool output_radial>
+    void sample_pairs(Field &e_pot_, Field &virial_) {
+        // A configuration is pushed into the g(r) block once, however many times it is measured
+        const bool due = m_radial.has_value() && m_radial->due(m_time) && m_radial_time != m_time;
+        if (m_sums_time == m_time && (!compute_forces || m_forces_time == m_time)) {
+            // Sums (and forces, if needed) are already up to date, see cache_pair_sums()
+            e_pot_ = m_e_pot_sum;
+            virial_ = m_virial_sum;
+            if (m_radial.has_value() && (output_radial || due)) {
+                Field e_pot_unused{0}, virial_unused{0};
+                pair_sums<false, true>(e_pot_unused, virial_unused);
+            }
+        } else if (m_radial.has_value() && (output_radial || due)) {
+            pair_sums<compute_forces, true>(e_pot_, virial_);
+        } else {
+            pair_sums<compute_forces, false>(e_pot_, virial_);
+        }
+        if (due) {
+            m_radial->push(m_hist);
+            m_radial_time = m_time;
+        }
+    }
+
+    // Tail corrections, in the precision of the measured variables
+    Field m_u_tail, m_W_tail;
     size_t m_time{0};
-    // Constants in the computation of g(r)
-    // Number of bins
-    size_t m_n_bins{0};
-    std::vector<size_t> m_hist{0};
-    // dr
-    Field m_dr{0};
-    // normalization coefficients: 1/(rho*N*dV)
-    std::vector<Field> m_normcoeffs{};
+    // Squared norm of the velocities and the time step it refers to
+    Field m_velocities_norm2{0};
+    size_t m_norm2_time{npos};
+    // Cached pair sums and the time step they refer to
+    Field m_e_pot_sum{0}, m_virial_sum{0};
+    size_t m_sums_time{npos};
+    // Time steps of the last forces computed by compute_forces() and of the last g(r) sample
+    size_t m_forces_time{npos}, m_radial_time{npos};
+    // g(r) counts of the current configuration (overflow bin included) and normalized g(r)
+    std::vector<size_t> m_hist{};
+    std::vector<Field> m_g_r{};
+    // Number of threads used in the evaluation of pair sums
+    size_t m_n_threads{1};
+    std::vector<PairSums> m_thread_sums{};
 };
 
 
@@ -14,9 +14,11 @@
 #include <tuple>
 #include <type_traits>
 #include <valarray>
+#include <vector>
 
 #include "models/ising/1D/ising.hpp"
 #include "transitions/transition.hpp"
+#include "samplers/MCMC/tuning.hpp"
 
 using namespace ising;
 
@@ -113,6 +115,33 @@ namespace samplers::mcmc {
             for (size_t i = 0; i < steps; i++) { step(rng); }
         }
 
+        /**
+         * Warmup which adapts the transition width block by block toward a target acceptance rate
+         * (see tuned_width). The chain is not stationary while the width changes, so tuning is
+         * meant for warmup only: the last width is then kept fixed, so that the following samples
+         * obey detailed balance. Steps taken here do not count in the acceptance rate.
+         * @param n_blocks Number of warmup blocks.
+         * @param block_size Number of steps in a block.
+         * @param rng Random number generator.
+         * @param target Target acceptance rate.
+         * @return Width and acceptance rate of each block.
+         */
+        template<class URBG>
+        auto tune(size_t n_blocks, size_t block_size, URBG &rng, double target = 0.5) {
+            using Width = decltype(m_q.width());
+            std::vector<TuningBlock<Width>> blocks;
+            blocks.reserve(n_blocks);
+            for (size_t block = 0; block < n_blocks; block++) {
+                size_t accepted = 0;
+                for (size_t i = 0; i < block_size; i++)
+                    if (std::get<0>(step(rng))) accepted++;
+                const auto acceptance_rate = double(accepted) / double(block_size);
+                blocks.push_back({m_q.width(), acceptance_rate});
+                m_q.set_width(tuned_width(m_q.width(), acceptance_rate, target));
+            }
+            return blocks;
+        }
+
         /**
          * Performs a number of MC steps and stores the result.
          * @param first Beginning of output.
@@ -0,0 +1,58 @@
+#ifndef ESERCIZI_LSN_MCMC_TUNING_HPP
+#define ESERCIZI_LSN_MCMC_TUNING_HPP
+
+#include <algorithm>
+#include <filesystem>
+#include <vector>
+
+#include <rapidcsv.h>
+
+namespace fs = std::filesystem;
+
+namespace samplers::mcmc {
+    /**
+     * Proposal width used in a warmup block, and the acceptance rate it gave.
+     * @tparam real Numeric field of the width.
+     */
+    template<typename real>
+    struct TuningBlock {
+        real width;
+        double acceptance_rate;
+    };
+
+    /**
+     * Proposal width for the next warmup block: the acceptance rate decreases with the width, which
+     * is scaled by the ratio between the measured and the target acceptance rates. The scaling is
+     * bounded to [1/2, 2] per block, so that a block with no accepted moves does not collapse it.
+     * @param width Current proposal width.
+     * @param acceptance_rate Acceptance rate measured with the current width.
+     * @param target Target acceptance rate.
+     * @return Next proposal width.
+     */
+    template<typename real>
+    inline real tuned_width(real width, double acceptance_rate, double target) {
+        return width * real(std::clamp(acceptance_rate / target, 0.5, 2.0));
+    }
+
+    /**
+     * Stores the widths and acceptance rates of the warmup blocks as a csv table.
+     * @param blocks Warmup blocks.
+     * @param path Output path.
+     */
+    template<typename real>
+    void save_tuning(const std::vector<TuningBlock<real>> &blocks, const fs::path &path) {
+        std::vector<real> widths(blocks.size());
+        std::vector<double> acceptance_rates(blocks.size());
+        std::transform(blocks.cbegin(), blocks.cend(), widths.begin(),
+                       [](const auto &block) { return block.width; });
+        std::transform(blocks.cbegin(), blocks.cend(), acceptance_rates.begin(),
+                       [](const auto &block) { return block.acceptance_rate; });
+        rapidcsv::Document table;
+        table.InsertColumn(0, widths, "width");
+        table.InsertColumn(1, acceptance_rates, "acceptance");
+        table.RemoveColumn(table.GetColumnCount() - 1);
+        table.Save(path.string());
+    }
+}// namespace samplers::mcmc
+
+#endif//ESERCIZI_LSN_MCMC_TUNING_HPP
@@ -0,0 +1,445 @@
+#ifndef ESERCIZI_LSN_TABLES_HPP
+#define ESERCIZI_LSN_TABLES_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <rapidcsv.h>
+
+#include "mapped_table.hpp"
+
+namespace fs = std::filesystem;
+
+namespace tables {
+    /**
+     * File format of the measurement tables.
+     * Csv: text, one column per variable, parsed back with pandas.read_csv.
+     * Npz: NumPy archive with one .npy array per column, loaded with numpy.load.
+     */
+    enum class Format { Csv, Npz };
+
+    /**
+     * Parses the value of a --format option.
+     * @param name "csv" or "npz".
+     */
+    inline Format format_from(std::string_view name) {
+        if (name == "csv") return Format::Csv;
+        if (name == "npz") return Format::Npz;
+        throw std::runtime_error("Unknown table format " + std::string(name) + " (csv or npz)");
+    }
+
+    // File extension of a format
+    inline std::string extension(Format format) { return format == Format::Csv ? ".csv" : ".npz"; }
+
+    namespace npy {
+        inline bool little_endian() {
+            const uint16_t one = 1;
+            uint8_t first;
+            std::memcpy(&first, &one, 1);
+            return first == 1;
+        }
+
+        /**
+         * NumPy type descriptor of an arithmetic type, e.g. "<f8" for a little-endian double.
+         */
+        template<typename T>
+        std::string descr() {
+            static_assert(std::is_arithmetic_v<T>, "Only arithmetic columns can be stored");
+            if constexpr (std::is_same_v<T, bool>) return "|b1";
+            const char kind = std::is_floating_point_v<T> ? 'f' : std::is_signed_v<T> ? 'i' : 'u';
+            const char order = sizeof(T) == 1 ? '|' : little_endian() ? '<' : '>';
+            return std::string{order, kind} + std::to_string(sizeof(T));
+        }
+
+        /**
+         * Header of a one-dimensional .npy array (format version 1.0), padded so that the data is
+         * 64-byte aligned.
+         * @param descr Type descriptor.
+         * @param size Number of entries.
+         */
+        inline std::string header(const std::string &descr, size_t size) {
+            std::string dict = "{'descr': '" + descr + "', 'fortran_order': False, 'shape': (" +
+                               std::to_string(size) + ",), }";
+            const size_t preamble = 10;
+            dict.append(63 - (preamble + dict.size()) % 64, ' ');
+            dict.push_back('\n');
+            const auto length = static_cast<uint16_t>(dict.size());
+            std::string out("\x93NUMPY\x01\x00", 8);
+            out.push_back(static_cast<char>(length & 0xFF));
+            out.push_back(static_cast<char>(length >> 8));
+            return out + dict;
+        }
+
+        inline uint32_t crc32(uint32_t crc, const char *data, size_t size) {
+            static const auto table = []() {
+                std::array<uint32_t, 256> t{};
+                for (uint32_t n = 0; n < 256; n++) {
+                    uint32_t c = n;
+                    for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+                    t[n] = c;
+                }
+                return t;
+            }();
+            crc = ~crc;
+            for (size_t i = 0; i < size; i++)
+                crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+            return ~crc;
+        }
+
+        // Little-endian integers of the zip records
+        template<typename uint>
+        void put(std::string &out, uint value) {
+            for (size_t byte = 0; byte < sizeof(uint); byte++)
+                out.push_back(static_cast<char>((value >> (8 * byte)) & 0xFF));
+        }
+
+        template<typename uint>
+        uint get(const char *in) {
+            uint value = 0;
+            for (size_t byte = 0; byte < sizeof(uint); byte++)
+                value = static_cast<uint>(value | uint(uint8_t(in[byte])) << (8 * byte));
+            return value;
+        }
+
+        /**
+         * Converts the entries of a column stored with the given descriptor.
+         * @param descr Type descriptor, in native byte order.
+         * @param data First entry, not necessarily aligned.
+         * @param first Index of the first converted entry.
+         * @param size Number of entries.
+         */
+        template<typename T>
+        std::vector<T> convert(const std::string &descr, const char *data, size_t first,
+                               size_t size) {
+            std::vector<T> out;
+            const auto read = [&](auto entry) {
+                using E = decltype(entry);
+                if (descr != npy::descr<E>()) return false;
+                out.resize(size - first);
+                for (size_t i = first; i < size; i++) {
+                    std::memcpy(&entry, data + i * sizeof(E), sizeof(E));
+                    out[i - first] = static_cast<T>(entry);
+                }
+                return true;
+            };
+            if (read(double{}) || read(float{}) || read(int64_t{}) || read(int32_t{}) ||
+                read(uint64_t{}) || read(uint32_t{}) || read(uint8_t{}))
+                return out;
+            throw std::runtime_error("Unsupported column type " + descr);
+        }
+    }// namespace npy
+
+    /**
+     * Stores a column as a .npy file.
+     * @param path Output path.
+     * @param column Entries of the column.
+     */
+    template<typename T>
+    void save_npy(const fs::path &path, const std::vector<T> &column) {
+        static_assert(!std::is_same_v<T, bool>, "Store flags as uint8_t");
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) throw std::runtime_error("Could not open " + path.string());
+        const auto header = npy::header(npy::descr<T>(), column.size());
+        file.write(header.data(), static_cast<std::streamsize>(header.size()));
+        file.write(reinterpret_cast<const char *>(column.data()),
+                   static_cast<std::streamsize>(column.size() * sizeof(T)));
+        if (!file) throw std::runtime_error("Could not write " + path.string());
+    }
+
+    /**
+     * Writes a NumPy .npz archive (an uncompressed zip of .npy arrays) one column at a time: each
+     * column is written as soon as it is added, and only the zip directory is kept in memory.
+     * numpy.load(path)[name] gives back a column.
+     */
+    class NpzWriter {
+    public:
+        NpzWriter(const NpzWriter &) = delete;
+
+        explicit NpzWriter(const fs::path &path)
+            : m_path(path), m_file(path, std::ios::binary | std::ios::trunc) {
+            if (!m_file.is_open()) throw std::runtime_error("Could not open " + path.string());
+        }
+
+        ~NpzWriter() {
+            try {
+                close();
+            } catch (...) {}
+        }
+
+        /**
+         * Appends a column.
+         * @param name Name of the column.
+         * @param column Entries of the column.
+         */
+        template<typename T>
+        void add(const std::string &name, const std::vector<T> &column) {
+            static_assert(!std::is_same_v<T, bool>, "Store flags as uint8_t");
+            if (m_closed) throw std::runtime_error(m_path.string() + " is already closed");
+            const auto header = npy::header(npy::descr<T>(), column.size());
+            const auto *data = reinterpret_cast<const char *>(column.data());
+            const auto data_size = column.size() * sizeof(T);
+            const auto size = header.size() + data_size;
+            if (size > 0xFFFFFFFFU || m_offset + size > 0xFFFFFFFFU)
+                throw std::runtime_error("Columns beyond 4 GiB need zip64, which is not supported");
+            Entry entry{name + ".npy", 0, static_cast<uint32_t>(size),
+                        static_cast<uint32_t>(m_offset)};
+            entry.crc = npy::crc32(npy::crc32(0, header.data(), header.size()), data, data_size);
+            std::string record;
+            npy::put<uint32_t>(record, 0x04034b50U);
+            common_fields(record, entry);
+            record.append(entry.name);
+            write(record);
+            write(header);
+            m_file.write(data, static_cast<std::streamsize>(data_size));
+            m_offset += data_size;
+            m_entries.push_back(std::move(entry));
+            if (!m_file) throw std::runtime_error("Could not write " + m_path.string());
+        }
+
+        /**
+         * Writes the zip directory. Called by the destructor, if not before.
+         */
+        void close() {
+            if (m_closed) return;
+            m_closed = true;
+            const auto directory_offset = m_offset;
+            for (const auto &entry: m_entries) {
+                std::string record;
+                npy::put<uint32_t>(record, 0x02014b50U);
+                // Version made by
+                npy::put<uint16_t>(record, 20);
+                common_fields(record, entry);
+                // Comment length, disk, internal and external attributes
+                npy::put<uint16_t>(record, 0);
+                npy::put<uint16_t>(record, 0);
+                npy::put<uint16_t>(record, 0);
+                npy::put<uint32_t>(record, 0);
+                npy::put<uint32_t>(record, entry.offset);
+                record.append(entry.name);
+                write(record);
+            }
+            std::string end;
+            npy::put<uint32_t>(end, 0x06054b50U);
+            npy::put<uint16_t>(end, 0);
+            npy::put<uint16_t>(end, 0);
+            npy::put<uint16_t>(end, static_cast<uint16_t>(m_entries.size()));
+            npy::put<uint16_t>(end, static_cast<uint16_t>(m_entries.size()));
+            npy::put<uint32_t>(end, static_cast<uint32_t>(m_offset - directory_offset));
+            npy::put<uint32_t>(end, static_cast<uint32_t>(directory_offset));
+            npy::put<uint16_t>(end, 0);
+            write(end);
+            m_file.close();
+            if (!m_file) throw std::runtime_error("Could not write " + m_path.string());
+        }
+
+    private:
+        struct Entry {
+            std::string name;
+            uint32_t crc, size, offset;
+        };
+
+        // Fields shared by the local and central headers of a stored entry
+        static void common_fields(std::string &record, const Entry &entry) {
+            // Version needed, flags, compression (stored), time and date (1980-01-01)
+            npy::put<uint16_t>(record, 20);
+            npy::put<uint16_t>(record, 0);
+            npy::put<uint16_t>(record, 0);
+            npy::put<uint16_t>(record, 0);
+            npy::put<uint16_t>(record, 0x21);
+            npy::put<uint32_t>(record, entry.crc);
+            npy::put<uint32_t>(record, entry.size);
+            npy::put<uint32_t>(record, entry.size);
+            npy::put<uint16_t>(record, static_cast<uint16_t>(entry.name.size()));
+            // Extra field length
+            npy::put<uint16_t>(record, 0);
+        }
+
+        void write(const std::string &bytes) {
+            m_file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+            m_offset += bytes.size();
+        }
+
+        fs::path m_path;
+        std::ofstream m_file;
+        size_t m_offset{0};
+        std::vector<Entry> m_entries{};
+        bool m_closed{false};
+    };
+
+    /**
+     * Whether a file is a zip archive such as an .npz, judging from its first bytes.
+     * @param path Path to the file.
+     */
+    inline bool is_npz(const fs::path &path) {
+        std::ifstream file(path, std::ios::binary);
+        std::array<char, 4> magic{};
+        return file.read(magic.data(), magic.size()) &&
+               magic == std::array<char, 4>{'P', 'K', '\x03', '\x04'};
+    }
+
+    /**
+     * Memory-mapped reader of uncompressed .npz archives of one-dimensional arrays, as written by
+     * NpzWriter or numpy.savez: columns are converted straight from the mapped file, one at a time,
+     * with no text parsing.
+     */
+    class NpzReader {
+    public:
+        explicit NpzReader(const fs::path &path) : m_path(path), m_file(path) {
+            const auto *data = m_file.data();
+            const auto size = m_file.size();
+            // The end of the central directory is followed by a comment of at most 64 KiB
+            const size_t lowest = size > 22 + 0xFFFF ? size - 22 - 0xFFFF : 0;
+            size_t end = size >= 22 ? size - 22 : size;
+            while (end < size && npy::get<uint32_t>(data + end) != 0x06054b50U)
+                end = end > lowest ? end - 1 : size;
+            if (end >= size) throw std::runtime_error(path.string() + " is not a zip archive");
+            const auto n_entries = npy::get<uint16_t>(data + end + 10);
+            size_t record = npy::get<uint32_t>(data + end + 16);
+            for (size_t entry = 0; entry < n_entries; entry++) {
+                if (record + 46 > size || npy::get<uint32_t>(data + record) != 0x02014b50U)
+                    throw std::runtime_error(path.string() + ": corrupted zip directory");
+                if (npy::get<uint16_t>(data + record + 10) != 0)
+                    throw std::runtime_error(path.string() +
+                                             ": compressed archives are not supported");
+                const size_t name_size = npy::get<uint16_t>(data + record + 28);
+                const size_t extra_size = npy::get<uint16_t>(data + record + 30);
+                const size_t comment_size = npy::get<uint16_t>(data + record + 32);
+                const size_t local = npy::get<uint32_t>(data + record + 42);
+                std::string name(data + record + 46, name_size);
+                if (name.size() > 4 && name.compare(name.size() - 4, 4, ".npy") == 0)
+                    name.resize(name.size() - 4);
+                // The array follows the local header, whose extra field may differ
+                const auto offset = local + 30 + npy::get<uint16_t>(data + local + 26) +
+                                    npy::get<uint16_t>(data + local + 28);
+                m_columns.push_back(
+                        {std::move(name), offset, npy::get<uint32_t>(data + record + 20)});
+                record += 46 + name_size + extra_size + comment_size;
+            }
+        }
+
+        [[nodiscard]] std::vector<std::string> names() const {
+            std::vector<std::string> out;
+            for (const auto &column: m_columns) out.push_back(column.name);
+            return out;
+        }
+
+        /**
+         * Entries of a column, converted to T.
+         * @param name Name of the column.
+         * @param skip Number of entries to skip from the beginning.
+         */
+        template<typename T>
+        std::vector<T> column(const std::string &name, size_t skip = 0) const {
+            for (const auto &column: m_columns) {
+                if (column.name != name) continue;
+                const auto *array = m_file.data() + column.offset;
+                if (column.offset + column.size > m_file.size() || column.size < 10 ||
+                    std::memcmp(array, "\x93NUMPY", 6) != 0)
+                    throw std::runtime_error(m_path.string() + ": " + name + " is not an array");
+                const auto version = uint8_t(array[6]);
+                const size_t preamble = version == 1 ? 10 : 12;
+                const size_t header_size = version == 1 ? npy::get<uint16_t>(array + 8)
+                                                        : npy::get<uint32_t>(array + 8);
+                const std::string header(array + preamble, header_size);
+                const auto descr = field(header, "'descr':", '\'', '\'');
+                const auto shape = field(header, "'shape':", '(', ')');
+                if (header.find("'fortran_order': False") == std::string::npos ||
+                    shape.find(',') != shape.size() - 1)
+                    throw std::runtime_error(m_path.string() + ": " + name +
+                                             " is not a one-dimensional array");
+                const auto size = size_t(std::stoull(shape));
+                return npy::convert<T>(descr, array + preamble + header_size, std::min(skip, size),
+                                       size);
+            }
+            throw std::runtime_error(m_path.string() + " has no column " + name);
+        }
+
+    private:
+        struct Column {
+            std::string name;
+            size_t offset, size;
+        };
+
+        // Value of a key of the npy header dictionary, between the given delimiters
+        static std::string field(const std::string &header, const std::string &key, char open,
+                                 char close) {
+            const auto key_at = header.find(key);
+            const auto first =
+                    key_at == std::string::npos ? key_at : header.find(open, key_at + key.size());
+            const auto last = first == std::string::npos ? first : header.find(close, first + 1);
+            if (last == std::string::npos) throw std::runtime_error("Corrupted npy header");
+            return header.substr(first + 1, last - first - 1);
+        }
+
+        fs::path m_path;
+        MappedFile m_file;
+        std::vector<Column> m_columns{};
+    };
+
+    /**
+     * Table of named columns stored either as csv or as npz, as chosen by the user. Csv columns are
+     * collected in a rapidcsv::Document and saved at once; npz columns are streamed to the file as
+     * they are added.
+     */
+    class Table {
+    public:
+        /**
+         * Constructor
+         * @param path Output path: its extension is replaced by the format's one.
+         * @param format File format.
+         */
+        Table(fs::path path, Format format) : m_path(path.replace_extension(extension(format))) {
+            if (m_path.has_parent_path() && !fs::exists(m_path.parent_path()))
+                fs::create_directories(m_path.parent_path());
+            if (format == Format::Npz) m_npz.emplace(m_path);
+        }
+
+        /**
+         * Appends a column.
+         * @param name Name of the column.
+         * @param column Entries of the column.
+         */
+        template<typename T>
+        void add(const std::string &name, const std::vector<T> &column) {
+            if (m_npz.has_value()) {
+                m_npz->add(name, column);
+            } else {
+                m_csv.InsertColumn(m_n_columns, column, name);
+            }
+            m_n_columns++;
+        }
+
+        /**
+         * Completes the file.
+         */
+        void save() {
+            if (m_npz.has_value()) {
+                m_npz->close();
+                return;
+            }
+            if (m_n_columns > 0) m_csv.RemoveColumn(m_csv.GetColumnCount() - 1);
+            m_csv.Save(m_path.string());
+        }
+
+        [[nodiscard]] const fs::path &path() const noexcept { return m_path; }
+
+    private:
+        fs::path m_path;
+        rapidcsv::Document m_csv{};
+        std::optional<NpzWriter> m_npz{};
+        size_t m_n_columns{0};
+    };
+}// namespace tables
+
+#endif//ESERCIZI_LSN_TABLES_HPP
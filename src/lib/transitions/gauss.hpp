@@ -38,11 +38,23 @@ namespace transitions {
             return m_prefix - (delta * delta).sum() / m_2var;
         }
 
+        /// Width of the transition: the standard deviation of each component
+        [[nodiscard]] real_space width() const noexcept { return m_stdev; }
+
+        /// Changes the width of the transition.
+        /// \param stdev The standard deviation of each component
+        void set_width(real_space stdev) {
+            m_stdev = stdev;
+            m_2var = 2 * m_stdev * m_stdev;
+            m_prefix = -real_space(m_ndimensions) * (0.5 * std::log(2 * M_PI) + std::log(m_stdev));
+            m_offset = std::normal_distribution<real_space>(0, m_stdev);
+        }
+
     protected:
-        const real_space m_stdev, m_2var{2 * m_stdev * m_stdev};
+        real_space m_stdev, m_2var{2 * m_stdev * m_stdev};
         const size_t m_ndimensions;
-        const real_space m_prefix{-real_space(m_ndimensions) *
-                                  (0.5 * std::log(2 * M_PI) + std::log(m_stdev))};
+        real_space m_prefix{-real_space(m_ndimensions) *
+                            (0.5 * std::log(2 * M_PI) + std::log(m_stdev))};
         std::normal_distribution<real_space> m_offset{0, m_stdev};
     };
 
@@ -68,9 +80,21 @@ namespace transitions {
             return m_prefix - (delta * delta).sum() / m_2var;
         }
 
+        /// Width of the transition: the standard deviation of each component
+        [[nodiscard]] real_space width() const noexcept { return m_stdev; }
+
+        /// Changes the width of the transition.
+        /// \param stdev The standard deviation of each component
+        void set_width(real_space stdev) {
+            m_stdev = stdev;
+            m_2var = 2 * m_stdev * m_stdev;
+            m_prefix = -real_space(N) * (0.5 * std::log(2 * M_PI) + std::log(m_stdev));
+            m_offset = std::normal_distribution<real_space>(0, m_stdev);
+        }
+
     protected:
-        const real_space m_stdev, m_2var{2 * m_stdev * m_stdev};
-        const real_space m_prefix{-real_space(N) * (0.5 * std::log(2 * M_PI) + std::log(m_stdev))};
+        real_space m_stdev, m_2var{2 * m_stdev * m_stdev};
+        real_space m_prefix{-real_space(N) * (0.5 * std::log(2 * M_PI) + std::log(m_stdev))};
         std::normal_distribution<real_space> m_offset{0, m_stdev};
     };
 
@@ -95,9 +119,21 @@ namespace transitions {
             return m_prefix - (delta * delta) / m_2var;
         }
 
+        /// Width of the transition: the standard deviation of each component
+        [[nodiscard]] real_space width() const noexcept { return m_stdev; }
+
+        /// Changes the width of the transition.
+        /// \param stdev The standard deviation of each component
+        void set_width(real_space stdev) {
+            m_stdev = stdev;
+            m_2var = 2 * m_stdev * m_stdev;
+            m_prefix = -(0.5 * std::log(2 * M_PI) + std::log(m_stdev));
+            m_offset = std::normal_distribution<real_space>(0, m_stdev);
+        }
+
     protected:
-        const real_space m_stdev, m_2var{2 * m_stdev * m_stdev};
-        const real_space m_prefix{-(0.5 * std::log(2 * M_PI) + std::log(m_stdev))};
+        real_space m_stdev, m_2var{2 * m_stdev * m_stdev};
+        real_space m_prefix{-(0.5 * std::log(2 * M_PI) + std::log(m_stdev))};
         std::normal_distribution<real_space> m_offset{0, m_stdev};
     };
 }// namespace transitions
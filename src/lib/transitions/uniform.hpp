@@ -43,9 +43,21 @@ namespace transitions {
             return m_loginvnorm;
         }
 
+        /// Width of the transition: the uniform box half-edge
+        [[nodiscard]] real_space width() const noexcept { return m_radius; }
+
+        /// Changes the width of the transition.
+        /// \param radius The uniform box half-edge
+        void set_width(real_space radius) {
+            m_radius = radius;
+            m_invnorm = ProbSpace{1} / (2 * ProbSpace(m_radius));
+            m_loginvnorm = -std::log(2 * ProbSpace(m_radius));
+            m_offset = std::uniform_real_distribution<real_space>(-m_radius, m_radius);
+        }
+
     protected:
-        const real_space m_radius;
-        const ProbSpace m_invnorm{ProbSpace{1} / (2 * ProbSpace(m_radius))},
+        real_space m_radius;
+        ProbSpace m_invnorm{ProbSpace{1} / (2 * ProbSpace(m_radius))},
                 m_loginvnorm{-std::log(2 * ProbSpace(m_radius))};
         std::uniform_real_distribution<real_space> m_offset{-m_radius, m_radius};
     };
@@ -85,10 +97,23 @@ namespace transitions {
             return m_loginvnorm;
         }
 
+        /// Width of the transition: the uniform box half-edge
+        [[nodiscard]] real_space width() const noexcept { return m_radius; }
+
+        /// Changes the width of the transition.
+        /// \param radius The uniform box half-edge
+        void set_width(real_space radius) {
+            m_radius = radius;
+            m_radius_2 = m_radius * m_radius;
+            m_invnorm = ProbSpace{1} / std::pow(2 * ProbSpace(m_radius), m_ndimensions);
+            m_loginvnorm = -ProbSpace(m_ndimensions) * std::log(2 * ProbSpace(m_radius));
+            m_offset = std::uniform_real_distribution<real_space>(-m_radius, m_radius);
+        }
+
     protected:
-        const real_space m_radius, m_radius_2{m_radius * m_radius};
+        real_space m_radius, m_radius_2{m_radius * m_radius};
         const size_t m_ndimensions;
-        const ProbSpace m_invnorm{ProbSpace{1} / std::pow(2 * ProbSpace(m_radius), m_ndimensions)},
+        ProbSpace m_invnorm{ProbSpace{1} / std::pow(2 * ProbSpace(m_radius), m_ndimensions)},
                 m_loginvnorm{-ProbSpace(m_ndimensions) * std::log(2 * ProbSpace(m_radius))};
         std::uniform_real_distribution<real_space> m_offset{-m_radius, m_radius};
     };
@@ -126,9 +151,22 @@ namespace transitions {
             return m_loginvnorm;
         }
 
+        /// Width of the transition: the uniform box half-edge
+        [[nodiscard]] real_space width() const noexcept { return m_radius; }
+
+        /// Changes the width of the transition.
+        /// \param radius The uniform box half-edge
+        void set_width(real_space radius) {
+            m_radius = radius;
+            m_radius_2 = m_radius * m_radius;
+            m_invnorm = ProbSpace{1} / std::pow(2 * ProbSpace(m_radius), N);
+            m_loginvnorm = -ProbSpace(N) * std::log(2 * ProbSpace(m_radius));
+            m_offset = std::uniform_real_distribution<real_space>(-m_radius, m_radius);
+        }
+
     protected:
-        const real_space m_radius, m_radius_2{m_radius * m_radius};
-        const ProbSpace m_invnorm{ProbSpace{1} / std::pow(2 * ProbSpace(m_radius), N)},
+        real_space m_radius, m_radius_2{m_radius * m_radius};
+        ProbSpace m_invnorm{ProbSpace{1} / std::pow(2 * ProbSpace(m_radius), N)},
                 m_loginvnorm{-ProbSpace(N) * std::log(2 * ProbSpace(m_radius))};
         std::uniform_real_distribution<real_space> m_offset{-m_radius, m_radius};
     };
@@ -2,17 +2,23 @@
 
 #include <algorithm>
 #include <array>
+#include <cmath>
+#include <exception>
 #include <filesystem>
 #include <functional>
 #include <iostream>
 #include <iterator>
 #include <numeric>
+#include <thread>
 #include <type_traits>
 #include <utility>
 #include <vector>
 
 #include <rapidcsv.h>
 
+#include "fft.hpp"
+#include "tables.hpp"
+
 namespace csv = rapidcsv;
 namespace fs = std::filesystem;
 
@@ -233,6 +239,30 @@ namespace utils {
         tuple_apply([](const auto &value, auto &v) { v.push_back(value); }, values, to);
     }
 
+    /**
+     * Runs f(thread) on n_threads threads, thread = 0, ..., n_threads - 1, and waits for all of them.
+     * The calling thread takes care of thread 0. An exception thrown by f is rethrown once every
+     * thread has finished, that of the lowest thread index if several threads threw.
+     * @param n_threads Number of threads.
+     * @param f Action taking the thread index.
+     */
+    template<class Fn>
+    inline void parallel_for(size_t n_threads, Fn f) {
+        std::vector<std::exception_ptr> errors(std::max<size_t>(n_threads, 1));
+        const auto run = [&](size_t thread) {
+            try {
+                f(thread);
+            } catch (...) { errors[thread] = std::current_exception(); }
+        };
+        std::vector<std::thread> workers;
+        workers.reserve(n_threads);
+        for (size_t thread = 1; thread < n_threads; thread++) workers.emplace_back(run, thread);
+        run(size_t(0));
+        for (auto &worker: workers) worker.join();
+        for (const auto &error: errors)
+            if (error) std::rethrow_exception(error);
+    }
+
     /**
      * Requires the existence of path, else throws
      * @param path Path.
@@ -264,16 +294,17 @@ namespace utils {
     }
 
     /**
-     * Computes the autocorrelation function of a given sample for the specified number of lags using
-     * the definition. FFT would be way better.
+     * Computes the autocorrelation function of a given sample for the specified number of lags.
+     * Few lags are computed from the definition, in O(T n_lags); otherwise the autocovariance is
+     * obtained through FFT, in O(T log T).
      * @param first Sample beginning.
      * @param last Sample's past-the-end iterator.
      * @param first_out Output beginning.
      * @param n_lags Number of lags.
      */
     template<typename InputIt, typename OutputIt>
-    constexpr inline void autocorrelation_fn(InputIt first, InputIt last, OutputIt first_out,
-                                             size_t n_lags = 0) {
+    inline void autocorrelation_fn(InputIt first, InputIt last, OutputIt first_out,
+                                   size_t n_lags = 0) {
         if (n_lags == 0) n_lags = size_t(std::distance(first, last));
         using ovar_space = typename std::iterator_traits<OutputIt>::value_type;
         const auto t_max = size_t(std::distance(first, last));
@@ -281,34 +312,80 @@ namespace utils {
         std::vector<ovar_space> y(t_max);
         std::transform(first, last, y.begin(),
                        [=](const auto xt) { return ovar_space(xt) - sample_avg; });
-        const auto sample_rej2_sum =
-                std::transform_reduce(y.cbegin(), y.cend(), y.cbegin(), ovar_space(0));
-        for (size_t t = 0; t < n_lags; t++)
-            *first_out++ = _autocorrelation(y.cbegin(), y.cend(), sample_rej2_sum, t);
+        // Rough operation counts of the two methods
+        const auto fft_size = double(fft::next_pow2(t_max + n_lags));
+        if (double(t_max) * double(n_lags) <= 8 * fft_size * std::log2(fft_size)) {
+            const auto sample_rej2_sum =
+                    std::transform_reduce(y.cbegin(), y.cend(), y.cbegin(), ovar_space(0));
+            for (size_t t = 0; t < n_lags; t++)
+                *first_out++ = _autocorrelation(y.cbegin(), y.cend(), sample_rej2_sum, t);
+        } else {
+            const auto c = fft::autocovariance(y, n_lags);
+            for (size_t t = 0; t < n_lags; t++) *first_out++ = c[t] / c[0];
+        }
+    }
+
+    /**
+     * Estimates the integrated autocorrelation time tau = 1/2 + sum_t rho(t) of a sample, summing
+     * the autocorrelation function up to the first lag t >= window * tau (Sokal's automatic
+     * windowing). The variance of the sample mean is 2 tau times that of uncorrelated data.
+     * The autocorrelation function is computed by autocorrelation_fn over all the lags, in
+     * O(T log T).
+     * @param first Sample beginning.
+     * @param last Sample's past-the-end iterator.
+     * @param window Window factor, usually between 4 and 10.
+     * @return Integrated autocorrelation time, in steps.
+     */
+    template<typename real = double, typename InputIt>
+    inline real integrated_autocorrelation_time(InputIt first, InputIt last, real window = 6) {
+        const auto t_max = size_t(std::distance(first, last));
+        real tau(0.5);
+        if (t_max < 2) return tau;
+        std::vector<real> rho(t_max);
+        autocorrelation_fn(first, last, rho.begin(), t_max);
+        // A constant sample has no autocorrelation
+        if (std::isnan(rho[0])) return tau;
+        for (size_t t = 1; t < t_max; t++) {
+            tau += rho[t];
+            if (real(t) >= window * tau) break;
+        }
+        return tau;
     }
 
     /**
-     * Computes the autocorrelation for every column of a given csv file and stores it in another csv file.
-     * @param input_path Path to the series.
-     * @param output_path Path to the output.
+     * Computes the autocorrelation for every column of a given table and stores it in another table.
+     * An .npz input (see tables::Table) is read one column at a time from the mapped file, with no
+     * text parsing.
+     * @param input_path Path to the series, either csv or npz.
+     * @param output_path Path to the output; its extension follows the format.
      * @param n_lags Number of lags.
      * @param skip Number of rows to skip from the beginning of input.
+     * @param format Output table format.
      */
     template<typename real>
     inline void autocorrelation_from(const fs::path &input_path, const fs::path &output_path,
-                                     size_t n_lags, size_t skip) {
-        csv::Document in(input_path);
-        csv::Document out;
-        for (size_t i = 0; i < in.GetColumnCount(); i++) {
-            const auto data = in.template GetColumn<real>(i);
+                                     size_t n_lags, size_t skip,
+                                     tables::Format format = tables::Format::Csv) {
+        tables::Table out(output_path, format);
+        const auto store = [&](const std::string &name, auto first, auto last) {
             std::vector<real> ac_fn(n_lags);
-            autocorrelation_fn(snext(data.cbegin(), skip), data.cend(), ac_fn.begin(), n_lags);
-            out.InsertColumn(i, std::move(ac_fn), in.GetColumnName(signed(i)));
+            autocorrelation_fn(first, last, ac_fn.begin(), n_lags);
+            out.add(name, ac_fn);
+        };
+        if (tables::is_npz(input_path)) {
+            const tables::NpzReader in(input_path);
+            for (const auto &name: in.names()) {
+                const auto data = in.template column<real>(name, skip);
+                store(name, data.cbegin(), data.cend());
+            }
+        } else {
+            csv::Document in(input_path);
+            for (size_t i = 0; i < in.GetColumnCount(); i++) {
+                const auto data = in.template GetColumn<real>(i);
+                store(in.GetColumnName(signed(i)), snext(data.cbegin(), skip), data.cend());
+            }
         }
-        out.RemoveColumn(out.GetColumnCount() - 1);
-        if (!fs::exists(output_path.parent_path()))
-            fs::create_directories(output_path.parent_path());
-        out.Save(output_path);
+        out.save();
     }
 
 
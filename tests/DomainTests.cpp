@@ -0,0 +1,81 @@
+#include <cmath>
+#include <limits>
+#include <random>
+
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_session.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <mpi.h>
+
+#include "config.hpp"
+#include "molecular_systems/steppers/domain_md.hpp"
+#include "molecular_systems/steppers/md.hpp"
+#include "molecular_systems/system.hpp"
+
+using namespace molecular_systems::steppers;
+
+// Run through mpiexec: every rank runs the same tests
+int main(int argc, char *argv[]) {
+    MPI_Init(&argc, &argv);
+    const int result = Catch::Session().run(argc, argv);
+    MPI_Finalize();
+    return result;
+}
+
+TEST_CASE("Domain decomposition", "[md][mpi]") {
+    using System = LJMono<double, true, Ensamble::NVE>;
+    const fs::path settings(MD_SETTINGS_PATH "input.liquid"), lattice(LATTICES_PATH "config.fcc");
+    System serial(settings, lattice), gathered(settings, lattice);
+    std::mt19937 rng(17);
+    serial.init_velocities(rng);
+    gathered.init_velocities(rng);
+    DomainMD<double, true> domain(serial);
+    MD2<double, true> stepper;
+
+    const auto n_particles = serial.m_simulation.n_particles;
+    unsigned long n_owned = domain.n_owned();
+    MPI_Allreduce(MPI_IN_PLACE, &n_owned, 1, MPI_UNSIGNED_LONG, MPI_SUM, MPI_COMM_WORLD);
+    REQUIRE(n_owned == n_particles);
+    // MPI counts are ints
+    using molecular_systems::steppers::detail::mpi_count;
+    REQUIRE(mpi_count(n_particles) == static_cast<int>(n_particles));
+    REQUIRE_THROWS_AS(mpi_count(size_t(std::numeric_limits<int>::max()) + 1),
+                      std::runtime_error);
+
+    const size_t n_steps = 300;
+    for (size_t t = 0; t < n_steps; t++) {
+        std::array<double, 5> expected{}, measured{};
+        serial.measures(expected[0], expected[1], expected[2], expected[3], expected[4]);
+        domain.measures(measured[0], measured[1], measured[2], measured[3], measured[4]);
+        for (size_t var = 0; var < expected.size(); var++)
+            REQUIRE(measured[var] == Catch::Approx(expected[var]).epsilon(1e-9));
+        stepper.step(serial);
+        domain.step();
+    }
+    REQUIRE(domain.time() == n_steps);
+
+    // Molecules have migrated, but none got lost
+    n_owned = domain.n_owned();
+    MPI_Allreduce(MPI_IN_PLACE, &n_owned, 1, MPI_UNSIGNED_LONG, MPI_SUM, MPI_COMM_WORLD);
+    REQUIRE(n_owned == n_particles);
+    REQUIRE(domain.n_ghosts() > 0);
+
+    domain.gather(gathered);
+    for (size_t i = 0; i < n_particles; i++) {
+        REQUIRE(serial.pbc(gathered.m_positions.e_i[i] - serial.m_positions.e_i[i]) ==
+                Catch::Approx(0).margin(1e-9));
+        REQUIRE(serial.pbc(gathered.m_positions.e_j[i] - serial.m_positions.e_j[i]) ==
+                Catch::Approx(0).margin(1e-9));
+        REQUIRE(serial.pbc(gathered.m_positions.e_k[i] - serial.m_positions.e_k[i]) ==
+                Catch::Approx(0).margin(1e-9));
+        REQUIRE(gathered.m_velocities.e_i[i] ==
+                Catch::Approx(serial.m_velocities.e_i[i]).margin(1e-9));
+    }
+    // The gathered system continues from the time step of the stepper, with no stale caches
+    REQUIRE(gathered.time() == serial.time());
+    std::array<double, 5> expected{}, measured{};
+    serial.measures(expected[0], expected[1], expected[2], expected[3], expected[4]);
+    gathered.measures(measured[0], measured[1], measured[2], measured[3], measured[4]);
+    for (size_t var = 0; var < expected.size(); var++)
+        REQUIRE(measured[var] == Catch::Approx(expected[var]).epsilon(1e-9));
+}
@@ -2,12 +2,20 @@
 // Created by Davide Nicoli on 04/07/22.
 //
 
+#include <cmath>
+#include <random>
+#include <stdexcept>
 #include <valarray>
+#include <vector>
 
 #include <catch2/catch_approx.hpp>
 #include <catch2/catch_test_macros.hpp>
 
+#include "estimators/accumulators.hpp"
+#include "estimators/blocking.hpp"
 #include "estimators/mean.hpp"
+#include "estimators/resampling.hpp"
+#include "estimators/variance.hpp"
 
 
 TEST_CASE("Testing estimators", "[estimators]") {
@@ -43,4 +51,190 @@ TEST_CASE("Testing estimators", "[estimators]") {
         REQUIRE(mean_est == Catch::Approx(estimate));
         REQUIRE(mean_err == Catch::Approx(error));
     }
-}
\ No newline at end of file
+
+    SECTION("Online") {
+        estimators::Welford<double> acc;
+        for (const auto x: block1) acc.push(x);
+        const auto [estimate, error] =
+                estimators::Average<double>()(std::begin(block1), std::end(block1));
+        REQUIRE(acc.count() == 4);
+        REQUIRE(acc.mean() == Catch::Approx(estimate));
+        REQUIRE(acc.error() == Catch::Approx(error));
+        // Block averages accumulated online give the same estimates as whole blocks
+        estimators::SampleProgAvg<double> est, online_est;
+        for (const auto &block: {block1, block2, block3}) {
+            acc.reset();
+            for (const auto x: block) acc.push(x);
+            const auto [avg, mean, err] = est(std::begin(block), std::end(block));
+            const auto [online_avg, online_mean, online_err] = online_est.push_block(acc.mean());
+            REQUIRE(online_avg == Catch::Approx(avg));
+            REQUIRE(online_mean == Catch::Approx(mean));
+            REQUIRE(online_err == Catch::Approx(err));
+        }
+        // Large offsets do not spoil the variance
+        estimators::Welford<double> shifted;
+        for (const auto x: block3) shifted.push(1e9 + x);
+        REQUIRE(shifted.variance() == Catch::Approx(acc.variance()).epsilon(1e-6));
+    }
+
+    SECTION("Merge") {
+        // Blocks split among four chains, then reduced in different orders
+        std::mt19937 rng(11);
+        std::normal_distribution<double> gauss(1e6, 1);
+        std::vector<std::vector<double>> chains(4);
+        for (auto &chain: chains)
+            for (size_t block = 0; block < 25; block++) chain.push_back(gauss(rng));
+        estimators::ProgAvg<double> sequential;
+        estimators::Welford<double> sequential_acc;
+        std::vector<estimators::ProgAvg<double>> partial(4);
+        std::vector<estimators::Welford<double>> partial_acc(4);
+        for (size_t chain = 0; chain < 4; chain++) {
+            for (const auto x: chains[chain]) {
+                sequential.push_block(x);
+                sequential_acc.push(x);
+                partial[chain].push_block(x);
+                partial_acc[chain].push(x);
+            }
+        }
+        const auto [mean, error] = sequential.estimate();
+        // ((0 1) 2) 3
+        auto left = partial[0];
+        left.merge(partial[1]).merge(partial[2]).merge(partial[3]);
+        // (0 1) (2 3), as in a tree reduction
+        auto tree = partial[0], right = partial[2];
+        tree.merge(partial[1]).merge(right.merge(partial[3]));
+        for (const auto &merged: {left, tree}) {
+            const auto [merged_mean, merged_error] = merged.estimate();
+            REQUIRE(merged_mean == Catch::Approx(mean).epsilon(1e-14));
+            REQUIRE(merged_error == Catch::Approx(error).epsilon(1e-9));
+        }
+        auto acc = partial_acc[3];
+        acc.merge(partial_acc[2]).merge(partial_acc[1].merge(partial_acc[0]));
+        REQUIRE(acc.count() == 100);
+        REQUIRE(acc.mean() == Catch::Approx(sequential_acc.mean()).epsilon(1e-14));
+        REQUIRE(acc.variance() == Catch::Approx(sequential_acc.variance()).epsilon(1e-9));
+        // Empty estimators are the identity
+        estimators::ProgAvg<double> empty;
+        auto with_empty = partial[0];
+        with_empty.merge(empty);
+        REQUIRE(std::get<0>(with_empty.estimate()) == std::get<0>(partial[0].estimate()));
+        REQUIRE(std::get<0>(empty.merge(partial[0]).estimate()) ==
+                std::get<0>(partial[0].estimate()));
+
+        // The sample average is the last one pushed
+        estimators::SampleProgAvg<double> first, second;
+        first(std::begin(block1), std::end(block1));
+        second(std::begin(block2), std::end(block2));
+        const auto sample_est = second(std::begin(block3), std::end(block3));
+        first.merge(second);
+        const auto [avg, merged_mean, merged_error] = first.estimate();
+        REQUIRE(avg == Catch::Approx(std::get<0>(sample_est)));
+        REQUIRE(merged_mean == Catch::Approx(0.2916666666666667));
+        REQUIRE(merged_error == Catch::Approx(0.041666666666666595));
+
+        // Bins are merged one by one
+        estimators::ProgAvg<std::vector<double>> bins(2), other_bins(2), wrong_bins(3);
+        bins.push_block({av1, av2});
+        other_bins.push_block({av2, av3});
+        other_bins.push_block({av3, av1});
+        const auto [bin_means, bin_errors, bin_dummy] = bins.merge(other_bins).estimate();
+        REQUIRE(bin_means[0] == Catch::Approx((av1 + av2 + av3) / 3));
+        REQUIRE(bin_errors[1] == Catch::Approx(0.041666666666666595));
+        REQUIRE_THROWS(bins.merge(wrong_bins));
+
+        // Variances of independent chains of the same distribution
+        estimators::ProgVariance<double> var_left, var_right;
+        for (size_t chain = 0; chain < 4; chain++) {
+            auto &estimator = chain < 2 ? var_left : var_right;
+            for (size_t block = 0; block < 5; block++)
+                estimator(chains[chain].cbegin() + long(5 * block),
+                          chains[chain].cbegin() + long(5 * block + 5));
+        }
+        const auto [variance, variance_error] = var_left.merge(var_right).estimate();
+        REQUIRE(variance == Catch::Approx(1).margin(4 * variance_error));
+    }
+
+    SECTION("Resampling") {
+        // Block averages of x and x^2, x ~ N(2, 1)
+        std::mt19937 rng(13);
+        std::normal_distribution<double> gauss(2, 1);
+        estimators::Resampling<double> resampling(2);
+        estimators::Welford<double> block_means;
+        for (size_t block = 0; block < 400; block++) {
+            double sum = 0, sum2 = 0;
+            for (size_t i = 0; i < 10; i++) {
+                const auto x = gauss(rng);
+                sum += x;
+                sum2 += x * x;
+            }
+            resampling.push_block({sum / 10, sum2 / 10});
+            block_means.push(sum / 10);
+        }
+        REQUIRE(resampling.n_blocks() == 400);
+        REQUIRE_THROWS(resampling.push_block({1}));
+        // Linear functions: the jackknife gives back the standard error, with no bias
+        const auto mean = [](const std::vector<double> &m) { return m[0]; };
+        const auto [estimate, error, bias] = resampling.jackknife(mean);
+        REQUIRE(estimate == Catch::Approx(block_means.mean()));
+        REQUIRE(error == Catch::Approx(block_means.error()));
+        REQUIRE(bias == Catch::Approx(0).margin(1e-12));
+        // <x>^2: error 2 <x> sigma, bias sigma^2, with sigma the error of the mean
+        const auto square = [](const std::vector<double> &m) { return m[0] * m[0]; };
+        const auto [square_est, square_err, square_bias] = resampling.jackknife(square);
+        REQUIRE(square_est == Catch::Approx(estimate * estimate));
+        REQUIRE(square_err == Catch::Approx(2 * estimate * error).epsilon(1e-3));
+        REQUIRE(square_bias == Catch::Approx(error * error).epsilon(1e-3));
+        // The variance, as in the heat capacity
+        const auto variance = [](const std::vector<double> &m) { return m[1] - m[0] * m[0]; };
+        const auto [var_est, var_jack_err, var_jack_bias] = resampling.jackknife(variance);
+        CHECK(var_est == Catch::Approx(1).margin(3 * var_jack_err));
+        // The bootstrap agrees, and only depends on the streams
+        std::vector<std::mt19937> streams{std::mt19937(1), std::mt19937(2), std::mt19937(3)};
+        std::vector<std::mt19937> same_streams = streams;
+        const auto [var_boot, var_boot_err, var_boot_bias] =
+                resampling.bootstrap(variance, 3000, streams);
+        REQUIRE(var_boot == var_est);
+        CHECK(var_boot_err == Catch::Approx(var_jack_err).epsilon(0.1));
+        CHECK(std::abs(var_boot_bias) < var_boot_err);
+        REQUIRE(resampling.bootstrap(variance, 3000, same_streams) ==
+                std::make_tuple(var_boot, var_boot_err, var_boot_bias));
+        // Errors of f on the worker threads reach the caller
+        const auto failing = [](const std::vector<double> &m) {
+            if (m[0] > 2) throw std::domain_error("out of range");
+            return m[0];
+        };
+        REQUIRE_THROWS_AS(resampling.bootstrap(failing, 3000, streams), std::domain_error);
+        std::vector<std::mt19937> single{std::mt19937(1)};
+        CHECK(std::get<1>(resampling.bootstrap(mean, 3000, single)) ==
+              Catch::Approx(error).epsilon(0.1));
+    }
+
+    SECTION("Blocking") {
+        // AR(1) process: tau = (1 + a) / (2 (1 - a))
+        std::mt19937 rng(7);
+        std::normal_distribution<double> noise(0, 1);
+        estimators::Blocking<double> white, ar;
+        double x = 0;
+        for (size_t t = 0; t < 100000; t++) {
+            const auto eps = noise(rng);
+            white.push(eps);
+            ar.push(x = 0.8 * x + eps);
+        }
+        REQUIRE(white.count() == 100000);
+        const auto levels = ar.levels();
+        REQUIRE(levels[3].block_size == 8);
+        REQUIRE(levels[3].n_blocks == 12500);
+        REQUIRE(white.plateau().has_value());
+        CHECK(white.error() == Catch::Approx(1 / std::sqrt(1e5)).epsilon(0.05));
+        CHECK(white.tau() == Catch::Approx(0.5).epsilon(0.1));
+        REQUIRE(ar.plateau().has_value());
+        CHECK(*ar.plateau() > 0);
+        CHECK(ar.tau() == Catch::Approx(4.5).epsilon(0.15));
+        CHECK(ar.reached(2 * ar.error()));
+        CHECK_FALSE(ar.reached(ar.error() / 2));
+        // Too few values to find the plateau
+        estimators::Blocking<double> short_run;
+        for (size_t t = 0; t < 10; t++) short_run.push(noise(rng));
+        CHECK_FALSE(short_run.reached(1e10));
+    }
+}
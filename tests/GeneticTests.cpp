@@ -66,6 +66,21 @@ TEST_CASE("Genetic algorithm", "[ga]") {
             REQUIRE(is_valid_individual(second_child));
         }
     }
+    SECTION("Saving the population") {
+        const std::vector<std::array<uint16_t, 3>> population{{1, 2, 3}, {3, 1, 2}};
+        const std::vector<double> distances{4.0, 5.0};
+        const fs::path path(TEST_RESULTS_DIR "population.npz");
+        save_population(population, distances, path, tables::Format::Npz);
+        const tables::NpzReader table(path);
+        REQUIRE(table.names() == std::vector<std::string>{"0", "1", "2", "3", "total_distance"});
+        REQUIRE(table.column<size_t>("2") == std::vector<size_t>{2, 1});
+        REQUIRE(table.column<double>("total_distance") == distances);
+        // An empty population gives an empty table
+        save_population(std::vector<std::array<uint16_t, 3>>{}, {}, path, tables::Format::Npz);
+        const tables::NpzReader empty(path);
+        REQUIRE(empty.names() == std::vector<std::string>{"0", "total_distance"});
+        REQUIRE(empty.column<double>("total_distance").empty());
+    }
 }
 TEST_CASE("Genetic utils", "[gu]") {
     SECTION("Cut and mix") {
@@ -72,5 +72,17 @@ TEST_CASE("Integrator") {
             // Catch::Approx has a weird behavior when applied to 0
             CHECK(std::get<0>(result) + 1 == Catch::Approx(1.0).epsilon(0.1));
         }
+        SECTION("Tuning") {
+            // Fixed stream: the assertions on single warmup blocks are not statistical bounds
+            ARandom rng(SEEDS_PATH "seed.in", PRIMES_PATH "primes32001.in", 7);
+            // A far too wide transition is narrowed toward the target acceptance rate
+            Metropolis sampler(field(0.5), uniform_pdf(),
+                               UniformNear<prob_space, field>(/*radius=*/10.0));
+            const auto blocks = sampler.tune(20, 2000, rng, 0.5);
+            REQUIRE(blocks.size() == 20);
+            REQUIRE(blocks.front().acceptance_rate < 0.2);
+            REQUIRE(blocks.back().width < blocks.front().width);
+            REQUIRE(blocks.back().acceptance_rate == Catch::Approx(0.5).margin(0.1));
+        }
     }
 }
\ No newline at end of file
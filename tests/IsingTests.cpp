@@ -5,6 +5,7 @@
 #include <random>
 
 #include "config.hpp"
+#include "mapped_table.hpp"
 #include "estimators/mean.hpp"
 #include "models/ising/1D/ising.hpp"
 #include "models/ising/1D/simulation.hpp"
@@ -50,7 +51,25 @@ TEST_CASE("Ising", "[models]") {
         Simulator<false, true, false, double, SystemMetropolis<double>, M_var> sim(10, i6,
                                                                                    M_var(*i6));
         sim.run(1, 0, rng);
-        sim.save_results(fs::path(RESULTS_DIR "test.csv"));
-        sim.save_state(fs::path(RESULTS_DIR "state.csv"));
+        sim.save_results(fs::path(TEST_RESULTS_DIR "test.csv"));
+        sim.save_state(fs::path(TEST_RESULTS_DIR "state.csv"));
+    }
+    SECTION("Binary state") {
+        const Ising1D random(64, rng, 1, 0.1, 1);
+        const fs::path text(TEST_RESULTS_DIR "random_state.csv"),
+                table(TEST_RESULTS_DIR "random_state.table");
+        random.save_state(text);
+        REQUIRE(text_to_table<uint8_t>(text, table, 1, 1) == random.n_spins());
+        // The mapped table gives back the state saved as text
+        const Ising1D from_table(table, 1, 0.1, 1), from_text(text, 1, 0.1, 1);
+        REQUIRE(from_table.n_spins() == random.n_spins());
+        for (int64_t k = 0; k < int64_t(random.n_spins()); k++) {
+            REQUIRE(from_table[k] == random[k]);
+            REQUIRE(from_text[k] == random[k]);
+        }
+        REQUIRE(from_table.energy() == Catch::Approx(random.energy()));
+        // A spin state has a single column
+        text_to_table<uint8_t>(text, table, 2, 1);
+        REQUIRE_THROWS(Ising1D(table, 1, 0.1, 1));
     }
 }
\ No newline at end of file
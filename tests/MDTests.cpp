@@ -2,10 +2,38 @@
 // Created by Davide Nicoli on 24/07/22.
 //
 
+#include <algorithm>
+#include <fstream>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include <catch2/catch_approx.hpp>
 #include <catch2/catch_test_macros.hpp>
 
+#include "config.hpp"
 #include "molecular_systems/algos.hpp"
+#include "molecular_systems/data_types/async_writer.hpp"
+#include "molecular_systems/data_types/cells.hpp"
+#include "molecular_systems/data_types/checkpoint.hpp"
+#include "molecular_systems/data_types/neighbor_list.hpp"
+#include "molecular_systems/data_types/settings.hpp"
+#include "molecular_systems/data_types/trajectory.hpp"
 #include "molecular_systems/data_types/vectors.hpp"
+#include "molecular_systems/kernels.hpp"
+#include "molecular_systems/steppers/checkerboard_mc.hpp"
+#include "molecular_systems/steppers/hmc.hpp"
+#include "molecular_systems/steppers/mc.hpp"
+#include "molecular_systems/steppers/md.hpp"
+#include "molecular_systems/steppers/npt_mc.hpp"
+#include "molecular_systems/system.hpp"
+#include "utils.hpp"
+
+// Estimator taking whole blocks only, so that BlockStats stores them
+struct BlockOnlyAvg : private ProgAvg<double> {
+    using ProgAvg<double>::Output;
+    using ProgAvg<double>::operator();
+};
 
 TEST_CASE("MD", "[md]") {
     SECTION("utils") {
@@ -18,4 +46,928 @@ TEST_CASE("MD", "[md]") {
             compute_previous_positions(positions, velocities, dt, box_edge, pp);
         }
     }
+    SECTION("Linked cells") {
+        SimulationSettings<double> ss(400, 1, 1, 2.5, 0.0005, 0.8);
+        Vectors<double> positions(ss.n_particles);
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<double> unif(-ss.box_edge / 2, ss.box_edge / 2);
+        positions.apply([&](auto &x) { x = unif(rng); });
+        CellList<double> cells(ss.box_edge, ss.cutoff);
+        REQUIRE(cells.usable());
+        cells.build(positions);
+
+        const auto within_cutoff = [&](size_t i, size_t j) {
+            const auto dx = PBC(positions.e_i[i] - positions.e_i[j], ss.box_edge);
+            const auto dy = PBC(positions.e_j[i] - positions.e_j[j], ss.box_edge);
+            const auto dz = PBC(positions.e_k[i] - positions.e_k[j], ss.box_edge);
+            return dx * dx + dy * dy + dz * dz < ss.cutoff2;
+        };
+        SECTION("Pairs") {
+            size_t all_pairs = 0, cell_pairs = 0;
+            for (size_t i = 0; i + 1 < ss.n_particles; i++)
+                for (size_t j = i + 1; j < ss.n_particles; j++) all_pairs += within_cutoff(i, j);
+            cells.for_each_pair([&](size_t i, size_t j) { cell_pairs += within_cutoff(i, j); });
+            REQUIRE(cell_pairs == all_pairs);
+        }
+        SECTION("Potential") {
+            for (size_t particle = 0; particle < ss.n_particles; particle += 37) {
+                const auto position = positions[particle];
+                REQUIRE(LJ_potential<false>(particle, position, positions, ss, cells) ==
+                        Catch::Approx(LJ_potential<false>(particle, position, positions, ss)));
+            }
+        }
+        SECTION("Verlet list") {
+            NeighborList<double> neighbors(ss.box_edge, ss.cutoff, 0.3);
+            REQUIRE(neighbors.update(positions));
+            REQUIRE(!neighbors.update(positions));
+            // Displacements smaller than half the skin keep the list valid
+            positions.apply([&](auto &x) { x = PBC(x + 0.05, ss.box_edge); });
+            REQUIRE(!neighbors.outdated(positions));
+            size_t all_pairs = 0, list_pairs = 0;
+            for (size_t i = 0; i + 1 < ss.n_particles; i++)
+                for (size_t j = i + 1; j < ss.n_particles; j++) all_pairs += within_cutoff(i, j);
+            neighbors.for_each_pair([&](size_t i, size_t j) { list_pairs += within_cutoff(i, j); });
+            REQUIRE(list_pairs == all_pairs);
+            positions.e_i[3] += 0.2;
+            REQUIRE(neighbors.update(positions));
+            REQUIRE(neighbors.rebuilds() == 2);
+        }
+        SECTION("Move") {
+            const std::array<double, 3> new_position{0.1, -0.2, ss.box_edge / 2 - 0.01};
+            positions.e_i[7] = new_position[0];
+            positions.e_j[7] = new_position[1];
+            positions.e_k[7] = new_position[2];
+            cells.move(7, new_position);
+            REQUIRE(LJ_potential<false>(7, new_position, positions, ss, cells) ==
+                    Catch::Approx(LJ_potential<false>(7, new_position, positions, ss)));
+        }
+    }
+    SECTION("Verlet step") {
+        using System = LJMono<double, false, Ensamble::NVE>;
+        const fs::path settings(MD_SETTINGS_PATH "input.liquid"), lattice(LATTICES_PATH "config.fcc");
+        std::mt19937 rng(19);
+        System fused(settings, lattice, rng), reference(settings, lattice);
+        reference.m_velocities = fused.m_velocities;
+        reference.m_prev_positions = fused.m_prev_positions;
+        molecular_systems::steppers::MD2<double, false> stepper;
+        double u, k, e, t, p;
+        fused.measures(u, k, e, t, p);
+        stepper.step(fused);
+        const std::array<const double *, 3> buffers{&fused.m_positions.e_i[0],
+                                                    &fused.m_prev_positions.e_i[0],
+                                                    &fused.m_next_positions.e_i[0]};
+        // The unfused update, one step behind
+        const auto reference_step = [&]() {
+            Vectors<double> next_positions(reference.m_simulation.n_particles);
+            verlet_next_positions(reference.m_positions, reference.m_prev_positions,
+                                  next_positions, reference.m_forces,
+                                  reference.m_simulation.delta2,
+                                  reference.m_simulation.box_edge);
+            verlet_next_velocities(next_positions, reference.m_prev_positions,
+                                   reference.m_velocities, reference.m_simulation.dbldelta,
+                                   reference.m_simulation.box_edge);
+            reference.m_prev_positions = reference.m_positions;
+            reference.m_positions = next_positions;
+            reference.time_step();
+        };
+        reference.measures(u, k, e, t, p);
+        reference_step();
+        for (size_t step = 0; step < 10; step++) {
+            double fused_k, reference_k;
+            fused.measures(u, fused_k, e, t, p);
+            reference.measures(u, reference_k, e, t, p);
+            REQUIRE(fused.m_positions == reference.m_positions);
+            REQUIRE(fused.m_prev_positions == reference.m_prev_positions);
+            REQUIRE(fused.m_velocities == reference.m_velocities);
+            // The cached squared norm is the one of the velocities, up to the summation order
+            REQUIRE(fused_k == Catch::Approx(reference_k).epsilon(1e-14));
+            stepper.step(fused);
+            reference_step();
+        }
+        // Buffers are rotated, never reallocated
+        for (const auto *buffer: {&fused.m_positions.e_i[0], &fused.m_prev_positions.e_i[0],
+                                  &fused.m_next_positions.e_i[0]})
+            REQUIRE(std::find(buffers.cbegin(), buffers.cend(), buffer) != buffers.cend());
+    }
+    SECTION("Velocity Verlet") {
+        using namespace molecular_systems::steppers;
+        // Forces vanishing at the cutoff, so that the energy is conserved up to the integrator
+        using Potential = molecular_systems::potentials::ShiftedForceLJ<double>;
+        using System = LJMono<double, false, Ensamble::NVE, double, Potential>;
+        const fs::path settings(MD_SETTINGS_PATH "input.liquid"), lattice(LATTICES_PATH "config.fcc");
+        std::mt19937 rng(23);
+        System system(settings, lattice, rng);
+        system.init_potential(Potential(system.m_simulation.cutoff));
+        const auto target = system.m_thermo.temperature;
+        const size_t n_steps = 2000;
+        const auto mean = [](const std::vector<double> &xs, size_t from) {
+            return std::accumulate(xs.cbegin() + long(from), xs.cend(), 0.0) /
+                   double(xs.size() - from);
+        };
+        const auto spread = [](const std::vector<double> &xs) {
+            const auto [min, max] = std::minmax_element(xs.cbegin(), xs.cend());
+            return *max - *min;
+        };
+        SECTION("NVE") {
+            using Stepper =
+                    VelocityVerlet<double, false, thermostats::None<double>, double, Potential>;
+            StepSampler<Stepper, Variable::TotalEnergy, Variable::Temperature> sampler(Stepper{});
+            const auto measures = sampler.sample(system, n_steps);
+            REQUIRE(spread(measures.get_measures<Variable::TotalEnergy>()) < 1e-4);
+            // The measures reuse the forces computed by the stepper
+            REQUIRE(system.forces_computed());
+            double u, k, e, t, p;
+            system.measures(u, k, e, t, p);
+            REQUIRE(k == Catch::Approx(system.m_velocities.full_norm2() /
+                                       double(2 * system.m_simulation.n_particles))
+                                 .epsilon(1e-14));
+        }
+        SECTION("Nosé-Hoover chain") {
+            using Thermostat = thermostats::NoseHooverChain<double>;
+            VelocityVerlet<double, false, Thermostat, double, Potential> stepper(
+                    Thermostat(target, 0.05, system.m_simulation.n_particles));
+            std::vector<double> extended, temperatures;
+            for (size_t step = 0; step < n_steps; step++) {
+                double u, k, e, t, p;
+                system.measures(u, k, e, t, p);
+                extended.push_back(e + stepper.thermostat().extended_energy());
+                temperatures.push_back(t);
+                stepper.step(system);
+            }
+            REQUIRE(spread(extended) < 1e-4);
+            REQUIRE(mean(temperatures, n_steps / 2) == Catch::Approx(target).epsilon(0.05));
+        }
+        SECTION("Berendsen") {
+            using Thermostat = thermostats::Berendsen<double>;
+            using Stepper = VelocityVerlet<double, false, Thermostat, double, Potential>;
+            StepSampler<Stepper, Variable::TotalEnergy, Variable::Temperature> sampler(
+                    Stepper(Thermostat(target, 0.05)));
+            const auto measures = sampler.sample(system, n_steps);
+            REQUIRE(mean(measures.get_measures<Variable::Temperature>(), n_steps / 2) ==
+                    Catch::Approx(target).epsilon(0.02));
+        }
+        SECTION("Andersen") {
+            using Thermostat = thermostats::Andersen<double, std::mt19937>;
+            using Stepper = VelocityVerlet<double, false, Thermostat, double, Potential>;
+            StepSampler<Stepper, Variable::TotalEnergy, Variable::Temperature> sampler(Stepper(
+                    Thermostat(target, 50, std::make_shared<std::mt19937>(29))));
+            const auto measures = sampler.sample(system, n_steps);
+            REQUIRE(mean(measures.get_measures<Variable::Temperature>(), n_steps / 2) ==
+                    Catch::Approx(target).epsilon(0.05));
+        }
+    }
+    SECTION("Monte Carlo sums") {
+        using System = LJMono<double, true, Ensamble::NVT>;
+        using Outs = MeasureOutputs<double, Variable::PotentialEnergy, Variable::Pressure>;
+        const fs::path lattice(LATTICES_PATH "config.fcc");
+        fs::path settings(MD_SETTINGS_PATH "input.liquid");
+        bool cells = false;
+        SECTION("Linked cells") {
+            // A cutoff short enough for three cells per side
+            settings = fs::path(TEST_RESULTS_DIR) / "input.cells";
+            std::ofstream(settings) << "1\n0\n1.1\n108\n0.8\n1.7\n0.0005\n1\n1\n";
+            cells = true;
+        }
+        SECTION("All pairs") {}
+        System system(settings, lattice), reference(settings, lattice);
+        REQUIRE(system.init_linked_cells() == cells);
+        molecular_systems::steppers::MC<double, true, std::mt19937> mc(
+                system.m_simulation.n_particles, 0.2, std::make_shared<std::mt19937>(31));
+        Outs running, full;
+        for (size_t sweep = 0; sweep < 20; sweep++) {
+            mc.step(system);
+            // The running sums, against a full pass over the pairs of the same configuration
+            reference.m_positions = system.m_positions;
+            reference.time_step();
+            system.measures<false>(running);
+            reference.measures<false>(full);
+            REQUIRE(running.get_measures<Variable::PotentialEnergy>().back() ==
+                    Catch::Approx(full.get_measures<Variable::PotentialEnergy>().back())
+                            .epsilon(1e-12));
+            REQUIRE(running.get_measures<Variable::Pressure>().back() ==
+                    Catch::Approx(full.get_measures<Variable::Pressure>().back()).epsilon(1e-12));
+        }
+        REQUIRE(mc.acceptance_rate() > 0);
+    }
+    SECTION("Checkerboard Monte Carlo") {
+        using namespace molecular_systems::steppers;
+        using System = LJMono<double, true, Ensamble::NVT>;
+        using Outs = MeasureOutputs<double, Variable::PotentialEnergy, Variable::Pressure>;
+        using Stepper = CheckerboardMC<double, true, std::mt19937>;
+        const fs::path lattice(LATTICES_PATH "config.fcc");
+        // A cutoff short enough for four cells per side
+        const auto settings = fs::path(TEST_RESULTS_DIR) / "input.checkerboard";
+        std::ofstream(settings) << "1\n0\n1.1\n108\n0.8\n1.25\n0.0005\n1\n1\n";
+        const auto streams = [](std::vector<unsigned> seeds) {
+            return std::vector<std::mt19937>(seeds.cbegin(), seeds.cend());
+        };
+        System system(settings, lattice), reference(settings, lattice);
+        Stepper mc(system.m_simulation, 0.2, streams({37, 41, 43}));
+        REQUIRE(mc.cells_per_side() == 4);
+        SECTION("Sums") {
+            Outs running, full;
+            for (size_t sweep = 0; sweep < 20; sweep++) {
+                mc.step(system);
+                reference.m_positions = system.m_positions;
+                reference.time_step();
+                system.measures<false>(running);
+                reference.measures<false>(full);
+                REQUIRE(running.get_measures<Variable::PotentialEnergy>().back() ==
+                        Catch::Approx(full.get_measures<Variable::PotentialEnergy>().back())
+                                .epsilon(1e-12));
+                REQUIRE(running.get_measures<Variable::Pressure>().back() ==
+                        Catch::Approx(full.get_measures<Variable::Pressure>().back())
+                                .epsilon(1e-12));
+            }
+            REQUIRE(mc.acceptance_rate() > 0);
+        }
+        SECTION("Reproducibility") {
+            Stepper twin(reference.m_simulation, 0.2, streams({37, 41, 43}));
+            for (size_t sweep = 0; sweep < 10; sweep++) {
+                mc.step(system);
+                twin.step(reference);
+            }
+            REQUIRE(system.m_positions == reference.m_positions);
+        }
+        SECTION("Sequential sampling") {
+            // Same equilibrium as the sequential stepper
+            MC<double, true, std::mt19937> sequential(reference.m_simulation.n_particles, 0.2,
+                                                      std::make_shared<std::mt19937>(47));
+            StepSampler<Stepper, Variable::PotentialEnergy> parallel_sampler(std::move(mc));
+            StepSampler<decltype(sequential), Variable::PotentialEnergy> sequential_sampler(
+                    std::move(sequential));
+            const size_t n_sweeps = 400;
+            const auto parallel_u = parallel_sampler.sample(system, n_sweeps)
+                                            .get_measures<Variable::PotentialEnergy>();
+            const auto sequential_u = sequential_sampler.sample(reference, n_sweeps)
+                                              .get_measures<Variable::PotentialEnergy>();
+            const auto mean = [&](const std::vector<double> &us) {
+                return std::accumulate(us.cbegin() + long(n_sweeps / 2), us.cend(), 0.0) /
+                       double(n_sweeps / 2);
+            };
+            REQUIRE(mean(parallel_u) == Catch::Approx(mean(sequential_u)).epsilon(0.03));
+        }
+    }
+    SECTION("NPT Monte Carlo") {
+        using namespace molecular_systems::steppers;
+        const fs::path settings(MD_SETTINGS_PATH "input.liquid"), lattice(LATTICES_PATH "config.fcc");
+        SECTION("Sums") {
+            using System = LJMono<double, true, Ensamble::NPT>;
+            using Outs = MeasureOutputs<double, Variable::PotentialEnergy, Variable::Pressure>;
+            System system(settings, lattice), reference(settings, lattice);
+            NPTMC<double, true, std::mt19937> mc(system.m_simulation.n_particles, 0.2, 0.05, 1.0,
+                                                 std::make_shared<std::mt19937>(53));
+            const auto box_edge = system.m_simulation.box_edge;
+            Outs running, full;
+            for (size_t sweep = 0; sweep < 20; sweep++) {
+                mc.step(system);
+                // A full pass over the pairs of the same configuration, in the same box
+                reference.m_positions = system.m_positions;
+                reference.m_simulation = system.m_simulation;
+                reference.m_thermo = system.m_thermo;
+                reference.init_potential(
+                        molecular_systems::potentials::LennardJones<double>(
+                                system.m_simulation.cutoff));
+                reference.time_step();
+                system.measures<false>(running);
+                reference.measures<false>(full);
+                REQUIRE(running.get_measures<Variable::PotentialEnergy>().back() ==
+                        Catch::Approx(full.get_measures<Variable::PotentialEnergy>().back())
+                                .epsilon(1e-10));
+                REQUIRE(running.get_measures<Variable::Pressure>().back() ==
+                        Catch::Approx(full.get_measures<Variable::Pressure>().back())
+                                .epsilon(1e-10));
+            }
+            REQUIRE(mc.volume_acceptance_rate() > 0);
+            REQUIRE(mc.volume_acceptance_rate() < 1);
+            REQUIRE(system.m_simulation.box_edge != box_edge);
+        }
+        SECTION("Pressure") {
+            // The virial pressure fluctuates around the imposed one
+            using Stepper = NPTMC<double, false, std::mt19937>;
+            LJMono<double, false, Ensamble::NPT> system(settings, lattice);
+            StepSampler<Stepper, Variable::Pressure> sampler(Stepper(
+                    system.m_simulation.n_particles, 0.2, 0.05, 2.0,
+                    std::make_shared<std::mt19937>(5)));
+            const size_t n_sweeps = 1000;
+            const auto pressures =
+                    sampler.sample(system, n_sweeps).get_measures<Variable::Pressure>();
+            const auto mean = std::accumulate(pressures.cbegin() + long(n_sweeps / 2),
+                                              pressures.cend(), 0.0) /
+                              double(n_sweeps / 2);
+            REQUIRE(mean == Catch::Approx(2.0).epsilon(0.05));
+            REQUIRE(system.m_thermo.density != Catch::Approx(0.8).epsilon(1e-6));
+        }
+    }
+    SECTION("Monte Carlo tuning") {
+        using namespace molecular_systems::steppers;
+        const fs::path settings(MD_SETTINGS_PATH "input.liquid"), lattice(LATTICES_PATH "config.fcc");
+        LJMono<double, true, Ensamble::NVT> system(settings, lattice);
+        // A far too wide displacement is narrowed toward the target acceptance rate
+        MC<double, true, std::mt19937> mc(system.m_simulation.n_particles, 2.0,
+                                          std::make_shared<std::mt19937>(73));
+        const auto blocks = mc.tune(system, 15, 10, 0.5);
+        REQUIRE(blocks.size() == 15);
+        REQUIRE(blocks.front().acceptance_rate < 0.2);
+        REQUIRE(blocks.back().width < blocks.front().width);
+        REQUIRE(blocks.back().acceptance_rate == Catch::Approx(0.5).margin(0.1));
+        // The tuned diameter is kept while sampling
+        const auto diameter = mc.displacement_diameter();
+        for (size_t sweep = 0; sweep < 10; sweep++) mc.step(system);
+        REQUIRE(mc.displacement_diameter() == diameter);
+        REQUIRE(mc.acceptance_rate() == Catch::Approx(0.5).margin(0.1));
+    }
+    SECTION("Hybrid Monte Carlo") {
+        using namespace molecular_systems::steppers;
+        using System = LJMono<double, true, Ensamble::NVT>;
+        using Stepper = HMC<double, true, std::mt19937>;
+        const fs::path settings(MD_SETTINGS_PATH "input.liquid"), lattice(LATTICES_PATH "config.fcc");
+        System system(settings, lattice), reference(settings, lattice);
+        SECTION("Sums") {
+            using Outs = MeasureOutputs<double, Variable::PotentialEnergy, Variable::Pressure>;
+            Stepper hmc(10, 0.005, std::make_shared<std::mt19937>(61));
+            Outs running, full;
+            for (size_t trajectory = 0; trajectory < 20; trajectory++) {
+                hmc.step(system);
+                reference.m_positions = system.m_positions;
+                reference.time_step();
+                system.measures<false>(running);
+                reference.measures<false>(full);
+                REQUIRE(running.get_measures<Variable::PotentialEnergy>().back() ==
+                        Catch::Approx(full.get_measures<Variable::PotentialEnergy>().back())
+                                .epsilon(1e-10));
+                REQUIRE(running.get_measures<Variable::Pressure>().back() ==
+                        Catch::Approx(full.get_measures<Variable::Pressure>().back())
+                                .epsilon(1e-10));
+            }
+            REQUIRE(hmc.acceptance_rate() > 0);
+            REQUIRE(hmc.acceptance_rate() < 1);
+        }
+        SECTION("Sampling") {
+            // Same equilibrium as the Metropolis stepper
+            MC<double, true, std::mt19937> mc(reference.m_simulation.n_particles, 0.2,
+                                              std::make_shared<std::mt19937>(67));
+            StepSampler<Stepper, Variable::PotentialEnergy> hmc_sampler(
+                    Stepper(10, 0.005, std::make_shared<std::mt19937>(71)));
+            StepSampler<decltype(mc), Variable::PotentialEnergy> mc_sampler(std::move(mc));
+            const size_t n_steps = 400;
+            const auto hmc_u = hmc_sampler.sample(system, n_steps)
+                                       .get_measures<Variable::PotentialEnergy>();
+            const auto mc_u =
+                    mc_sampler.sample(reference, n_steps).get_measures<Variable::PotentialEnergy>();
+            const auto mean = [&](const std::vector<double> &us) {
+                return std::accumulate(us.cbegin() + long(n_steps / 2), us.cend(), 0.0) /
+                       double(n_steps / 2);
+            };
+            REQUIRE(mean(hmc_u) == Catch::Approx(mean(mc_u)).epsilon(0.03));
+            REQUIRE(utils::integrated_autocorrelation_time(hmc_u.cbegin() + long(n_steps / 2),
+                                                           hmc_u.cend()) >= 0.5);
+        }
+    }
+    SECTION("Trajectory") {
+        const fs::path path = fs::path(TEST_RESULTS_DIR) / "trajectory.bin";
+        const double box_edge = 5.0;
+        std::mt19937 rng(79);
+        std::uniform_real_distribution<double> unif(-box_edge, box_edge);
+        std::vector<Vectors<double>> frames;
+        for (size_t frame = 0; frame < 4; frame++) {
+            frames.emplace_back(10);
+            frames.back().apply([&](auto &x) { x = unif(rng); });
+        }
+        SECTION("Exact") {
+            {
+                TrajectoryWriter writer(path, 10);
+                for (size_t frame = 0; frame < 3; frame++)
+                    writer.write(frames[frame], box_edge, 10 * frame);
+            }
+            {
+                // Appending, after a crash left half a frame behind
+                std::ofstream(path, std::ios::binary | std::ios::app) << "garbage";
+                TrajectoryWriter writer(path, 10, TrajectoryEncoding::Exact, true);
+                writer.write(frames[3], box_edge, 30);
+                REQUIRE_THROWS(TrajectoryWriter(path, 11, TrajectoryEncoding::Exact, true));
+            }
+            TrajectoryReader reader(path);
+            REQUIRE(reader.n_frames() == 4);
+            REQUIRE(reader.n_particles() == 10);
+            Vectors<double> positions(0);
+            // Random access, in any order
+            for (size_t frame: {size_t(2), size_t(0), size_t(3), size_t(1)}) {
+                const auto info = reader.read(frame, positions);
+                REQUIRE(info.step == 10 * frame);
+                REQUIRE(info.box_edge == box_edge);
+                REQUIRE(positions == frames[frame]);
+            }
+            REQUIRE(reader.frame_of(20) == 2);
+            REQUIRE(reader.frame_of(15) == 2);
+            REQUIRE(reader.frame_of(40) == 4);
+            REQUIRE_THROWS(reader.read(4, positions));
+        }
+        SECTION("Fixed16") {
+            {
+                TrajectoryWriter writer(path, 10, TrajectoryEncoding::Fixed16);
+                writer.write(frames[0], box_edge, 0);
+            }
+            REQUIRE(fs::file_size(path) == 32 + 16 + 3 * 10 * 2);
+            TrajectoryReader reader(path);
+            Vectors<double> positions(0);
+            reader.read(0, positions);
+            for (size_t i = 0; i < 10; i++) {
+                // Same point up to the periodic images
+                const auto dx = PBC(positions.e_i[i] - frames[0].e_i[i], box_edge);
+                REQUIRE(std::abs(dx) <= box_edge / 131072.0 + 1e-12);
+            }
+            const fs::path xyz_dir = fs::path(TEST_RESULTS_DIR) / "trajectory_xyz";
+            REQUIRE(trajectory_to_xyz(path, xyz_dir) == 1);
+            REQUIRE(fs::exists(xyz_dir / "0.xyz"));
+        }
+    }
+    SECTION("Asynchronous writer") {
+        const fs::path path = fs::path(TEST_RESULTS_DIR) / "async.bin";
+        std::mt19937 rng(83);
+        std::uniform_real_distribution<double> unif(-2.0, 2.0);
+        Vectors<double> positions(10), velocities(10);
+        velocities.apply([&](auto &v) { v = unif(rng); });
+        std::vector<Vectors<double>> frames;
+        {
+            AsyncWriter<double> writer(TrajectoryWriter(path, 10));
+            for (size_t step = 0; step < 50; step++) {
+                // The staging copy is taken before the positions change
+                positions.apply([&](auto &x) { x = unif(rng); });
+                frames.push_back(positions);
+                writer.write(positions, 4.0, step);
+            }
+            writer.checkpoint(positions, velocities, 4.0,
+                              fs::path(TEST_RESULTS_DIR) / "async.positions",
+                              fs::path(TEST_RESULTS_DIR) / "async.velocities");
+            writer.flush();
+            // Errors of the background thread reach the caller
+            writer.checkpoint(positions, velocities, 4.0,
+                              fs::path(TEST_RESULTS_DIR) / "no/such/dir",
+                              fs::path(TEST_RESULTS_DIR) / "no/such/dir");
+            REQUIRE_THROWS(writer.flush());
+            // Everything submitted is written before the destructor returns
+            writer.write(positions, 4.0, 50);
+            frames.push_back(positions);
+        }
+        TrajectoryReader reader(path);
+        REQUIRE(reader.n_frames() == frames.size());
+        Vectors<double> frame(0);
+        for (size_t step = 0; step < frames.size(); step++) {
+            REQUIRE(reader.read(step, frame).step == step);
+            REQUIRE(frame == frames[step]);
+        }
+        Vectors<double> saved(10, fs::path(TEST_RESULTS_DIR) / "async.velocities");
+        for (size_t i = 0; i < 10; i++)
+            REQUIRE(saved.e_i[i] == Catch::Approx(velocities.e_i[i]).epsilon(1e-5));
+    }
+    SECTION("Online block statistics") {
+        using namespace molecular_systems::steppers;
+        using System = LJMono<double, true, Ensamble::NVE>;
+        using Stepper = MD2<double, true>;
+        using Online = BlockStats<Stepper, std::tuple<ProgAvg<double>, ProgAvg<double>>,
+                                  Variable::TotalEnergy, Variable::Pressure>;
+        using Stored = BlockStats<Stepper, std::tuple<BlockOnlyAvg, ProgAvg<double>>,
+                                  Variable::TotalEnergy, Variable::Pressure>;
+        static_assert(Online::online && !Stored::online);
+        const fs::path settings(MD_SETTINGS_PATH "input.liquid"), lattice(LATTICES_PATH "config.fcc");
+        std::mt19937 rng(101), other_rng(101);
+        System system(settings, lattice, rng), other(settings, lattice, other_rng);
+        system.m_simulation.block_size = other.m_simulation.block_size = 20;
+        Online online(Stepper(), {}, 20);
+        Stored stored(Stepper(), {}, 20);
+        // Blocking analyses see every measure, whether stored or not
+        estimators::Blocking<double> blocking, stored_blocking;
+        online.attach<Variable::TotalEnergy>(blocking);
+        stored.attach<Variable::TotalEnergy>(stored_blocking);
+        for (size_t block = 0; block < 3; block++) {
+            const auto results = utils::tuple_flatten(online.statistics(system));
+            const auto stored_results = utils::tuple_flatten(stored.statistics(other));
+            REQUIRE(std::get<0>(results) ==
+                    Catch::Approx(std::get<0>(stored_results)).epsilon(1e-12));
+            REQUIRE(std::get<1>(results) ==
+                    Catch::Approx(std::get<1>(stored_results)).margin(1e-12));
+            REQUIRE(std::get<2>(results) ==
+                    Catch::Approx(std::get<2>(stored_results)).epsilon(1e-12));
+        }
+        REQUIRE(blocking.count() == 60);
+        REQUIRE(stored_blocking.count() == 60);
+        REQUIRE(blocking.mean() == Catch::Approx(stored_blocking.mean()).epsilon(1e-12));
+    }
+    SECTION("Checkpoint") {
+        using namespace molecular_systems::steppers;
+        const fs::path settings(MD_SETTINGS_PATH "input.liquid"), lattice(LATTICES_PATH "config.fcc");
+        const fs::path path = fs::path(TEST_RESULTS_DIR) / "checkpoint.bin";
+        using Estimators = std::tuple<ProgAvg<double>, ProgAvg<double>>;
+        // Runs a few blocks, returning the estimates and the final positions
+        const auto run = [](auto &system, auto &stats) {
+            std::vector<double> estimates;
+            for (size_t block = 0; block < 3; block++) {
+                const auto results = utils::tuple_flatten(stats.statistics(system));
+                estimates.push_back(std::get<0>(results));
+                estimates.push_back(std::get<3>(results));
+            }
+            return estimates;
+        };
+        SECTION("Monte Carlo") {
+            using System = LJMono<double, true, Ensamble::NVT>;
+            using Stepper = MC<double, true, std::mt19937>;
+            using Stats = BlockStats<Stepper, Estimators, Variable::PotentialEnergy,
+                                     Variable::Pressure>;
+            System system(settings, lattice), restarted(settings, lattice);
+            system.m_simulation.block_size = restarted.m_simulation.block_size = 5;
+            system.init_linked_cells();
+            restarted.init_linked_cells();
+            system.init_radial_sampling(10);
+            restarted.init_radial_sampling(10);
+            auto rng = std::make_shared<std::mt19937>(89),
+                 other_rng = std::make_shared<std::mt19937>(97);
+            Stats stats(Stepper(system.m_simulation.n_particles, 0.2, rng), Estimators{}, 5);
+            Stats restarted_stats(Stepper(system.m_simulation.n_particles, 0.1, other_rng),
+                                  Estimators{}, 5);
+            run(system, stats);
+            CheckpointWriter writer;
+            writer(system, stats);
+            writer.rng(*rng);
+            writer.save(path);
+            const auto estimates = run(system, stats);
+
+            CheckpointReader reader(path);
+            reader(restarted, restarted_stats);
+            reader.rng(*other_rng);
+            REQUIRE(reader.done());
+            REQUIRE(run(restarted, restarted_stats) == estimates);
+            REQUIRE(restarted.m_positions == system.m_positions);
+            REQUIRE(restarted.time() == system.time());
+            std::vector<double> g_r, restarted_g_r;
+            system.radial_block_average(g_r);
+            restarted.radial_block_average(restarted_g_r);
+            REQUIRE(restarted_g_r == g_r);
+        }
+        SECTION("Molecular dynamics") {
+            using System = LJMono<double, true, Ensamble::NVE>;
+            using Stepper = MD2<double, true>;
+            using Stats = BlockStats<Stepper, Estimators, Variable::TotalEnergy,
+                                     Variable::Pressure>;
+            std::mt19937 rng(101);
+            System system(settings, lattice, rng), restarted(settings, lattice, rng);
+            system.m_simulation.block_size = restarted.m_simulation.block_size = 10;
+            system.init_neighbor_list(0.3);
+            restarted.init_neighbor_list(0.3);
+            Stats stats(Stepper(), Estimators{}, 10), restarted_stats(Stepper(), Estimators{}, 10);
+            run(system, stats);
+            CheckpointWriter writer;
+            writer(system, stats);
+            writer.save(path);
+            const auto estimates = run(system, stats);
+
+            CheckpointReader reader(path);
+            reader(restarted, restarted_stats);
+            REQUIRE(run(restarted, restarted_stats) == estimates);
+            REQUIRE(restarted.m_velocities == system.m_velocities);
+            REQUIRE(restarted.neighbor_list_rebuilds() == system.neighbor_list_rebuilds());
+        }
+        SECTION("Nosé-Hoover chain") {
+            using System = LJMono<double, true, Ensamble::NVE>;
+            using Thermostat = thermostats::NoseHooverChain<double>;
+            using Stepper = VelocityVerlet<double, true, Thermostat>;
+            using Stats = BlockStats<Stepper, Estimators, Variable::TotalEnergy,
+                                     Variable::Pressure>;
+            std::mt19937 rng(103);
+            System system(settings, lattice, rng), restarted(settings, lattice, rng);
+            system.m_simulation.block_size = restarted.m_simulation.block_size = 10;
+            const auto n_particles = system.m_simulation.n_particles;
+            Stats stats(Stepper(Thermostat(1.1, 0.05, n_particles)), Estimators{}, 10),
+                    restarted_stats(Stepper(Thermostat(1.1, 0.05, n_particles)), Estimators{}, 10);
+            run(system, stats);
+            CheckpointWriter writer;
+            writer(system, stats);
+            writer.save(path);
+            const auto estimates = run(system, stats);
+
+            CheckpointReader reader(path);
+            reader(restarted, restarted_stats);
+            REQUIRE(run(restarted, restarted_stats) == estimates);
+            REQUIRE(restarted.m_velocities == system.m_velocities);
+        }
+        SECTION("Checkerboard Monte Carlo") {
+            using System = LJMono<double, true, Ensamble::NVT>;
+            using Stepper = CheckerboardMC<double, true, std::mt19937>;
+            using Stats = BlockStats<Stepper, Estimators, Variable::PotentialEnergy,
+                                     Variable::Pressure>;
+            const auto cells_settings = fs::path(TEST_RESULTS_DIR) / "input.checkerboard";
+            std::ofstream(cells_settings) << "1\n0\n1.1\n108\n0.8\n1.25\n0.0005\n1\n1\n";
+            System system(cells_settings, lattice), restarted(cells_settings, lattice);
+            system.m_simulation.block_size = restarted.m_simulation.block_size = 5;
+            const auto streams = [](std::vector<unsigned> seeds) {
+                return std::vector<std::mt19937>(seeds.cbegin(), seeds.cend());
+            };
+            Stats stats(Stepper(system.m_simulation, 0.2, streams({59, 61})), Estimators{}, 5);
+            Stats restarted_stats(Stepper(restarted.m_simulation, 0.1, streams({67, 71})),
+                                  Estimators{}, 5);
+            run(system, stats);
+            CheckpointWriter writer;
+            writer(system, stats);
+            writer.save(path);
+            const auto estimates = run(system, stats);
+
+            CheckpointReader reader(path);
+            reader(restarted, restarted_stats);
+            REQUIRE(run(restarted, restarted_stats) == estimates);
+            REQUIRE(restarted.m_positions == system.m_positions);
+            // The generators are tied to the threads
+            Stats other_stats(Stepper(restarted.m_simulation, 0.2, streams({59})), Estimators{}, 5);
+            CheckpointReader other_reader(path);
+            REQUIRE_THROWS(other_reader(restarted, other_stats));
+        }
+        SECTION("NPT Monte Carlo") {
+            using System = LJMono<double, true, Ensamble::NPT>;
+            using Stepper = NPTMC<double, true, std::mt19937>;
+            using Stats = BlockStats<Stepper, Estimators, Variable::PotentialEnergy,
+                                     Variable::Pressure>;
+            System system(settings, lattice), restarted(settings, lattice);
+            system.m_simulation.block_size = restarted.m_simulation.block_size = 5;
+            const auto n_particles = system.m_simulation.n_particles;
+            auto rng = std::make_shared<std::mt19937>(73),
+                 other_rng = std::make_shared<std::mt19937>(79);
+            Stats stats(Stepper(n_particles, 0.2, 0.05, 1.0, rng), Estimators{}, 5);
+            Stats restarted_stats(Stepper(n_particles, 0.1, 0.02, 1.0, other_rng), Estimators{},
+                                  5);
+            run(system, stats);
+            CheckpointWriter writer;
+            writer(system, stats);
+            writer.rng(*rng);
+            writer.save(path);
+            const auto estimates = run(system, stats);
+
+            CheckpointReader reader(path);
+            reader(restarted, restarted_stats);
+            reader.rng(*other_rng);
+            REQUIRE(run(restarted, restarted_stats) == estimates);
+            REQUIRE(restarted.m_positions == system.m_positions);
+            REQUIRE(restarted.m_simulation.box_edge == system.m_simulation.box_edge);
+        }
+        SECTION("Mismatch") {
+            LJMono<double, true, Ensamble::NVT> system(settings, lattice);
+            CheckpointWriter writer;
+            writer(system);
+            writer.save(path);
+            // A system in a different box
+            LJMono<double, true, Ensamble::NVT> other(MD_SETTINGS_PATH "input.gas", lattice);
+            CheckpointReader reader(path);
+            REQUIRE_THROWS(reader(other));
+            // Not a checkpoint
+            REQUIRE_THROWS(CheckpointReader(settings));
+        }
+    }
+    SECTION("Threads") {
+        using System = LJMono<double, true, Ensamble::NVE>;
+        const fs::path settings(MD_SETTINGS_PATH "input.liquid"), lattice(LATTICES_PATH "config.fcc");
+        System serial(settings, lattice), threaded(settings, lattice);
+        // Breaking the lattice symmetry, so that forces do not vanish
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<double> unif(-0.05, 0.05);
+        serial.m_positions.apply([&](auto &x) { x += unif(rng); });
+        threaded.m_positions = serial.m_positions;
+        threaded.init_threads(3);
+        const size_t n_bins = 20;
+        serial.init_radial_func(n_bins);
+        threaded.init_radial_func(n_bins);
+        MeasureOutputs<double, Variable::PotentialEnergy, Variable::Pressure, Variable::RadialFn>
+                serial_out, threaded_out;
+        serial.measures<true>(serial_out);
+        threaded.measures<true>(threaded_out);
+        REQUIRE(threaded_out.get_measures<Variable::PotentialEnergy>()[0] ==
+                Catch::Approx(serial_out.get_measures<Variable::PotentialEnergy>()[0]));
+        REQUIRE(threaded_out.get_measures<Variable::Pressure>()[0] ==
+                Catch::Approx(serial_out.get_measures<Variable::Pressure>()[0]));
+        for (size_t bin = 0; bin < n_bins; bin++)
+            REQUIRE(threaded_out.get_measures<Variable::RadialFn>()[bin][0] ==
+                    Catch::Approx(serial_out.get_measures<Variable::RadialFn>()[bin][0]));
+        for (size_t particle = 0; particle < serial.m_simulation.n_particles; particle++)
+            REQUIRE(threaded.m_forces.e_i[particle] ==
+                    Catch::Approx(serial.m_forces.e_i[particle]).margin(1e-10));
+        // The reduction does not depend on scheduling
+        const auto forces = threaded.m_forces;
+        threaded.measures<true>(threaded_out);
+        REQUIRE(threaded.m_forces == forces);
+        REQUIRE(threaded_out.get_measures<Variable::PotentialEnergy>()[1] ==
+                threaded_out.get_measures<Variable::PotentialEnergy>()[0]);
+    }
+    SECTION("Radial sampling") {
+        using System = LJMono<double, false, Ensamble::NVE>;
+        const fs::path settings(MD_SETTINGS_PATH "input.liquid"), lattice(LATTICES_PATH "config.fcc");
+        System reference(settings, lattice), listed(settings, lattice);
+        std::mt19937 rng(5);
+        std::uniform_real_distribution<double> unif(-0.1, 0.1);
+        reference.m_positions.apply([&](auto &x) { x = reference.pbc(x + unif(rng)); });
+        listed.m_positions = reference.m_positions;
+        listed.init_neighbor_list(0.3);
+        const size_t n_bins = 25;
+        MeasureOutputs<double, Variable::PotentialEnergy, Variable::RadialFn> step_out;
+        MeasureOutputs<double, Variable::PotentialEnergy> out;
+        std::vector<double> g_reference, g_listed;
+        const auto compare = [&]() {
+            REQUIRE(g_listed.size() == n_bins);
+            for (size_t bin = 0; bin < n_bins; bin++)
+                REQUIRE(g_listed[bin] == Catch::Approx(g_reference[bin]).margin(1e-12));
+        };
+        SECTION("Whole box") {
+            // Beyond the cutoff: the neighbor list needs an extra pass over all pairs
+            reference.init_radial_sampling(n_bins);
+            listed.init_radial_sampling(n_bins);
+            listed.init_threads(2);
+            reference.measures<true>(step_out);
+            listed.measures<true>(out);
+            reference.radial_block_average(g_reference);
+            listed.radial_block_average(g_listed);
+            compare();
+            // A single sample gives the per-step g(r)
+            for (size_t bin = 0; bin < n_bins; bin++)
+                REQUIRE(step_out.get_measures<Variable::RadialFn>()[bin][0] ==
+                        Catch::Approx(g_reference[bin]));
+            REQUIRE(reference.m_drs.size() == n_bins);
+            REQUIRE(reference.m_drs[1] ==
+                    Catch::Approx(reference.m_simulation.box_edge / double(2 * n_bins)));
+        }
+        SECTION("Within the cutoff") {
+            // Binned along with the forces, using the neighbor list
+            const auto r_max = reference.m_simulation.cutoff;
+            reference.init_radial_sampling(n_bins, 1, r_max);
+            listed.init_radial_sampling(n_bins, 1, r_max);
+            for (size_t t = 0; t < 3; t++) {
+                reference.measures<true>(out);
+                listed.measures<true>(out);
+            }
+            reference.radial_block_average(g_reference);
+            listed.radial_block_average(g_listed);
+            compare();
+            REQUIRE(g_reference[n_bins - 1] > 0);
+        }
+        SECTION("Stride") {
+            reference.init_radial_sampling(n_bins, 3);
+            for (size_t t = 0; t < 7; t++) {
+                reference.measures<true>(out);
+                reference.time_step();
+            }
+            REQUIRE(reference.m_radial->n_samples() == 3);
+            reference.radial_block_average(g_reference);
+            REQUIRE(reference.m_radial->n_samples() == 0);
+            // Every sample is the same configuration
+            listed.init_radial_sampling(n_bins);
+            listed.measures<true>(out);
+            listed.radial_block_average(g_listed);
+            compare();
+        }
+    }
+    SECTION("Mixed precision") {
+        const fs::path settings(MD_SETTINGS_PATH "input.liquid"), lattice(LATTICES_PATH "config.fcc");
+        LJMono<double, true, Ensamble::NVE> reference(settings, lattice);
+        LJMono<float, true, Ensamble::NVE, double> mixed(settings, lattice);
+        std::mt19937 rng(11);
+        std::uniform_real_distribution<double> unif(-0.05, 0.05);
+        reference.m_positions.apply([&](auto &x) { x = reference.pbc(x + unif(rng)); });
+        for (size_t i = 0; i < reference.m_simulation.n_particles; i++) {
+            mixed.m_positions.e_i[i] = float(reference.m_positions.e_i[i]);
+            mixed.m_positions.e_j[i] = float(reference.m_positions.e_j[i]);
+            mixed.m_positions.e_k[i] = float(reference.m_positions.e_k[i]);
+        }
+        MeasureOutputs<double, Variable::PotentialEnergy, Variable::Pressure> reference_out,
+                mixed_out;
+        reference.measures<true>(reference_out);
+        mixed.measures<true>(mixed_out);
+        REQUIRE(mixed_out.get_measures<Variable::PotentialEnergy>()[0] ==
+                Catch::Approx(reference_out.get_measures<Variable::PotentialEnergy>()[0])
+                        .epsilon(1e-5));
+        REQUIRE(mixed_out.get_measures<Variable::Pressure>()[0] ==
+                Catch::Approx(reference_out.get_measures<Variable::Pressure>()[0]).epsilon(1e-4));
+        REQUIRE(lj_u_tail_correction(0.8f, 2.5f) ==
+                Catch::Approx(lj_u_tail_correction(0.8, 2.5)).epsilon(1e-6));
+    }
+    SECTION("Kernels") {
+        using namespace molecular_systems::kernels;
+        const auto compare = [](auto kernel, auto zero, double tolerance) {
+            using field = decltype(zero);
+            const size_t n = 203;
+            const field box_edge{5}, cutoff2{field(2.5 * 2.5)};
+            std::mt19937 rng(3);
+            std::uniform_real_distribution<field> unif(-box_edge, box_edge);
+            std::vector<field> dx(n), dy(n), dz(n), factors(n);
+            for (size_t k = 0; k < n; k++) {
+                dx[k] = unif(rng);
+                dy[k] = unif(rng);
+                dz[k] = unif(rng);
+            }
+            // Ties of the minimum image
+            dx[0] = box_edge / 2;
+            dx[1] = -box_edge / 2;
+            auto ref_dx = dx, ref_dy = dy, ref_dz = dz, ref_factors = factors;
+            field potential{0}, virial{0}, ref_potential{0}, ref_virial{0};
+            lj_batch_scalar(ref_dx.data(), ref_dy.data(), ref_dz.data(), ref_factors.data(), n,
+                            box_edge, cutoff2, ref_potential, ref_virial);
+            kernel(dx.data(), dy.data(), dz.data(), factors.data(), n, box_edge, cutoff2,
+                   potential, virial);
+            REQUIRE(double(potential) == Catch::Approx(double(ref_potential)).epsilon(tolerance));
+            REQUIRE(double(virial) == Catch::Approx(double(ref_virial)).epsilon(tolerance));
+            for (size_t k = 0; k < n; k++) {
+                REQUIRE(dx[k] == ref_dx[k]);
+                REQUIRE(dy[k] == ref_dy[k]);
+                REQUIRE(dz[k] == ref_dz[k]);
+                REQUIRE(double(factors[k]) ==
+                        Catch::Approx(double(ref_factors[k])).epsilon(tolerance));
+            }
+        };
+        compare(lj_batch_generic<double>, double(0), 1e-12);
+        compare(lj_batch_generic<float>, float(0), 1e-5);
+        compare(lj_batch<double>, double(0), 1e-12);
+        compare(lj_batch<float>, float(0), 1e-5);
+#if defined(__x86_64__) || defined(__i386__)
+        const auto isa = lj_batch_isa();
+        if (isa == "avx2" || isa == "avx512") {
+            compare(lj_batch_avx2<double>, double(0), 1e-12);
+            compare(lj_batch_avx2<float>, float(0), 1e-5);
+        }
+        if (isa == "avx512") {
+            compare(lj_batch_avx512<double>, double(0), 1e-12);
+            compare(lj_batch_avx512<float>, float(0), 1e-5);
+        }
+#endif
+    }
+    SECTION("Potentials") {
+        using namespace molecular_systems::potentials;
+        // force_over_r and virial must match the derivative of the energy
+        const auto check = [](const auto &potential, double r_min, double r_max) {
+            const double h = 1e-6;
+            for (double r = r_min; r < r_max; r += 0.05) {
+                const auto u = [&](double x) { return potential.energy(x * x); };
+                const double derivative = (u(r + h) - u(r - h)) / (2 * h);
+                REQUIRE(potential.force_over_r(r * r) ==
+                        Catch::Approx(-derivative / r).epsilon(1e-5).margin(1e-6));
+                REQUIRE(potential.virial(r * r) ==
+                        Catch::Approx(-derivative * r).epsilon(1e-5).margin(1e-6));
+                double energy, force_over_r;
+                potential.evaluate(r * r, energy, force_over_r);
+                REQUIRE(energy == Catch::Approx(u(r)).margin(1e-12));
+                REQUIRE(force_over_r ==
+                        Catch::Approx(potential.force_over_r(r * r)).margin(1e-12));
+            }
+        };
+        const LennardJones<double> lj(2.5);
+        const ShiftedForceLJ<double> shifted(2.5);
+        const WCA<double> wca;
+        const Morse<double> morse(2.5, 1.5, 2.0, 1.1);
+        check(lj, 0.9, 2.5);
+        check(shifted, 0.9, 2.5);
+        check(wca, 0.9, std::sqrt(wca.cutoff2));
+        check(morse, 0.8, 2.5);
+        REQUIRE(lj.energy(1.0) == 0.0);
+        REQUIRE(lj.force_over_r(std::cbrt(2.0)) == Catch::Approx(0.0).margin(1e-12));
+        // Both the energy and the force of the shifted potential vanish at the cutoff
+        REQUIRE(shifted.energy(2.5 * 2.5) == Catch::Approx(0.0).margin(1e-12));
+        REQUIRE(shifted.force_over_r(2.5 * 2.5) == Catch::Approx(0.0).margin(1e-12));
+        REQUIRE(wca.energy(wca.cutoff2) == Catch::Approx(0.0).margin(1e-12));
+        REQUIRE(morse.energy(1.1 * 1.1) == Catch::Approx(-1.5));
+        SECTION("Tabulated") {
+            const fs::path table_path(TEST_RESULTS_DIR "lj.table");
+            {
+                std::ofstream table(table_path);
+                table.precision(17);
+                for (double r = 0.8; r < 2.5 + 1e-9; r += 0.01)
+                    table << r << ' ' << shifted.energy(r * r) << '\n';
+            }
+            const Tabulated<double> tabulated(table_path);
+            REQUIRE(tabulated.cutoff2 == Catch::Approx(2.5 * 2.5));
+            for (double r = 0.85; r < 2.45; r += 0.0137) {
+                REQUIRE(tabulated.energy(r * r) ==
+                        Catch::Approx(shifted.energy(r * r)).epsilon(1e-4).margin(1e-5));
+                REQUIRE(tabulated.force_over_r(r * r) ==
+                        Catch::Approx(shifted.force_over_r(r * r)).epsilon(1e-3).margin(1e-4));
+            }
+            check(tabulated, 0.9, 2.45);
+            REQUIRE_THROWS(Tabulated<double>(fs::path(TEST_RESULTS_DIR "missing.table")));
+        }
+        SECTION("System") {
+            const fs::path settings(MD_SETTINGS_PATH "input.liquid"),
+                    lattice(LATTICES_PATH "config.fcc");
+            LJMono<double, false, Ensamble::NVE> reference(settings, lattice);
+            LJMono<double, false, Ensamble::NVE, double, ShiftedForceLJ<double>> shifted_system(
+                    settings, lattice);
+            std::mt19937 rng(13);
+            std::uniform_real_distribution<double> unif(-0.05, 0.05);
+            reference.m_positions.apply([&](auto &x) { x = reference.pbc(x + unif(rng)); });
+            shifted_system.m_positions = reference.m_positions;
+            MeasureOutputs<double, Variable::PotentialEnergy> reference_out, shifted_out;
+            reference.measures<true>(reference_out);
+            shifted_system.measures<true>(shifted_out);
+            // Explicit LJ policy on the same system
+            reference.init_potential(LennardJones<double>(reference.m_simulation.cutoff));
+            reference.measures<true>(reference_out);
+            REQUIRE(reference_out.get_measures<Variable::PotentialEnergy>()[1] ==
+                    reference_out.get_measures<Variable::PotentialEnergy>()[0]);
+            // Shifting raises every pair energy within the cutoff
+            REQUIRE(shifted_out.get_measures<Variable::PotentialEnergy>()[0] >
+                    reference_out.get_measures<Variable::PotentialEnergy>()[0]);
+            REQUIRE_THROWS(reference.init_potential(LennardJones<double>(10.0)));
+        }
+    }
 }
@@ -3,6 +3,7 @@
 //
 #include <fstream>
 #include <random>
+#include <sstream>
 
 #include <catch2/catch_test_macros.hpp>
 
@@ -39,6 +40,14 @@ TEST_CASE("ARandom", "[rng]") {
         for (size_t i = 0; i < 10'000; i++) { results << coin(rng) << '\n'; }
         results.close();
     }
+    SECTION("State") {
+        ARandom rng(SEEDS_PATH "seed.in", PRIMES_PATH "Primes", 3), restored;
+        for (size_t i = 0; i < 100; i++) rng();
+        std::stringstream state;
+        state << rng;
+        state >> restored;
+        for (size_t i = 0; i < 100; i++) CHECK(restored() == rng());
+    }
     SECTION("Read primes") {
         size_t a, b;
         read_primes(PRIMES_PATH "Primes", 0, a, b);
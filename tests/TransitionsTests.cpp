@@ -45,6 +45,12 @@ TEST_CASE("Transitions", "[trans]") {
                 REQUIRE(logp == Catch::Approx(0.0));
             }
         }
+        SECTION("set_width") {
+            UniformNear<double, StateSpace> t(0.05, a.size());
+            t.set_width(0.5);
+            REQUIRE(t.width() == 0.5);
+            REQUIRE(t.logp(b, a) == Catch::Approx(0.0));
+        }
         SECTION("sample") {
             SECTION("ariel") {
                 bool out = false;
@@ -84,5 +90,11 @@ TEST_CASE("Transitions", "[trans]") {
             GaussNear<double, StateSpace> t3(3.0, a.size());
             REQUIRE(t3.logp(b, a) == Catch::Approx(-4.037879421523343));
         }
+        SECTION("set_width") {
+            GaussNear<double, StateSpace> t(1.0, a.size());
+            t.set_width(3.0);
+            REQUIRE(t.width() == 3.0);
+            REQUIRE(t.logp(b, a) == Catch::Approx(-4.037879421523343));
+        }
     }
 }
\ No newline at end of file
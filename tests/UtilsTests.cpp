@@ -2,12 +2,22 @@
 // Created by Davide Nicoli on 06/10/22.
 //
 
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <random>
+#include <string>
 #include <tuple>
 #include <vector>
 
+#include <catch2/catch_approx.hpp>
 #include <catch2/catch_test_macros.hpp>
 #include <rapidcsv.h>
 
+#include "config.hpp"
+#include "tables.hpp"
 #include "utils.hpp"
 
 template<typename x>
@@ -48,4 +58,97 @@ TEST_CASE("Utils", "[utils]") {
             CHECK(bins == std::vector<size_t>{3, 4, 3});
         }
     }
-}
\ No newline at end of file
+
+    SECTION("FFT autocorrelation") {
+        std::mt19937 rng(11);
+        std::normal_distribution<double> noise(0, 1);
+        std::vector<double> sample(5000);
+        double x = 0;
+        for (auto &xt: sample) xt = x = 0.9 * x + noise(rng);
+        // All the lags go through FFT, a few through the definition
+        std::vector<double> fft_ac(sample.size()), direct_ac(4);
+        utils::autocorrelation_fn(sample.cbegin(), sample.cend(), fft_ac.begin());
+        utils::autocorrelation_fn(sample.cbegin(), sample.cend(), direct_ac.begin(), 4);
+        REQUIRE(fft_ac[0] == Catch::Approx(1));
+        for (size_t t = 1; t < direct_ac.size(); t++)
+            REQUIRE(fft_ac[t] == Catch::Approx(direct_ac[t]).epsilon(1e-10));
+        const auto mean = std::accumulate(sample.cbegin(), sample.cend(), 0.0) / 5000;
+        double c0 = 0, c_last = 0;
+        for (size_t i = 0; i < sample.size(); i++) c0 += (sample[i] - mean) * (sample[i] - mean);
+        for (size_t i = 0; i + 4000 < sample.size(); i++)
+            c_last += (sample[i] - mean) * (sample[i + 4000] - mean);
+        REQUIRE(fft_ac[4000] == Catch::Approx(c_last / c0).margin(1e-12));
+    }
+
+    SECTION("Integrated autocorrelation time") {
+        // AR(1) process: rho(t) = a^t, hence tau = (1 + a) / (2 (1 - a))
+        std::mt19937 rng(42);
+        std::normal_distribution<double> noise(0, 1);
+        std::vector<double> sample(100000);
+        double x = 0;
+        for (auto &xt: sample) xt = x = 0.5 * x + noise(rng);
+        const auto tau = utils::integrated_autocorrelation_time(sample.cbegin(), sample.cend());
+        CHECK(std::abs(tau - 1.5) < 0.1);
+        std::vector<double> white(100000);
+        for (auto &xt: white) xt = noise(rng);
+        CHECK(std::abs(utils::integrated_autocorrelation_time(white.cbegin(), white.cend()) -
+                       0.5) < 0.05);
+        const std::vector<double> constant(1000, 2.);
+        CHECK(utils::integrated_autocorrelation_time(constant.cbegin(), constant.cend()) == 0.5);
+    }
+
+    SECTION("Tables") {
+        const std::vector<double> x{0.5, -1.25, 3};
+        const std::vector<uint8_t> flags{1, 0, 1};
+        SECTION("Npz") {
+            tables::Table table(fs::path(TEST_RESULTS_DIR "table.csv"), tables::Format::Npz);
+            CHECK(table.path().extension() == ".npz");
+            table.add("x", x);
+            table.add("flags", flags);
+            table.save();
+            std::string bytes(size_t(fs::file_size(table.path())), '\0');
+            std::ifstream(table.path(), std::ios::binary).read(bytes.data(), long(bytes.size()));
+            // Local header of the first entry, named after its column
+            REQUIRE(bytes.substr(0, 4) == std::string("PK\x03\x04", 4));
+            uint16_t name_size;
+            std::memcpy(&name_size, bytes.data() + 26, 2);
+            CHECK(bytes.substr(30, name_size) == "x.npy");
+            // The npy array, aligned to 64 bytes
+            const auto npy = bytes.substr(30 + name_size);
+            CHECK(npy.substr(0, 8) == std::string("\x93NUMPY\x01\x00", 8));
+            uint16_t header_size;
+            std::memcpy(&header_size, npy.data() + 8, 2);
+            CHECK((10 + header_size) % 64 == 0);
+            CHECK(npy.find("'descr': '<f8'") != std::string::npos);
+            CHECK(npy.find("'shape': (3,)") != std::string::npos);
+            std::vector<double> stored(3);
+            std::memcpy(stored.data(), npy.data() + 10 + header_size, 3 * sizeof(double));
+            CHECK(stored == x);
+            // End of the central directory, listing both columns
+            const auto end = bytes.rfind(std::string("PK\x05\x06", 4));
+            REQUIRE(end == bytes.size() - 22);
+            uint16_t n_entries;
+            std::memcpy(&n_entries, bytes.data() + end + 10, 2);
+            CHECK(n_entries == 2);
+            CHECK(bytes.find("flags.npy") != std::string::npos);
+            // Read back from the mapped archive
+            REQUIRE(tables::is_npz(table.path()));
+            const tables::NpzReader reader(table.path());
+            CHECK(reader.names() == std::vector<std::string>{"x", "flags"});
+            CHECK(reader.column<double>("x") == x);
+            CHECK(reader.column<double>("flags", 1) == std::vector<double>{0, 1});
+            CHECK_THROWS(reader.column<double>("y"));
+        }
+        SECTION("Csv") {
+            tables::Table table(fs::path(TEST_RESULTS_DIR "table.npz"), tables::Format::Csv);
+            CHECK(table.path().extension() == ".csv");
+            table.add("x", x);
+            table.save();
+            csv::Document stored(table.path().string());
+            CHECK(stored.GetColumnCount() == 1);
+            CHECK(stored.GetColumn<double>("x") == x);
+        }
+        CHECK(tables::format_from("npz") == tables::Format::Npz);
+        CHECK_THROWS(tables::format_from("hdf5"));
+    }
+}
@@ -5,6 +5,8 @@
 #include <catch2/catch_approx.hpp>
 #include <catch2/catch_test_macros.hpp>
 
+#include "config.hpp"
+#include "mapped_table.hpp"
 #include "molecular_systems/data_types/vectors.hpp"
 
 TEST_CASE("Vectors", "[structs]") {
@@ -32,4 +34,14 @@ TEST_CASE("Vectors", "[structs]") {
         Vectors<double> v1({1, 2}, {3, 4}, {5, 6});
         REQUIRE(v1.full_norm2() == Catch::Approx(91));
     }
+    SECTION("Binary configuration") {
+        const fs::path text(LATTICES_PATH "config.fcc"), table(TEST_RESULTS_DIR "config.table");
+        REQUIRE(text_to_table<double>(text, table, 3) == 108);
+        REQUIRE(is_binary_table(table));
+        REQUIRE_FALSE(is_binary_table(text));
+        // The loader picks the format, and the values are the parsed ones
+        REQUIRE(Vectors<double>(108, table) == Vectors<double>(108, text));
+        REQUIRE_THROWS(Vectors<double>(109, table));
+        REQUIRE_THROWS(MappedTable(table).column<uint8_t>(0));
+    }
 }
\ No newline at end of file